@@ -13,6 +13,8 @@
 #include "WaterTank.h"
 #include "GlassFeather.h"
 #include "Waterfall.h"
+#include "WaterActorPoolSubsystem.h"
+#include "WaterSimulationSubsystem.h"
 
 AFacilityProjectile::AFacilityProjectile() 
 {
@@ -39,14 +41,66 @@ AFacilityProjectile::AFacilityProjectile()
 
 	// Die after 3 seconds by default
 	InitialLifeSpan = 3.0f;
+
+	// Blueprint hit logic stays in charge until projectile content is moved over
+	bUseNativeGlassHit = false;
+	HoleRadius = 0.5f;
+}
+
+void AFacilityProjectile::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// Feathers keep no state of their own, so they are pooled as plain actors
+	UWorld* const World = GetWorld();
+	UWaterActorPoolSubsystem* ActorPool = (World != nullptr) ? World->GetSubsystem<UWaterActorPoolSubsystem>() : nullptr;
+	if ((ActorPool != nullptr) && (GlassFeatherToSpawn != nullptr))
+	{
+		ActorPool->AddPlainClass(GlassFeatherToSpawn.Get());
+	}
 }
 
 void AFacilityProjectile::OnHit(UPrimitiveComponent* HitComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit)
 {
+	// Setting logic when water container glass is hit
+	AWaterTank* WaterTank = Cast<AWaterTank>(OtherActor);
+	if (bUseNativeGlassHit && (WaterTank != nullptr) && WaterTank->IsGlassComponent(OtherComp))
+	{
+		OnWaterContainerHit(WaterTank, OtherComp, Hit.ImpactPoint, Hit.ImpactNormal);
+		return;
+	}
+
 	// Only add impulse and destroy projectile if we hit a physics
 	OnSimPhysHit(OtherActor, OtherComp);
 }
 
+void AFacilityProjectile::OnWaterContainerHit(AWaterTank* WaterTank, UPrimitiveComponent* OtherComp, FVector HitLocation, FVector HitNormal)
+{
+	// Making hole, tank drains through it and assigns waterfall from pool
+	int32 HoleIndex = WaterTank->AddHole(HitLocation, HitNormal, HoleRadius);
+
+	// Queueing glass feather and smash sound
+	UWorld* const World = GetWorld();
+	UWaterSimulationSubsystem* WaterSimulation = (World != nullptr) ? World->GetSubsystem<UWaterSimulationSubsystem>() : nullptr;
+	if (WaterSimulation != nullptr)
+	{
+		TSubclassOf<AActor> FeatherClass = GlassFeatherToSpawn.Get();
+		WaterSimulation->QueueGlassHit(OtherComp, HitLocation, HitNormal, FeatherClass, GlassSmashSound);
+	}
+
+	ReceiveWaterContainerHit(WaterTank, HitLocation, HitNormal, HoleIndex);
+
+	// Pushing tank if it is loose, otherwise projectile stops in glass
+	if (OtherComp->IsSimulatingPhysics())
+	{
+		OnSimPhysHit(WaterTank, OtherComp);
+	}
+	else
+	{
+		UWaterActorPoolSubsystem::ReleaseOrDestroy(this);
+	}
+}
+
 void AFacilityProjectile::OnSimPhysHit(AActor* OtherActor, UPrimitiveComponent* OtherComp)
 {
 	if ((OtherActor != nullptr) && (OtherActor != this) && (OtherComp != nullptr) && OtherComp->IsSimulatingPhysics())
@@ -54,58 +108,30 @@ void AFacilityProjectile::OnSimPhysHit(AActor* OtherActor, UPrimitiveComponent*
 		// Default: 100.0f
 		OtherComp->AddImpulseAtLocation(GetVelocity() * 50.0f, GetActorLocation());
 
-		Destroy();
+		UWaterActorPoolSubsystem::ReleaseOrDestroy(this);
 	}
 }
 
-/*
-void AFacilityProjectile::NotifyHit(UPrimitiveComponent* MyComp, AActor* Other, UPrimitiveComponent* OtherComp, bool bSelfMoved, FVector HitLocation, FVector HitNormal, FVector NormalImpulse, const FHitResult& Hit)
+void AFacilityProjectile::LifeSpanExpired()
 {
-	// Setting logic when water container is hit
-	AActor* OtherActorVar = Cast<AWaterTank>(Other);
-	if (OtherActorVar != nullptr)
-	{
-		OnWaterContainerHit(OtherComp, HitLocation, HitNormal);
-	}
+	UWaterActorPoolSubsystem::ReleaseOrDestroy(this);
 }
-*/
 
-/*
-void AFacilityProjectile::OnWaterContainerHit(UPrimitiveComponent* OtherComp, FVector HitLocation, FVector HitNormal)
+void AFacilityProjectile::OnAcquiredFromPool()
 {
-	// Setting spawn location
-	FVector Loc = HitLocation;
-	// Setting spawn rotation
-	FRotator Rot = HitNormal.Rotation();
-	// Setting spawn params
-	FActorSpawnParameters SpawnParams;
-	// Setting hit component
-	UPrimitiveComponent* OtherCompVar = OtherComp;
-	// Setting transform rules
-	FAttachmentTransformRules AttachmentRules(EAttachmentRule::KeepWorld, EAttachmentRule::KeepWorld, EAttachmentRule::KeepWorld, true);
+	// Launching again along new forward vector
+	ProjectileMovement->SetUpdatedComponent(CollisionComp);
+	ProjectileMovement->Velocity = GetActorForwardVector() * ProjectileMovement->InitialSpeed;
+	ProjectileMovement->Activate(true);
 
-	UWorld* const World = GetWorld();
-	if (OtherCompVar->GetName() == "Glass")
-	{
-		if (World != nullptr)
-		{
-			// Spawning glass feather
-			AGlassFeather* SpawnedGlassFeather = World->SpawnActor<AGlassFeather>(this->GlassFeatherToSpawn, Loc, Rot, SpawnParams);
-			// Attaching glass feather to water container
-			SpawnedGlassFeather->AttachToComponent(OtherCompVar, AttachmentRules);
-			// Playing sound at hit location
-			UGameplayStatics::PlaySoundAtLocation(this, GlassSmashSound, Loc);
-
-			// Spawning waterfall
-			AWaterfall* SpawnedWaterfall = World->SpawnActor<AWaterfall>(this->WaterfallToSpawn, Loc, Rot, SpawnParams);
-			// Attaching waterfall to water container
-			SpawnedWaterfall->AttachToComponent(OtherCompVar, AttachmentRules);
-
-			if (!(OtherCompVar->IsSimulatingPhysics()))
-			{
-				Destroy();
-			}
-		}
-	}
+	// Restarting life span
+	SetLifeSpan(InitialLifeSpan);
+}
+
+void AFacilityProjectile::OnReleasedToPool()
+{
+	// Stopping projectile while it waits in pool
+	ProjectileMovement->StopMovementImmediately();
+	ProjectileMovement->Deactivate();
+	SetLifeSpan(0.0f);
 }
-*/
@@ -4,15 +4,17 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "WaterPoolable.h"
 #include "FacilityProjectile.generated.h"
 
 class USphereComponent;
 class UProjectileMovementComponent;
 class AGlassFeather;
 class AWaterfall;
+class AWaterTank;
 
 UCLASS(config=Game)
-class AFacilityProjectile : public AActor
+class AFacilityProjectile : public AActor, public IWaterPoolable
 {
 	GENERATED_BODY()
 
@@ -36,27 +38,45 @@ public:
 	/** Returns ProjectileMovement subobject **/
 	UProjectileMovementComponent* GetProjectileMovement() const { return ProjectileMovement; }
 
+	// Registering glass feather class with actor pool (pooled projectiles only begin play once)
+	virtual void BeginPlay() override;
+
+	// Going back to actor pool instead of being destroyed when life span ends
+	virtual void LifeSpanExpired() override;
+
+	// IWaterPoolable
+	virtual void OnAcquiredFromPool() override;
+	virtual void OnReleasedToPool() override;
+
 public:
 	// Called when projectile hits smth simulating physics
 	UFUNCTION()
 	void OnSimPhysHit(AActor* OtherActor, UPrimitiveComponent* OtherComp);
 
-	// I temporarily disabled it for BP implementation of projectiles logic
-	// Event when this actor bumps into a blocking object, or blocks another actor that bumps into it
-	// UFUNCTION()
-	// void NotifyHit(class UPrimitiveComponent* MyComp, AActor* Other, class UPrimitiveComponent* OtherComp, bool bSelfMoved, FVector HitLocation, FVector HitNormal, FVector NormalImpulse, const FHitResult& Hit) override;
+	// Called when water container glass is hit by projectile.
+	// Hole is added to tank right away (tank assigns pooled waterfall to it), feather and sound are queued
+	// in water simulation subsystem and spawned in per frame batches
+	UFUNCTION()
+	void OnWaterContainerHit(AWaterTank* WaterTank, UPrimitiveComponent* OtherComp, FVector HitLocation, FVector HitNormal);
 
-	// I temporarily disabled it for BP implementation of projectiles logic
-	// Called when water container is hit by projectile
-	// UFUNCTION()
-	// void OnWaterContainerHit(class UPrimitiveComponent* OtherComp, FVector HitLocation, FVector HitNormal);
+	// Event for Blueprint extras after native glass hit, HoleIndex is hole added to tank
+	UFUNCTION(BlueprintImplementableEvent, Category = "Projectile Hit FX")
+	void ReceiveWaterContainerHit(AWaterTank* WaterTank, FVector HitLocation, FVector HitNormal, int32 HoleIndex);
 
 public:
 	// Glass feather to spawn
 	UPROPERTY(EditDefaultsOnly, Category = "Projectile Hit FX")
 	TSubclassOf<AGlassFeather> GlassFeatherToSpawn;
 
-	// Waterfall to spawn
+	// Handling tank glass hits in C++, otherwise they are left to Blueprint (off until Blueprint hit logic is removed)
+	UPROPERTY(EditDefaultsOnly, Category = "Projectile Hit FX")
+	bool bUseNativeGlassHit;
+
+	// Radius of hole made in tank glass
+	UPROPERTY(EditDefaultsOnly, Category = "Projectile Hit FX", meta = (ClampMin = "0.0"))
+	float HoleRadius;
+
+	// Waterfall to spawn (Blueprint hit logic only, native hits show holes with proxy class of the tank)
 	UPROPERTY(EditDefaultsOnly, Category = "Projectile Hit FX")
 	TSubclassOf<AWaterfall> WaterfallToSpawn;
 
@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LiquidOutflow.h"
+#include "Math/UnrealMathUtility.h"
+#include "Containers/Array.h"
+
+int32 FLiquidOutflow::ConsumeSubsteps(float DeltaTime, float& InOutAccumulator)
+{
+	InOutAccumulator += FMath::Max(DeltaTime, 0.0f);
+
+	// Unlike slosh, skipped time would be lost volume, so only consumed steps leave the accumulator
+	int32 NumSubsteps = FMath::Min(FMath::FloorToInt(InOutAccumulator / LiquidOutflowConstants::FixedStep), LiquidOutflowConstants::MaxSubsteps);
+	InOutAccumulator -= NumSubsteps * LiquidOutflowConstants::FixedStep;
+
+	return NumSubsteps;
+}
+
+float FLiquidOutflow::GetHoleArea(float Radius)
+{
+	return LiquidOutflowConstants::DischargeCoefficient * PI * FMath::Square(FMath::Max(Radius, 0.0f));
+}
+
+float FLiquidOutflow::GetFlowRate(float Area, float Head)
+{
+	return Area * FMath::Sqrt(2.0f * LiquidOutflowConstants::Gravity * FMath::Max(Head, 0.0f));
+}
+
+float FLiquidOutflow::GetHead(const FVector& Location, const FVector& SurfacePoint, const FVector& SurfaceUp)
+{
+	// Going straight up from location until surface plane is hit
+	if (SurfaceUp.Z <= KINDA_SMALL_NUMBER)
+	{
+		return 0.0f;
+	}
+
+	return FMath::Max(FVector::DotProduct(SurfacePoint - Location, SurfaceUp) / SurfaceUp.Z, 0.0f);
+}
+
+float FLiquidOutflow::Drain(int32 NumHoles, const float* Area, float* Head, float* OutVolume, float Volume, float SurfaceArea, int32 NumSubsteps)
+{
+	using namespace LiquidOutflowConstants;
+
+	float Remaining = FMath::Max(Volume, 0.0f);
+	float InvSurfaceArea = 1.0f / FMath::Max(SurfaceArea, KINDA_SMALL_NUMBER);
+
+	TArray<float, TInlineAllocator<16>> StepVolumes;
+	StepVolumes.SetNumUninitialized(NumHoles);
+
+	for (int32 Substep = 0; (Substep < NumSubsteps) && (Remaining > 0.0f); ++Substep)
+	{
+		float StepVolume = 0.0f;
+		for (int32 i = 0; i < NumHoles; ++i)
+		{
+			StepVolumes[i] = GetFlowRate(Area[i], Head[i]) * FixedStep;
+			StepVolume += StepVolumes[i];
+		}
+
+		if (StepVolume <= 0.0f)
+		{
+			break;
+		}
+
+		// Last drops are shared by holes in proportion to their flow
+		float Share = FMath::Min(Remaining / StepVolume, 1.0f);
+		StepVolume = 0.0f;
+		for (int32 i = 0; i < NumHoles; ++i)
+		{
+			OutVolume[i] += StepVolumes[i] * Share;
+			StepVolume += StepVolumes[i] * Share;
+		}
+
+		Remaining = FMath::Max(Remaining - StepVolume, 0.0f);
+
+		// Surface drops by the same amount above every hole
+		for (int32 i = 0; i < NumHoles; ++i)
+		{
+			Head[i] = FMath::Max(Head[i] - StepVolume * InvSurfaceArea, 0.0f);
+		}
+	}
+
+	return FMath::Max(Volume, 0.0f) - Remaining;
+}
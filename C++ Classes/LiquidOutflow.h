@@ -0,0 +1,45 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+namespace LiquidOutflowConstants
+{
+	// Fixed integration step
+	const float FixedStep = 1.0f / 60.0f;
+
+	// Max substeps per update (2 seconds), covers rest and frozen tick intervals.
+	// Steps above it stay in accumulator for next update, drained volume is never dropped
+	const int32 MaxSubsteps = 120;
+
+	// Share of hole area the jet really uses (sharp edged orifice)
+	const float DischargeCoefficient = 0.61f;
+
+	// Gravity used for jet speed, cm/s^2
+	const float Gravity = 980.0f;
+}
+
+// Outflow of liquid through holes in a tank (Torricelli).
+// Every hole drains Cd * A * sqrt(2 g h), h being the liquid head above it. Heads drop with
+// drained volume spread over the tank cross section, integrated with a fixed substep. Drained
+// volume is written per hole, so whatever receives it gets exactly what the tank lost.
+struct FACILITY_API FLiquidOutflow
+{
+	// Getting substep count for elapsed time, keeping remainder and steps above cap in accumulator
+	static int32 ConsumeSubsteps(float DeltaTime, float& InOutAccumulator);
+
+	// Getting effective area of round hole of given radius (cm)
+	static float GetHoleArea(float Radius);
+
+	// Getting flow rate (cm^3/s) of hole for effective area and head (cm)
+	static float GetFlowRate(float Area, float Head);
+
+	// Getting vertical head of liquid above point, from point on surface and surface up vector
+	static float GetHead(const FVector& Location, const FVector& SurfacePoint, const FVector& SurfaceUp);
+
+	// Draining holes of one tank by NumSubsteps fixed steps.
+	// Heads are lowered in place, drained volume is added to OutVolume per hole.
+	// Returns total drained volume, never more than Volume.
+	static float Drain(int32 NumHoles, const float* Area, float* Head, float* OutVolume, float Volume, float SurfaceArea, int32 NumSubsteps);
+};
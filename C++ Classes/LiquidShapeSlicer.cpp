@@ -0,0 +1,471 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LiquidShapeSlicer.h"
+#include "Materials/MaterialInterface.h"
+#include "Math/UnrealMathUtility.h"
+
+// Assets
+#include "LiquidSlicer.h"
+
+namespace LiquidShapeSlicerHelpers
+{
+	// Corner of a column quad with its signed distance to surface plane
+	struct FQuadCorner
+	{
+		FVector Position;
+		FVector Normal;
+		FVector2D UV;
+		float Distance;
+	};
+
+	FORCEINLINE void WriteVertex(FVector* OutPos, FVector* OutNorm, FVector2D* OutUV, int32 Slot, const FVector& Pos, const FVector& Norm, const FVector2D& UV)
+	{
+		OutPos[Slot] = Pos;
+		OutNorm[Slot] = Norm;
+		OutUV[Slot] = UV;
+	}
+
+	// Clipping triangle into 6 vertex slots (kept part or degenerate), returns true and cut segment if it crosses the plane
+	bool ClipTriangle(const FQuadCorner& V0, const FQuadCorner& V1, const FQuadCorner& V2, FVector* BodyPos, FVector* BodyNorm, FVector2D* BodyUV, int32 Base, FVector& OutCutB, FVector& OutCutC)
+	{
+		const FQuadCorner* V[3] = { &V0, &V1, &V2 };
+		bool bKept[3] = { V0.Distance >= 0.0f, V1.Distance >= 0.0f, V2.Distance >= 0.0f };
+		int32 KeptCount = int32(bKept[0]) + int32(bKept[1]) + int32(bKept[2]);
+
+		if ((KeptCount == 0) || (KeptCount == 3))
+		{
+			for (int32 k = 0; k < 6; ++k)
+			{
+				const FQuadCorner& Corner = ((KeptCount == 3) && (k < 3)) ? *V[k] : V0;
+				WriteVertex(BodyPos, BodyNorm, BodyUV, Base + k, Corner.Position, Corner.Normal, Corner.UV);
+			}
+			return false;
+		}
+
+		// Rotating triangle so that lone vertex comes first (kept one for 1 kept, dropped one for 2 kept)
+		bool bLoneIsKept = (KeptCount == 1);
+		int32 Lone = 0;
+		for (int32 k = 0; k < 3; ++k)
+		{
+			if (bKept[k] == bLoneIsKept)
+			{
+				Lone = k;
+				break;
+			}
+		}
+
+		const FQuadCorner& A = *V[Lone];
+		const FQuadCorner& B = *V[(Lone + 1) % 3];
+		const FQuadCorner& C = *V[(Lone + 2) % 3];
+
+		float TAB = A.Distance / (A.Distance - B.Distance);
+		float TAC = A.Distance / (A.Distance - C.Distance);
+
+		FVector PAB = FMath::Lerp(A.Position, B.Position, TAB);
+		FVector PAC = FMath::Lerp(A.Position, C.Position, TAC);
+		FVector NAB = FMath::Lerp(A.Normal, B.Normal, TAB).GetSafeNormal();
+		FVector NAC = FMath::Lerp(A.Normal, C.Normal, TAC).GetSafeNormal();
+		FVector2D UVAB = FMath::Lerp(A.UV, B.UV, TAB);
+		FVector2D UVAC = FMath::Lerp(A.UV, C.UV, TAC);
+
+		if (bLoneIsKept)
+		{
+			// One vertex under the surface: triangle (A, AB, AC)
+			WriteVertex(BodyPos, BodyNorm, BodyUV, Base + 0, A.Position, A.Normal, A.UV);
+			WriteVertex(BodyPos, BodyNorm, BodyUV, Base + 1, PAB, NAB, UVAB);
+			WriteVertex(BodyPos, BodyNorm, BodyUV, Base + 2, PAC, NAC, UVAC);
+			for (int32 k = 3; k < 6; ++k)
+			{
+				WriteVertex(BodyPos, BodyNorm, BodyUV, Base + k, A.Position, A.Normal, A.UV);
+			}
+		}
+		else
+		{
+			// Two vertices under the surface: quad (AB, B, C, AC)
+			WriteVertex(BodyPos, BodyNorm, BodyUV, Base + 0, PAB, NAB, UVAB);
+			WriteVertex(BodyPos, BodyNorm, BodyUV, Base + 1, B.Position, B.Normal, B.UV);
+			WriteVertex(BodyPos, BodyNorm, BodyUV, Base + 2, C.Position, C.Normal, C.UV);
+			WriteVertex(BodyPos, BodyNorm, BodyUV, Base + 3, PAB, NAB, UVAB);
+			WriteVertex(BodyPos, BodyNorm, BodyUV, Base + 4, C.Position, C.Normal, C.UV);
+			WriteVertex(BodyPos, BodyNorm, BodyUV, Base + 5, PAC, NAC, UVAC);
+		}
+
+		OutCutB = PAB;
+		OutCutC = PAC;
+		return true;
+	}
+
+	// Upright prism profile with hard bottom and top edges
+	void BuildPrismProfile(const FVector& Extent, TArray<FLiquidProfilePoint>& OutProfile)
+	{
+		OutProfile.Reset(6);
+		OutProfile.Add({ 0.0f, -Extent.Z, FVector2D(0.0f, -1.0f), 0.0f });
+		OutProfile.Add({ 1.0f, -Extent.Z, FVector2D(0.0f, -1.0f), 0.25f });
+		OutProfile.Add({ 1.0f, -Extent.Z, FVector2D(1.0f, 0.0f), 0.25f });
+		OutProfile.Add({ 1.0f, Extent.Z, FVector2D(1.0f, 0.0f), 0.75f });
+		OutProfile.Add({ 1.0f, Extent.Z, FVector2D(0.0f, 1.0f), 0.75f });
+		OutProfile.Add({ 0.0f, Extent.Z, FVector2D(0.0f, 1.0f), 1.0f });
+	}
+
+	void BuildCirclePerimeter(int32 Resolution, TArray<FVector2D>& OutPoints, TArray<FVector2D>& OutNormals)
+	{
+		OutPoints.Reset(Resolution);
+		OutNormals.Reset(Resolution);
+		for (int32 i = 0; i < Resolution; ++i)
+		{
+			float Angle = 2.0f * PI * float(i) / float(Resolution);
+			FVector2D Point(FMath::Cos(Angle), FMath::Sin(Angle));
+			OutPoints.Add(Point);
+			OutNormals.Add(Point);
+		}
+	}
+}
+
+FLiquidShapeSlicer::FLiquidShapeSlicer()
+{
+	this->Center = FVector::ZeroVector;
+	this->Extent = FVector(1.0f);
+	this->TotalVolume = 0.0f;
+}
+
+TUniquePtr<FLiquidShapeSlicer> FLiquidShapeSlicer::Create(ELiquidTankShape Shape, int32 Resolution)
+{
+	switch (Shape)
+	{
+	case ELiquidTankShape::Box:
+		return MakeUnique<TLiquidShapeSlicer<FLiquidBoxShape>>(Resolution);
+	case ELiquidTankShape::Cylinder:
+		return MakeUnique<TLiquidShapeSlicer<FLiquidCylinderShape>>(Resolution);
+	case ELiquidTankShape::Capsule:
+		return MakeUnique<TLiquidShapeSlicer<FLiquidCapsuleShape>>(Resolution);
+	default:
+		return nullptr;
+	}
+}
+
+void FLiquidShapeSlicer::BuildTopology()
+{
+	int32 NumColumns = this->Perimeter.Num();
+	int32 NumSegments = FMath::Max(this->Profile.Num() - 1, 0);
+
+	// Every column quad is two triangles of 6 slots, every triangle owns one cap fan triangle
+	this->BodyTriangles.SetNumUninitialized(NumColumns * NumSegments * 12);
+	for (int32 i = 0; i < this->BodyTriangles.Num(); ++i)
+	{
+		this->BodyTriangles[i] = i;
+	}
+
+	this->CapTriangles.SetNumUninitialized(NumColumns * NumSegments * 6);
+	for (int32 i = 0; i < this->CapTriangles.Num(); ++i)
+	{
+		this->CapTriangles[i] = i;
+	}
+}
+
+void FLiquidShapeSlicer::InitBuffers(FLiquidSliceBuffers& Buffers) const
+{
+	int32 NumBodySlots = this->BodyTriangles.Num();
+	int32 NumCapSlots = this->CapTriangles.Num();
+
+	Buffers.BodyVertices.SetNumZeroed(NumBodySlots);
+	Buffers.BodyNormals.SetNumZeroed(NumBodySlots);
+	Buffers.BodyUVs.SetNumZeroed(NumBodySlots);
+
+	Buffers.CapVertices.SetNumZeroed(NumCapSlots);
+	Buffers.CapNormals.SetNumZeroed(NumCapSlots);
+	Buffers.CapUVs.SetNumZeroed(NumCapSlots);
+
+	Buffers.Distances.SetNumZeroed(this->Perimeter.Num() * this->Profile.Num());
+	Buffers.CrossingTriangles.Reset(NumCapSlots / 3);
+}
+
+void FLiquidShapeSlicer::Slice(const FPlane& LocalPlane, FLiquidSliceBuffers& Buffers) const
+{
+	using namespace LiquidShapeSlicerHelpers;
+
+	int32 NumColumns = this->Perimeter.Num();
+	int32 NumRings = this->Profile.Num();
+	check(Buffers.BodyVertices.Num() == this->BodyTriangles.Num());
+	check(Buffers.Distances.Num() == NumColumns * NumRings);
+
+	FVector PlaneNormal(LocalPlane.X, LocalPlane.Y, LocalPlane.Z);
+
+	auto GetRingPosition = [this](int32 Column, int32 Ring)
+	{
+		const FLiquidProfilePoint& Point = this->Profile[Ring];
+		const FVector2D& Outline = this->Perimeter[Column];
+		return this->Center + FVector(Outline.X * this->Extent.X * Point.Scale, Outline.Y * this->Extent.Y * Point.Scale, Point.Z);
+	};
+
+	auto GetRingNormal = [this](int32 Column, int32 Ring)
+	{
+		const FVector2D& Normal = this->Profile[Ring].Normal;
+		const FVector2D& Outline = this->PerimeterNormals[Column];
+		return FVector(Outline.X * Normal.X, Outline.Y * Normal.X, Normal.Y).GetSafeNormal();
+	};
+
+	// Classifying every ring of every column, a tilted surface can cross a column more than once
+	float* Dist = Buffers.Distances.GetData();
+	for (int32 Column = 0; Column < NumColumns; ++Column)
+	{
+		for (int32 Ring = 0; Ring < NumRings; ++Ring)
+		{
+			Dist[Column * NumRings + Ring] = LocalPlane.PlaneDot(GetRingPosition(Column, Ring));
+		}
+	}
+
+	FVector* BodyPos = Buffers.BodyVertices.GetData();
+	FVector* BodyNorm = Buffers.BodyNormals.GetData();
+	FVector2D* BodyUV = Buffers.BodyUVs.GetData();
+	FVector* CapPos = Buffers.CapVertices.GetData();
+	FVector* CapNorm = Buffers.CapNormals.GetData();
+	FVector2D* CapUV = Buffers.CapUVs.GetData();
+
+	Buffers.CrossingTriangles.Reset();
+	FVector CentroidSum = FVector::ZeroVector;
+
+	// Clipping both triangles of every column quad, each segment crossing the plane gets its own cut
+	int32 Tri = 0;
+	for (int32 Column = 0; Column < NumColumns; ++Column)
+	{
+		int32 Next = (Column + 1) % NumColumns;
+		float U = float(Column) / float(NumColumns);
+		float NextU = float(Next) / float(NumColumns);
+
+		for (int32 Ring = 0; Ring + 1 < NumRings; ++Ring)
+		{
+			FQuadCorner Corners[4];
+			Corners[0] = { GetRingPosition(Column, Ring), GetRingNormal(Column, Ring), FVector2D(U, this->Profile[Ring].V), Dist[Column * NumRings + Ring] };
+			Corners[1] = { GetRingPosition(Next, Ring), GetRingNormal(Next, Ring), FVector2D(NextU, this->Profile[Ring].V), Dist[Next * NumRings + Ring] };
+			Corners[2] = { GetRingPosition(Next, Ring + 1), GetRingNormal(Next, Ring + 1), FVector2D(NextU, this->Profile[Ring + 1].V), Dist[Next * NumRings + Ring + 1] };
+			Corners[3] = { GetRingPosition(Column, Ring + 1), GetRingNormal(Column, Ring + 1), FVector2D(U, this->Profile[Ring + 1].V), Dist[Column * NumRings + Ring + 1] };
+
+			// Front faces point outwards for counter-clockwise perimeter and bottom to top profile
+			const int32 Order[2][3] = { { 0, 2, 1 }, { 0, 3, 2 } };
+			for (int32 Half = 0; Half < 2; ++Half, ++Tri)
+			{
+				FVector CutB;
+				FVector CutC;
+				if (ClipTriangle(Corners[Order[Half][0]], Corners[Order[Half][1]], Corners[Order[Half][2]], BodyPos, BodyNorm, BodyUV, Tri * 6, CutB, CutC))
+				{
+					// Storing cut segment, cap centre is filled in after all segments are known
+					CapPos[Tri * 3 + 1] = CutB;
+					CapPos[Tri * 3 + 2] = CutC;
+					CentroidSum += CutB + CutC;
+					Buffers.CrossingTriangles.Add(Tri);
+				}
+				else
+				{
+					for (int32 k = 0; k < 3; ++k)
+					{
+						CapPos[Tri * 3 + k] = FVector::ZeroVector;
+					}
+				}
+			}
+		}
+	}
+
+	// Building cap as a fan around centre of cut outline
+	int32 NumCrossing = Buffers.CrossingTriangles.Num();
+	if (NumCrossing == 0)
+	{
+		return;
+	}
+
+	FVector Centroid = CentroidSum / float(NumCrossing * 2);
+	FVector CapNormal = -PlaneNormal.GetSafeNormal();
+	FVector2D UVScale(0.5f / this->Extent.X, 0.5f / this->Extent.Y);
+
+	for (int32 CrossingTri : Buffers.CrossingTriangles)
+	{
+		int32 CapBase = CrossingTri * 3;
+		FVector Fan[3] = { Centroid, CapPos[CapBase + 1], CapPos[CapBase + 2] };
+
+		// Keeping cap front face pointing away from the liquid (front faces are clockwise)
+		if (FVector::DotProduct(FVector::CrossProduct(Fan[1] - Centroid, Fan[2] - Centroid), CapNormal) > 0.0f)
+		{
+			Swap(Fan[1], Fan[2]);
+		}
+
+		for (int32 k = 0; k < 3; ++k)
+		{
+			CapPos[CapBase + k] = Fan[k];
+			CapNorm[CapBase + k] = CapNormal;
+			CapUV[CapBase + k] = FVector2D((Fan[k].X - this->Center.X) * UVScale.X + 0.5f, (Fan[k].Y - this->Center.Y) * UVScale.Y + 0.5f);
+		}
+	}
+}
+
+float FLiquidShapeSlicer::GetPlaneDistance(const FVector& LocalUp, float VolumeFraction) const
+{
+	// Finding surface height at shape centre by bisection of analytic volume
+	float TargetVolume = FMath::Clamp(VolumeFraction, 0.0f, 1.0f) * this->TotalVolume;
+	float Low = -this->Extent.Z;
+	float High = this->Extent.Z;
+	for (int32 Iteration = 0; Iteration < 20; ++Iteration)
+	{
+		float Mid = 0.5f * (Low + High);
+		if (GetVolumeBelow(Mid) < TargetVolume)
+		{
+			Low = Mid;
+		}
+		else
+		{
+			High = Mid;
+		}
+	}
+
+	FVector SurfaceCenter = this->Center + FVector(0.0f, 0.0f, 0.5f * (Low + High));
+
+	return FVector::DotProduct(LocalUp.GetSafeNormal(), SurfaceCenter);
+}
+
+void FLiquidShapeSlicer::CreateSections(UProceduralMeshComponent* ProcMesh, const FLiquidSliceBuffers& Buffers, UMaterialInterface* Material) const
+{
+	if (ProcMesh == nullptr)
+	{
+		return;
+	}
+
+	ProcMesh->ClearAllMeshSections();
+
+	ProcMesh->CreateMeshSection(LSS_Body, Buffers.BodyVertices, this->BodyTriangles, Buffers.BodyNormals, Buffers.BodyUVs, this->EmptyColors, this->EmptyTangents, false);
+	ProcMesh->CreateMeshSection(LSS_Cap, Buffers.CapVertices, this->CapTriangles, Buffers.CapNormals, Buffers.CapUVs, this->EmptyColors, this->EmptyTangents, false);
+
+	ProcMesh->SetMaterial(LSS_Body, Material);
+	ProcMesh->SetMaterial(LSS_Cap, Material);
+}
+
+void FLiquidShapeSlicer::UpdateSections(UProceduralMeshComponent* ProcMesh, const FLiquidSliceBuffers& Buffers) const
+{
+	if (ProcMesh == nullptr)
+	{
+		return;
+	}
+
+	ProcMesh->UpdateMeshSection(LSS_Body, Buffers.BodyVertices, Buffers.BodyNormals, Buffers.BodyUVs, this->EmptyColors, this->EmptyTangents);
+	ProcMesh->UpdateMeshSection(LSS_Cap, Buffers.CapVertices, Buffers.CapNormals, Buffers.CapUVs, this->EmptyColors, this->EmptyTangents);
+}
+
+template<typename ShapeType>
+void TLiquidShapeSlicer<ShapeType>::Initialize(const FBox& LocalBounds)
+{
+	this->Center = LocalBounds.GetCenter();
+	this->Extent = LocalBounds.GetExtent().ComponentMax(FVector(KINDA_SMALL_NUMBER));
+
+	ShapeType::BuildPerimeter(this->Resolution, this->Perimeter, this->PerimeterNormals);
+	ShapeType::BuildProfile(this->Resolution, this->Extent, this->Profile);
+	this->TotalVolume = ShapeType::GetVolumeBelow(this->Extent, this->Extent.Z);
+
+	BuildTopology();
+}
+
+template<typename ShapeType>
+float TLiquidShapeSlicer<ShapeType>::GetVolumeBelow(float Z) const
+{
+	return ShapeType::GetVolumeBelow(this->Extent, Z);
+}
+
+void FLiquidBoxShape::BuildPerimeter(int32 Resolution, TArray<FVector2D>& OutPoints, TArray<FVector2D>& OutNormals)
+{
+	// Sides keep their own corner points so that edges stay hard
+	const FVector2D Corners[4] = { FVector2D(1.0f, -1.0f), FVector2D(1.0f, 1.0f), FVector2D(-1.0f, 1.0f), FVector2D(-1.0f, -1.0f) };
+	const FVector2D Normals[4] = { FVector2D(1.0f, 0.0f), FVector2D(0.0f, 1.0f), FVector2D(-1.0f, 0.0f), FVector2D(0.0f, -1.0f) };
+
+	OutPoints.Reset(8);
+	OutNormals.Reset(8);
+	for (int32 Side = 0; Side < 4; ++Side)
+	{
+		OutPoints.Add(Corners[Side]);
+		OutPoints.Add(Corners[(Side + 1) % 4]);
+		OutNormals.Add(Normals[Side]);
+		OutNormals.Add(Normals[Side]);
+	}
+}
+
+void FLiquidBoxShape::BuildProfile(int32 Resolution, const FVector& Extent, TArray<FLiquidProfilePoint>& OutProfile)
+{
+	LiquidShapeSlicerHelpers::BuildPrismProfile(Extent, OutProfile);
+}
+
+float FLiquidBoxShape::GetVolumeBelow(const FVector& Extent, float Z)
+{
+	float Height = FMath::Clamp(Z + Extent.Z, 0.0f, 2.0f * Extent.Z);
+
+	return 4.0f * Extent.X * Extent.Y * Height;
+}
+
+void FLiquidCylinderShape::BuildPerimeter(int32 Resolution, TArray<FVector2D>& OutPoints, TArray<FVector2D>& OutNormals)
+{
+	LiquidShapeSlicerHelpers::BuildCirclePerimeter(Resolution, OutPoints, OutNormals);
+}
+
+void FLiquidCylinderShape::BuildProfile(int32 Resolution, const FVector& Extent, TArray<FLiquidProfilePoint>& OutProfile)
+{
+	LiquidShapeSlicerHelpers::BuildPrismProfile(Extent, OutProfile);
+}
+
+float FLiquidCylinderShape::GetVolumeBelow(const FVector& Extent, float Z)
+{
+	float Height = FMath::Clamp(Z + Extent.Z, 0.0f, 2.0f * Extent.Z);
+
+	return PI * Extent.X * Extent.Y * Height;
+}
+
+void FLiquidCapsuleShape::BuildPerimeter(int32 Resolution, TArray<FVector2D>& OutPoints, TArray<FVector2D>& OutNormals)
+{
+	LiquidShapeSlicerHelpers::BuildCirclePerimeter(Resolution, OutPoints, OutNormals);
+}
+
+void FLiquidCapsuleShape::BuildProfile(int32 Resolution, const FVector& Extent, TArray<FLiquidProfilePoint>& OutProfile)
+{
+	float Radius = FMath::Min3(Extent.X, Extent.Y, Extent.Z);
+	float HalfCylinder = Extent.Z - Radius;
+	int32 RingsPerCap = FMath::Max(Resolution / 4, 2);
+	float InvRings = 1.0f / float(2 * RingsPerCap + 1);
+
+	// Bottom hemisphere from pole to equator, then top hemisphere from equator to pole
+	OutProfile.Reset(2 * RingsPerCap + 2);
+	for (int32 Half = 0; Half < 2; ++Half)
+	{
+		for (int32 j = 0; j <= RingsPerCap; ++j)
+		{
+			float Angle = (Half == 0) ? (-0.5f * PI + 0.5f * PI * float(j) / float(RingsPerCap)) : (0.5f * PI * float(j) / float(RingsPerCap));
+			float Cos = FMath::Cos(Angle);
+			float Sin = FMath::Sin(Angle);
+			float Z = ((Half == 0) ? -HalfCylinder : HalfCylinder) + Radius * Sin;
+
+			OutProfile.Add({ Cos, Z, FVector2D(Cos, Sin), float(OutProfile.Num()) * InvRings });
+		}
+	}
+}
+
+float FLiquidCapsuleShape::GetVolumeBelow(const FVector& Extent, float Z)
+{
+	float Radius = FMath::Min3(Extent.X, Extent.Y, Extent.Z);
+	float HalfCylinder = Extent.Z - Radius;
+	float Height = FMath::Clamp(Z + Extent.Z, 0.0f, 2.0f * Extent.Z);
+
+	// Volume of unit-area-scaled spherical cap of height H
+	auto GetCapVolume = [Radius](float H)
+	{
+		return H * H / Radius - H * H * H / (3.0f * Radius * Radius);
+	};
+
+	float Total = 4.0f * Radius / 3.0f + 2.0f * HalfCylinder;
+	float Below;
+	if (Height <= Radius)
+	{
+		Below = GetCapVolume(Height);
+	}
+	else if (Height <= Radius + 2.0f * HalfCylinder)
+	{
+		Below = 2.0f * Radius / 3.0f + (Height - Radius);
+	}
+	else
+	{
+		Below = Total - GetCapVolume(2.0f * Extent.Z - Height);
+	}
+
+	return PI * Extent.X * Extent.Y * Below;
+}
@@ -0,0 +1,136 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProceduralMeshComponent.h"
+#include "LiquidShapeSlicer.generated.h"
+
+class UMaterialInterface;
+struct FLiquidSliceBuffers;
+
+// Shape of liquid inside a tank
+UENUM(BlueprintType)
+enum class ELiquidTankShape : uint8
+{
+	// Liquid static mesh is clipped as triangle soup
+	Mesh,
+	// Shapes below are built from liquid mesh bounds, upright along local Z
+	Box,
+	Cylinder,
+	Capsule
+};
+
+// One ring of a shape profile: perimeter scale and height, outward normal in (scale, Z) plane
+struct FLiquidProfilePoint
+{
+	float Scale;
+	float Z;
+	FVector2D Normal;
+	float V;
+};
+
+// Liquid geometry of primitive tank shapes.
+// A shape is a perimeter (unit outline in XY) swept along a profile from bottom centre to top
+// centre. Each perimeter point is a column of profile points. Every ring is classified against the
+// surface plane, as a tilted surface can cross a column twice (e.g. bottom centre above a low fill).
+// Output uses the slice buffer layout of FLiquidSlicer, with fixed topology of (profile rings - 1)
+// quads per column, each clipped as two triangles.
+class FACILITY_API FLiquidShapeSlicer
+{
+public:
+	FLiquidShapeSlicer();
+	virtual ~FLiquidShapeSlicer() {}
+
+	// Creating slicer for shape, returns nullptr for Mesh
+	static TUniquePtr<FLiquidShapeSlicer> Create(ELiquidTankShape Shape, int32 Resolution);
+
+	// Fitting shape into local bounds of liquid mesh
+	virtual void Initialize(const FBox& LocalBounds) = 0;
+
+	// Clipping shape against plane given in mesh local space, keeping the positive half
+	void Slice(const FPlane& LocalPlane, FLiquidSliceBuffers& Buffers) const;
+
+	// Getting volume of horizontal slab under local height Z (measured from shape centre)
+	virtual float GetVolumeBelow(float Z) const = 0;
+
+	// Preallocating buffers for this shape
+	void InitBuffers(FLiquidSliceBuffers& Buffers) const;
+
+	// Creating body and cap sections from sliced buffers
+	void CreateSections(UProceduralMeshComponent* ProcMesh, const FLiquidSliceBuffers& Buffers, UMaterialInterface* Material) const;
+
+	// Pushing sliced buffers into existing sections
+	void UpdateSections(UProceduralMeshComponent* ProcMesh, const FLiquidSliceBuffers& Buffers) const;
+
+	// Getting plane distance along local up vector enclosing volume fraction (0..1).
+	// Exact for box and cylinder while surface stays between bottom and top, as volume of a
+	// prism under a tilted plane only depends on plane height at its centre
+	float GetPlaneDistance(const FVector& LocalUp, float VolumeFraction) const;
+
+	float GetTotalVolume() const { return this->TotalVolume; }
+
+	// Getting half height of shape in local units
+	float GetHalfHeight() const { return this->Extent.Z; }
+
+protected:
+	// Building fixed topology for current perimeter and profile
+	void BuildTopology();
+
+	// Unit outline (counter-clockwise from +Z) and its outward normals
+	TArray<FVector2D> Perimeter;
+	TArray<FVector2D> PerimeterNormals;
+
+	// Rings from bottom centre to top centre
+	TArray<FLiquidProfilePoint> Profile;
+
+	TArray<int32> BodyTriangles;
+	TArray<int32> CapTriangles;
+
+	// Empty optional streams for section calls
+	TArray<FColor> EmptyColors;
+	TArray<FProcMeshTangent> EmptyTangents;
+
+	FVector Center;
+	FVector Extent;
+	float TotalVolume;
+};
+
+// Shape policies, used as compile-time parameter of TLiquidShapeSlicer
+
+struct FLiquidBoxShape
+{
+	static void BuildPerimeter(int32 Resolution, TArray<FVector2D>& OutPoints, TArray<FVector2D>& OutNormals);
+	static void BuildProfile(int32 Resolution, const FVector& Extent, TArray<FLiquidProfilePoint>& OutProfile);
+	static float GetVolumeBelow(const FVector& Extent, float Z);
+};
+
+struct FLiquidCylinderShape
+{
+	static void BuildPerimeter(int32 Resolution, TArray<FVector2D>& OutPoints, TArray<FVector2D>& OutNormals);
+	static void BuildProfile(int32 Resolution, const FVector& Extent, TArray<FLiquidProfilePoint>& OutProfile);
+	static float GetVolumeBelow(const FVector& Extent, float Z);
+};
+
+struct FLiquidCapsuleShape
+{
+	static void BuildPerimeter(int32 Resolution, TArray<FVector2D>& OutPoints, TArray<FVector2D>& OutNormals);
+	static void BuildProfile(int32 Resolution, const FVector& Extent, TArray<FLiquidProfilePoint>& OutProfile);
+	static float GetVolumeBelow(const FVector& Extent, float Z);
+};
+
+template<typename ShapeType>
+class TLiquidShapeSlicer : public FLiquidShapeSlicer
+{
+public:
+	explicit TLiquidShapeSlicer(int32 InResolution)
+		: Resolution(FMath::Max(InResolution, 4))
+	{
+	}
+
+	virtual void Initialize(const FBox& LocalBounds) override;
+	virtual float GetVolumeBelow(float Z) const override;
+
+private:
+	int32 Resolution;
+};
@@ -0,0 +1,336 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LiquidSliceAtlas.h"
+#include "Engine/StaticMesh.h"
+#include "Math/UnrealMathUtility.h"
+#include "Math/Float16.h"
+#include "RenderMath.h"
+#include "Misc/Crc.h"
+
+// Assets
+#include "LiquidSlicer.h"
+#include "LiquidVolumeTable.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogLiquidSliceAtlas, Log, All);
+
+namespace LiquidSliceAtlasHelpers
+{
+	FORCEINLINE uint16 QuantizeUnit(float Value)
+	{
+		return uint16(FMath::Clamp(FMath::RoundToInt(Value * 65535.0f), 0, 65535));
+	}
+
+	FORCEINLINE float DequantizeUnit(uint16 Value)
+	{
+		return float(Value) / 65535.0f;
+	}
+
+	FORCEINLINE uint16 EncodeHalf(float Value)
+	{
+		FFloat16 Half(Value);
+		return Half.Encoded;
+	}
+
+	FORCEINLINE float DecodeHalf(uint16 Value)
+	{
+		FFloat16 Half;
+		Half.Encoded = Value;
+		return Half.GetFloat();
+	}
+}
+
+ULiquidSliceAtlas::ULiquidSliceAtlas()
+{
+	this->SourceMesh = nullptr;
+	this->LODIndex = 0;
+	this->TiltResolution = 5;
+	this->FillResolution = 11;
+	this->MaxTilt = 0.7f;
+	this->MaxMemoryKB = 8192;
+	this->bBlendEntries = false;
+	this->MemoryKB = 0;
+	this->Bounds = FBox(ForceInit);
+	this->BakedTiltResolution = 0;
+	this->BakedFillResolution = 0;
+	this->BakedMaxTilt = 0.0f;
+	this->NumBodySlots = 0;
+	this->NumCapSlots = 0;
+}
+
+int64 ULiquidSliceAtlas::EstimateMemoryBytes(int32 NumEntries, int32 NumBodySlots, int32 NumCapSlots)
+{
+	int64 BodyBytes = int64(NumBodySlots) * (3 * sizeof(uint16) + sizeof(uint32) + 2 * sizeof(uint16));
+	int64 CapBytes = int64(NumCapSlots) * (3 * sizeof(uint16));
+
+	return int64(NumEntries) * (BodyBytes + CapBytes + sizeof(uint32));
+}
+
+bool ULiquidSliceAtlas::IsCompatible(const FLiquidSlicer& Slicer) const
+{
+	return (this->BakedFillResolution > 0) && Slicer.IsInitialized() && (Slicer.GetNumBodySlots() == this->NumBodySlots) && (Slicer.GetNumCapSlots() == this->NumCapSlots);
+}
+
+int32 ULiquidSliceAtlas::GetEntryIndex(int32 CellX, int32 CellY, int32 FillIndex) const
+{
+	return (CellY * this->BakedTiltResolution + CellX) * this->BakedFillResolution + FillIndex;
+}
+
+#if WITH_EDITOR
+void ULiquidSliceAtlas::Bake()
+{
+	FLiquidSlicer Slicer;
+	if (!(Slicer.Initialize(this->SourceMesh, this->LODIndex)))
+	{
+		UE_LOG(LogLiquidSliceAtlas, Error, TEXT("%s: source mesh is missing or has no readable LOD %d"), *GetName(), this->LODIndex);
+		return;
+	}
+
+	// Fill steps are spaced by volume, same as tank fill height
+	TSharedPtr<const FLiquidVolumeTable> VolumeTable = FLiquidVolumeTable::FindOrBake(this->SourceMesh, Slicer);
+	if (!(VolumeTable.IsValid()) || (VolumeTable->GetTotalVolume() <= 0.0f))
+	{
+		UE_LOG(LogLiquidSliceAtlas, Error, TEXT("%s: source mesh has no volume, it has to be closed"), *GetName());
+		return;
+	}
+
+	int32 NumEntries = this->TiltResolution * this->TiltResolution * this->FillResolution;
+	int64 MemoryBytes = EstimateMemoryBytes(NumEntries, Slicer.GetNumBodySlots(), Slicer.GetNumCapSlots());
+	if (MemoryBytes > int64(this->MaxMemoryKB) * 1024)
+	{
+		UE_LOG(LogLiquidSliceAtlas, Error, TEXT("%s: %d entries would take %lld KB, limit is %d KB. Lower resolution or use simpler mesh"), *GetName(), NumEntries, MemoryBytes / 1024, this->MaxMemoryKB);
+		return;
+	}
+
+	Modify();
+
+	this->BakedTiltResolution = this->TiltResolution;
+	this->BakedFillResolution = this->FillResolution;
+	this->BakedMaxTilt = this->MaxTilt;
+	this->NumBodySlots = Slicer.GetNumBodySlots();
+	this->NumCapSlots = Slicer.GetNumCapSlots();
+	this->Bounds = Slicer.GetSourceBounds().ExpandBy(1.0f);
+
+	this->BodyPositions.SetNumZeroed(NumEntries * this->NumBodySlots * 3);
+	this->BodyNormals.SetNumZeroed(NumEntries * this->NumBodySlots);
+	this->BodyUVs.SetNumZeroed(NumEntries * this->NumBodySlots * 2);
+	this->CapPositions.SetNumZeroed(NumEntries * this->NumCapSlots * 3);
+	this->EntryTopology.SetNumZeroed(NumEntries);
+
+	FLiquidSliceBuffers Buffers;
+	Slicer.InitBuffers(Buffers);
+
+	for (int32 CellY = 0; CellY < this->BakedTiltResolution; ++CellY)
+	{
+		for (int32 CellX = 0; CellX < this->BakedTiltResolution; ++CellX)
+		{
+			// Getting up vector of this tilt cell
+			float UpX = FMath::Lerp(-this->BakedMaxTilt, this->BakedMaxTilt, float(CellX) / float(this->BakedTiltResolution - 1));
+			float UpY = FMath::Lerp(-this->BakedMaxTilt, this->BakedMaxTilt, float(CellY) / float(this->BakedTiltResolution - 1));
+			float UpZ = FMath::Sqrt(FMath::Max(0.0f, 1.0f - UpX * UpX - UpY * UpY));
+			FVector Up = FVector(UpX, UpY, UpZ).GetSafeNormal();
+
+			for (int32 FillIndex = 0; FillIndex < this->BakedFillResolution; ++FillIndex)
+			{
+				float Distance = VolumeTable->GetPlaneDistance(Up, float(FillIndex) / float(this->BakedFillResolution - 1));
+				Slicer.Slice(FPlane(-Up, -Distance), Buffers);
+				EncodeEntry(GetEntryIndex(CellX, CellY, FillIndex), Buffers);
+				this->EntryTopology[GetEntryIndex(CellX, CellY, FillIndex)] = GetTopologyHash(Buffers);
+			}
+		}
+	}
+
+	this->MemoryKB = int32(MemoryBytes / 1024);
+	UE_LOG(LogLiquidSliceAtlas, Display, TEXT("%s: baked %d entries of %d body and %d cap slots, %d KB"), *GetName(), NumEntries, this->NumBodySlots, this->NumCapSlots, this->MemoryKB);
+
+	MarkPackageDirty();
+}
+#endif
+
+void ULiquidSliceAtlas::EncodeEntry(int32 Entry, const FLiquidSliceBuffers& Buffers)
+{
+	using namespace LiquidSliceAtlasHelpers;
+
+	FVector BoundsMin = this->Bounds.Min;
+	FVector InvSize = FVector(1.0f) / this->Bounds.GetSize().ComponentMax(FVector(KINDA_SMALL_NUMBER));
+
+	for (int32 Slot = 0; Slot < this->NumBodySlots; ++Slot)
+	{
+		int32 Index = Entry * this->NumBodySlots + Slot;
+		FVector Unit = (Buffers.BodyVertices[Slot] - BoundsMin) * InvSize;
+
+		this->BodyPositions[Index * 3 + 0] = QuantizeUnit(Unit.X);
+		this->BodyPositions[Index * 3 + 1] = QuantizeUnit(Unit.Y);
+		this->BodyPositions[Index * 3 + 2] = QuantizeUnit(Unit.Z);
+		this->BodyNormals[Index] = FPackedNormal(Buffers.BodyNormals[Slot]).Vector.Packed;
+		this->BodyUVs[Index * 2 + 0] = EncodeHalf(Buffers.BodyUVs[Slot].X);
+		this->BodyUVs[Index * 2 + 1] = EncodeHalf(Buffers.BodyUVs[Slot].Y);
+	}
+
+	// Unused cap slots are all zero, they stay degenerate after clamping to bounds
+	for (int32 Slot = 0; Slot < this->NumCapSlots; ++Slot)
+	{
+		int32 Index = Entry * this->NumCapSlots + Slot;
+		FVector Unit = (Buffers.CapVertices[Slot] - BoundsMin) * InvSize;
+
+		this->CapPositions[Index * 3 + 0] = QuantizeUnit(Unit.X);
+		this->CapPositions[Index * 3 + 1] = QuantizeUnit(Unit.Y);
+		this->CapPositions[Index * 3 + 2] = QuantizeUnit(Unit.Z);
+	}
+}
+
+uint32 ULiquidSliceAtlas::GetTopologyHash(const FLiquidSliceBuffers& Buffers)
+{
+	// Same keep test as FLiquidSlicer::Slice
+	TArray<uint32, TInlineAllocator<64>> Bits;
+	Bits.SetNumZeroed(FMath::DivideAndRoundUp(Buffers.Distances.Num(), 32));
+	for (int32 i = 0; i < Buffers.Distances.Num(); ++i)
+	{
+		if (Buffers.Distances[i] > 0.0f)
+		{
+			Bits[i / 32] |= 1u << (i % 32);
+		}
+	}
+
+	return FCrc::MemCrc32(Bits.GetData(), Bits.Num() * sizeof(uint32));
+}
+
+void ULiquidSliceAtlas::AccumulateEntry(int32 Entry, float Weight, bool bIsFirst, FLiquidSliceBuffers& Buffers) const
+{
+	using namespace LiquidSliceAtlasHelpers;
+
+	FVector BoundsMin = this->Bounds.Min;
+	FVector Size = this->Bounds.GetSize();
+
+	const uint16* Positions = this->BodyPositions.GetData() + Entry * this->NumBodySlots * 3;
+	const uint32* Normals = this->BodyNormals.GetData() + Entry * this->NumBodySlots;
+	const uint16* UVs = this->BodyUVs.GetData() + Entry * this->NumBodySlots * 2;
+
+	for (int32 Slot = 0; Slot < this->NumBodySlots; ++Slot)
+	{
+		FVector Position = BoundsMin + Size * FVector(DequantizeUnit(Positions[Slot * 3 + 0]), DequantizeUnit(Positions[Slot * 3 + 1]), DequantizeUnit(Positions[Slot * 3 + 2]));
+
+		FPackedNormal PackedNormal;
+		PackedNormal.Vector.Packed = Normals[Slot];
+		FVector Normal = PackedNormal.ToFVector();
+
+		FVector2D UV(DecodeHalf(UVs[Slot * 2 + 0]), DecodeHalf(UVs[Slot * 2 + 1]));
+
+		if (bIsFirst)
+		{
+			Buffers.BodyVertices[Slot] = Position * Weight;
+			Buffers.BodyNormals[Slot] = Normal * Weight;
+			Buffers.BodyUVs[Slot] = UV * Weight;
+		}
+		else
+		{
+			Buffers.BodyVertices[Slot] += Position * Weight;
+			Buffers.BodyNormals[Slot] += Normal * Weight;
+			Buffers.BodyUVs[Slot] += UV * Weight;
+		}
+	}
+
+	const uint16* CapData = this->CapPositions.GetData() + Entry * this->NumCapSlots * 3;
+	for (int32 Slot = 0; Slot < this->NumCapSlots; ++Slot)
+	{
+		FVector Position = BoundsMin + Size * FVector(DequantizeUnit(CapData[Slot * 3 + 0]), DequantizeUnit(CapData[Slot * 3 + 1]), DequantizeUnit(CapData[Slot * 3 + 2]));
+
+		if (bIsFirst)
+		{
+			Buffers.CapVertices[Slot] = Position * Weight;
+		}
+		else
+		{
+			Buffers.CapVertices[Slot] += Position * Weight;
+		}
+	}
+}
+
+void ULiquidSliceAtlas::Sample(const FVector& LocalUp, float VolumeFraction, FLiquidSliceBuffers& Buffers) const
+{
+	if ((this->BakedFillResolution <= 0) || (Buffers.BodyVertices.Num() != this->NumBodySlots) || (Buffers.CapVertices.Num() != this->NumCapSlots))
+	{
+		return;
+	}
+
+	// Getting grid coordinates of sample
+	float Scale = float(this->BakedTiltResolution - 1) / (2.0f * FMath::Max(this->BakedMaxTilt, KINDA_SMALL_NUMBER));
+	float GridX = FMath::Clamp((LocalUp.X + this->BakedMaxTilt) * Scale, 0.0f, float(this->BakedTiltResolution - 1));
+	float GridY = FMath::Clamp((LocalUp.Y + this->BakedMaxTilt) * Scale, 0.0f, float(this->BakedTiltResolution - 1));
+	float GridF = FMath::Clamp(VolumeFraction, 0.0f, 1.0f) * float(this->BakedFillResolution - 1);
+
+	int32 NearestEntry = GetEntryIndex(FMath::RoundToInt(GridX), FMath::RoundToInt(GridY), FMath::RoundToInt(GridF));
+	bool bCanBlend = this->bBlendEntries && (this->EntryTopology.Num() == this->BakedTiltResolution * this->BakedTiltResolution * this->BakedFillResolution);
+	if (!bCanBlend)
+	{
+		AccumulateEntry(NearestEntry, 1.0f, true, Buffers);
+	}
+	else
+	{
+		int32 X0 = FMath::Min(FMath::FloorToInt(GridX), this->BakedTiltResolution - 2);
+		int32 Y0 = FMath::Min(FMath::FloorToInt(GridY), this->BakedTiltResolution - 2);
+		int32 F0 = FMath::Min(FMath::FloorToInt(GridF), this->BakedFillResolution - 2);
+		float AlphaX = GridX - X0;
+		float AlphaY = GridY - Y0;
+		float AlphaF = GridF - F0;
+
+		// Picking corners of grid cell that cross same edges as nearest one (nearest is always among them)
+		uint32 NearestTopology = this->EntryTopology[NearestEntry];
+		int32 CornerEntries[8];
+		float CornerWeights[8];
+		float TotalWeight = 0.0f;
+		for (int32 Corner = 0; Corner < 8; ++Corner)
+		{
+			int32 DX = Corner & 1;
+			int32 DY = (Corner >> 1) & 1;
+			int32 DF = (Corner >> 2) & 1;
+			CornerEntries[Corner] = GetEntryIndex(X0 + DX, Y0 + DY, F0 + DF);
+			CornerWeights[Corner] = (DX ? AlphaX : 1.0f - AlphaX) * (DY ? AlphaY : 1.0f - AlphaY) * (DF ? AlphaF : 1.0f - AlphaF);
+			if (this->EntryTopology[CornerEntries[Corner]] != NearestTopology)
+			{
+				CornerWeights[Corner] = 0.0f;
+			}
+			TotalWeight += CornerWeights[Corner];
+		}
+
+		// Blending matching corners, skipping ones that do not contribute
+		bool bIsFirst = true;
+		for (int32 Corner = 0; Corner < 8; ++Corner)
+		{
+			float Weight = CornerWeights[Corner] / TotalWeight;
+			if (Weight <= KINDA_SMALL_NUMBER)
+			{
+				continue;
+			}
+
+			AccumulateEntry(CornerEntries[Corner], Weight, bIsFirst, Buffers);
+			bIsFirst = false;
+		}
+
+		for (FVector& Normal : Buffers.BodyNormals)
+		{
+			Normal = Normal.GetSafeNormal();
+		}
+	}
+
+	// Cap faces along surface up vector, UVs span source bounds like sliced caps
+	FVector CapNormal = LocalUp.GetSafeNormal();
+	FVector SourceMin = this->Bounds.Min + FVector(1.0f);
+	FVector SourceSize = (this->Bounds.GetSize() - FVector(2.0f)).ComponentMax(FVector(KINDA_SMALL_NUMBER));
+	for (int32 Slot = 0; Slot < this->NumCapSlots; ++Slot)
+	{
+		const FVector& P = Buffers.CapVertices[Slot];
+		Buffers.CapNormals[Slot] = CapNormal;
+		Buffers.CapUVs[Slot] = FVector2D((P.X - SourceMin.X) / SourceSize.X, (P.Y - SourceMin.Y) / SourceSize.Y);
+	}
+}
+
+void ULiquidSliceAtlas::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(this->BodyPositions.GetAllocatedSize());
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(this->BodyNormals.GetAllocatedSize());
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(this->BodyUVs.GetAllocatedSize());
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(this->CapPositions.GetAllocatedSize());
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(this->EntryTopology.GetAllocatedSize());
+}
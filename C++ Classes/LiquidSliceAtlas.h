@@ -0,0 +1,122 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "LiquidSliceAtlas.generated.h"
+
+class UStaticMesh;
+class FLiquidSlicer;
+struct FLiquidSliceBuffers;
+
+// Liquid mesh pre-sliced over a grid of surface tilts and fill volumes.
+// Entries use the fixed slot layout of FLiquidSlicer, but a slot only holds the same piece of
+// liquid in entries where the surface crosses the same source edges. Blending is therefore limited
+// to entries sharing crossing topology with the nearest one. Body vertices are stored quantized
+// (position 6 bytes, normal 4, UV 4), cap vertices keep only position.
+UCLASS(BlueprintType)
+class FACILITY_API ULiquidSliceAtlas : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	ULiquidSliceAtlas();
+
+	// Liquid mesh to bake (needs to be the mesh of tank liquid static mesh component)
+	UPROPERTY(EditAnywhere, Category = "Bake")
+	UStaticMesh* SourceMesh;
+
+	UPROPERTY(EditAnywhere, Category = "Bake", meta = (ClampMin = "0"))
+	int32 LODIndex;
+
+	// Tilt grid size per axis
+	UPROPERTY(EditAnywhere, Category = "Bake", meta = (ClampMin = "2", ClampMax = "15"))
+	int32 TiltResolution;
+
+	// Fill volume steps from empty to full
+	UPROPERTY(EditAnywhere, Category = "Bake", meta = (ClampMin = "2", ClampMax = "64"))
+	int32 FillResolution;
+
+	// Largest baked tilt (sine of angle), steeper surfaces are clamped
+	UPROPERTY(EditAnywhere, Category = "Bake", meta = (ClampMin = "0.0", ClampMax = "0.95"))
+	float MaxTilt;
+
+	// Bake is refused if baked data would not fit
+	UPROPERTY(EditAnywhere, Category = "Bake", meta = (ClampMin = "1"))
+	int32 MaxMemoryKB;
+
+	// Blending nearest entries that share crossing topology, otherwise nearest entry is used as is
+	UPROPERTY(EditAnywhere, Category = "Runtime")
+	bool bBlendEntries;
+
+	// Size of baked data
+	UPROPERTY(VisibleAnywhere, Category = "Bake")
+	int32 MemoryKB;
+
+#if WITH_EDITOR
+	// Slicing source mesh for every grid entry
+	UFUNCTION(CallInEditor, Category = "Bake")
+	void Bake();
+#endif
+
+	// Getting memory needed for atlas of given size
+	static int64 EstimateMemoryBytes(int32 NumEntries, int32 NumBodySlots, int32 NumCapSlots);
+
+	// Checking if baked slot layout matches slicer
+	bool IsCompatible(const FLiquidSlicer& Slicer) const;
+
+	// Writing blended entries for local up vector and volume fraction (0..1) into slice buffers
+	void Sample(const FVector& LocalUp, float VolumeFraction, FLiquidSliceBuffers& Buffers) const;
+
+	virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
+
+protected:
+	int32 GetEntryIndex(int32 CellX, int32 CellY, int32 FillIndex) const;
+
+	// Adding one entry scaled by weight into buffers (first entry overwrites)
+	void AccumulateEntry(int32 Entry, float Weight, bool bIsFirst, FLiquidSliceBuffers& Buffers) const;
+
+	// Quantizing slice buffers into entry
+	void EncodeEntry(int32 Entry, const FLiquidSliceBuffers& Buffers);
+
+	// Hashing which source vertices are under the surface, entries with same hash cross same edges
+	static uint32 GetTopologyHash(const FLiquidSliceBuffers& Buffers);
+
+	// Quantization box of positions (source bounds)
+	UPROPERTY()
+	FBox Bounds;
+
+	// Grid used by last bake (edited settings only apply after next bake)
+	UPROPERTY()
+	int32 BakedTiltResolution;
+
+	UPROPERTY()
+	int32 BakedFillResolution;
+
+	UPROPERTY()
+	float BakedMaxTilt;
+
+	UPROPERTY()
+	int32 NumBodySlots;
+
+	UPROPERTY()
+	int32 NumCapSlots;
+
+	// Baked entries, fill index runs fastest, then tilt X, then tilt Y
+	UPROPERTY()
+	TArray<uint16> BodyPositions;
+
+	UPROPERTY()
+	TArray<uint32> BodyNormals;
+
+	UPROPERTY()
+	TArray<uint16> BodyUVs;
+
+	UPROPERTY()
+	TArray<uint16> CapPositions;
+
+	// Crossing topology of every entry (missing in atlases baked before it, which are never blended)
+	UPROPERTY()
+	TArray<uint32> EntryTopology;
+};
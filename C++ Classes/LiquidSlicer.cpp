@@ -0,0 +1,509 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LiquidSlicer.h"
+#include "Engine/StaticMesh.h"
+#include "Materials/MaterialInterface.h"
+#include "KismetProceduralMeshLibrary.h"
+#include "Math/UnrealMathUtility.h"
+
+// Assets
+#include "LiquidSurface.h"
+#include "LiquidVolumeTable.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogLiquidSlicer, Log, All);
+
+namespace LiquidSlicerHelpers
+{
+	// Writing one vertex into buffer slot
+	FORCEINLINE void WriteVertex(FVector* OutPos, FVector* OutNorm, FVector2D* OutUV, int32 Slot, const FVector& Pos, const FVector& Norm, const FVector2D& UV)
+	{
+		OutPos[Slot] = Pos;
+		OutNorm[Slot] = Norm;
+		OutUV[Slot] = UV;
+	}
+
+	// Getting grid coordinates of triangles splitting a triangle into Level^2 pieces, in slot order
+	void BuildSubdivisionCoords(int32 Level, TArray<FIntPoint>& OutCoords)
+	{
+		OutCoords.Reset(Level * Level * 3);
+
+		for (int32 i = 0; i < Level; ++i)
+		{
+			for (int32 j = 0; j < Level - i; ++j)
+			{
+				OutCoords.Add(FIntPoint(i, j));
+				OutCoords.Add(FIntPoint(i + 1, j));
+				OutCoords.Add(FIntPoint(i, j + 1));
+
+				if (j < Level - i - 1)
+				{
+					OutCoords.Add(FIntPoint(i + 1, j));
+					OutCoords.Add(FIntPoint(i + 1, j + 1));
+					OutCoords.Add(FIntPoint(i, j + 1));
+				}
+			}
+		}
+	}
+
+	// Checking that no vertex lies clearly on both sides of any triangle plane.
+	// Every plane cut of a convex mesh is convex, so its cap can be built as a fan
+	bool IsConvex(const TArray<FVector>& Vertices, const TArray<int32>& Indices, float Tolerance)
+	{
+		for (int32 Tri = 0; Tri + 2 < Indices.Num(); Tri += 3)
+		{
+			const FVector& P0 = Vertices[Indices[Tri]];
+			FVector Normal = FVector::CrossProduct(Vertices[Indices[Tri + 1]] - P0, Vertices[Indices[Tri + 2]] - P0);
+
+			// Skipping degenerate triangles
+			if (!(Normal.Normalize()))
+			{
+				continue;
+			}
+
+			bool bHasFront = false;
+			bool bHasBack = false;
+			for (const FVector& Vertex : Vertices)
+			{
+				float Distance = FVector::DotProduct(Vertex - P0, Normal);
+				bHasFront |= (Distance > Tolerance);
+				bHasBack |= (Distance < -Tolerance);
+
+				if (bHasFront && bHasBack)
+				{
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+}
+
+FLiquidSlicer::FLiquidSlicer()
+{
+	this->SourceBounds = FBox(ForceInit);
+	this->NumSourceTriangles = 0;
+	this->CapSubdivision = 1;
+	this->bCrossIsFrontFace = true;
+	this->bIsInitialized = false;
+
+	LiquidSlicerHelpers::BuildSubdivisionCoords(this->CapSubdivision, this->CapSlotCoords);
+}
+
+void FLiquidSlicer::SetCapSubdivision(int32 Level)
+{
+	check(!(this->bIsInitialized));
+
+	this->CapSubdivision = FMath::Clamp(Level, 1, 8);
+	LiquidSlicerHelpers::BuildSubdivisionCoords(this->CapSubdivision, this->CapSlotCoords);
+}
+
+bool FLiquidSlicer::Initialize(UStaticMesh* SourceMesh, int32 LODIndex)
+{
+	this->bIsInitialized = false;
+
+	if (SourceMesh == nullptr)
+	{
+		return false;
+	}
+
+	TArray<FVector> AllVertices;
+	TArray<FVector> AllNormals;
+	TArray<FVector2D> AllUVs;
+	TArray<int32> AllIndices;
+
+	TArray<FVector> SectionVertices;
+	TArray<int32> SectionTriangles;
+	TArray<FVector> SectionNormals;
+	TArray<FVector2D> SectionUVs;
+	TArray<FProcMeshTangent> SectionTangents;
+
+	// Gathering all sections of requested LOD into one vertex list
+	int32 NumSections = SourceMesh->GetNumSections(LODIndex);
+	for (int32 SectionIndex = 0; SectionIndex < NumSections; ++SectionIndex)
+	{
+		UKismetProceduralMeshLibrary::GetSectionFromStaticMesh(SourceMesh, LODIndex, SectionIndex, SectionVertices, SectionTriangles, SectionNormals, SectionUVs, SectionTangents);
+
+		int32 BaseIndex = AllVertices.Num();
+		AllVertices.Append(SectionVertices);
+		AllNormals.Append(SectionNormals);
+		AllUVs.Append(SectionUVs);
+
+		// Normals and UVs are optional in source data
+		AllNormals.SetNumZeroed(AllVertices.Num());
+		AllUVs.SetNumZeroed(AllVertices.Num());
+
+		for (int32 Index : SectionTriangles)
+		{
+			AllIndices.Add(BaseIndex + Index);
+		}
+	}
+
+	int32 NumVerts = AllVertices.Num();
+	if ((NumVerts == 0) || (AllIndices.Num() < 3))
+	{
+		return false;
+	}
+
+	// Concave meshes can have concave cuts, leaving them to SliceProceduralMesh which triangulates its cap
+	// Scan is O(triangles * vertices), so it runs once per mesh LOD and is shared by all tanks
+	bool bIsConvex = FLiquidVolumeTable::FindOrComputeConvexity(SourceMesh, LODIndex, [&AllVertices, &AllIndices, SourceMesh, LODIndex]()
+	{
+		float ConvexTolerance = FBox(AllVertices).GetSize().GetMax() * 0.001f;
+		bool bMeshIsConvex = LiquidSlicerHelpers::IsConvex(AllVertices, AllIndices, ConvexTolerance);
+		UE_CLOG(!bMeshIsConvex, LogLiquidSlicer, Warning, TEXT("%s LOD %d is not convex, using SliceProceduralMesh instead"), *SourceMesh->GetName(), LODIndex);
+		return bMeshIsConvex;
+	});
+
+	if (!bIsConvex)
+	{
+		return false;
+	}
+
+	// Splitting positions into SoA
+	this->PosX.SetNumUninitialized(NumVerts);
+	this->PosY.SetNumUninitialized(NumVerts);
+	this->PosZ.SetNumUninitialized(NumVerts);
+	this->SourceBounds = FBox(ForceInit);
+	for (int32 i = 0; i < NumVerts; ++i)
+	{
+		this->PosX[i] = AllVertices[i].X;
+		this->PosY[i] = AllVertices[i].Y;
+		this->PosZ[i] = AllVertices[i].Z;
+		this->SourceBounds += AllVertices[i];
+	}
+
+	this->Normals = MoveTemp(AllNormals);
+	this->UVs = MoveTemp(AllUVs);
+	this->Indices = MoveTemp(AllIndices);
+	this->NumSourceTriangles = this->Indices.Num() / 3;
+
+	// Detecting winding convention of source mesh
+	float WindingSum = 0.0f;
+	for (int32 Tri = 0; Tri < this->NumSourceTriangles; ++Tri)
+	{
+		int32 I0 = this->Indices[Tri * 3 + 0];
+		int32 I1 = this->Indices[Tri * 3 + 1];
+		int32 I2 = this->Indices[Tri * 3 + 2];
+
+		FVector GeoNormal = FVector::CrossProduct(AllVertices[I1] - AllVertices[I0], AllVertices[I2] - AllVertices[I0]);
+		WindingSum += FVector::DotProduct(GeoNormal, this->Normals[I0] + this->Normals[I1] + this->Normals[I2]);
+	}
+	this->bCrossIsFrontFace = (WindingSum >= 0.0f);
+
+	// Building fixed topology (every slot block is its own triangle list)
+	this->BodyTriangles.SetNumUninitialized(this->NumSourceTriangles * 6);
+	for (int32 i = 0; i < this->BodyTriangles.Num(); ++i)
+	{
+		this->BodyTriangles[i] = i;
+	}
+
+	this->CapTriangles.SetNumUninitialized(this->NumSourceTriangles * this->CapSlotCoords.Num());
+	for (int32 i = 0; i < this->CapTriangles.Num(); ++i)
+	{
+		this->CapTriangles[i] = i;
+	}
+
+	this->bIsInitialized = true;
+
+	return true;
+}
+
+void FLiquidSlicer::InitBuffers(FLiquidSliceBuffers& Buffers) const
+{
+	int32 NumBodySlots = this->NumSourceTriangles * 6;
+	int32 NumCapSlots = this->NumSourceTriangles * this->CapSlotCoords.Num();
+
+	Buffers.BodyVertices.SetNumZeroed(NumBodySlots);
+	Buffers.BodyNormals.SetNumZeroed(NumBodySlots);
+	Buffers.BodyUVs.SetNumZeroed(NumBodySlots);
+
+	Buffers.CapVertices.SetNumZeroed(NumCapSlots);
+	Buffers.CapNormals.SetNumZeroed(NumCapSlots);
+	Buffers.CapUVs.SetNumZeroed(NumCapSlots);
+
+	Buffers.Distances.SetNumZeroed(this->PosX.Num());
+	Buffers.CrossingTriangles.Reset(this->NumSourceTriangles);
+}
+
+void FLiquidSlicer::Slice(const FPlane& LocalPlane, FLiquidSliceBuffers& Buffers) const
+{
+	using namespace LiquidSlicerHelpers;
+
+	check(Buffers.Distances.Num() == this->PosX.Num());
+
+	// Getting signed distances of all source vertices
+	int32 NumVerts = this->PosX.Num();
+	float* RESTRICT Dist = Buffers.Distances.GetData();
+	const float* RESTRICT X = this->PosX.GetData();
+	const float* RESTRICT Y = this->PosY.GetData();
+	const float* RESTRICT Z = this->PosZ.GetData();
+	float NX = LocalPlane.X;
+	float NY = LocalPlane.Y;
+	float NZ = LocalPlane.Z;
+	float W = LocalPlane.W;
+	for (int32 i = 0; i < NumVerts; ++i)
+	{
+		Dist[i] = X[i] * NX + Y[i] * NY + Z[i] * NZ - W;
+	}
+
+	FVector* BodyPos = Buffers.BodyVertices.GetData();
+	FVector* BodyNorm = Buffers.BodyNormals.GetData();
+	FVector2D* BodyUV = Buffers.BodyUVs.GetData();
+	FVector* CapPos = Buffers.CapVertices.GetData();
+	FVector* CapNorm = Buffers.CapNormals.GetData();
+	FVector2D* CapUV = Buffers.CapUVs.GetData();
+
+	Buffers.CrossingTriangles.Reset();
+	FVector CentroidSum = FVector::ZeroVector;
+	int32 CapBlockSize = this->CapSlotCoords.Num();
+
+	// Clipping triangles
+	for (int32 Tri = 0; Tri < this->NumSourceTriangles; ++Tri)
+	{
+		int32 I[3] = { this->Indices[Tri * 3 + 0], this->Indices[Tri * 3 + 1], this->Indices[Tri * 3 + 2] };
+		// Same keep test as SliceProceduralMesh, vertices on the plane are cut away
+		bool bKept[3] = { Dist[I[0]] > 0.0f, Dist[I[1]] > 0.0f, Dist[I[2]] > 0.0f };
+		int32 KeptCount = int32(bKept[0]) + int32(bKept[1]) + int32(bKept[2]);
+
+		int32 BodyBase = Tri * 6;
+		int32 CapBase = Tri * CapBlockSize;
+
+		if ((KeptCount == 0) || (KeptCount == 3))
+		{
+			FVector P0(X[I[0]], Y[I[0]], Z[I[0]]);
+
+			if (KeptCount == 3)
+			{
+				// Whole triangle is under the surface
+				for (int32 k = 0; k < 3; ++k)
+				{
+					WriteVertex(BodyPos, BodyNorm, BodyUV, BodyBase + k, FVector(X[I[k]], Y[I[k]], Z[I[k]]), this->Normals[I[k]], this->UVs[I[k]]);
+				}
+			}
+			else
+			{
+				// Whole triangle is above the surface
+				for (int32 k = 0; k < 3; ++k)
+				{
+					WriteVertex(BodyPos, BodyNorm, BodyUV, BodyBase + k, P0, this->Normals[I[0]], this->UVs[I[0]]);
+				}
+			}
+
+			// Collapsing unused slots
+			for (int32 k = 3; k < 6; ++k)
+			{
+				WriteVertex(BodyPos, BodyNorm, BodyUV, BodyBase + k, P0, this->Normals[I[0]], this->UVs[I[0]]);
+			}
+			for (int32 k = 0; k < CapBlockSize; ++k)
+			{
+				WriteVertex(CapPos, CapNorm, CapUV, CapBase + k, FVector::ZeroVector, FVector::ZeroVector, FVector2D::ZeroVector);
+			}
+
+			continue;
+		}
+
+		// Rotating triangle so that lone vertex comes first (kept one for 1 kept, dropped one for 2 kept)
+		bool bLoneIsKept = (KeptCount == 1);
+		int32 Lone = 0;
+		for (int32 k = 0; k < 3; ++k)
+		{
+			if (bKept[k] == bLoneIsKept)
+			{
+				Lone = k;
+				break;
+			}
+		}
+
+		int32 A = I[Lone];
+		int32 B = I[(Lone + 1) % 3];
+		int32 C = I[(Lone + 2) % 3];
+
+		FVector PA(X[A], Y[A], Z[A]);
+		FVector PB(X[B], Y[B], Z[B]);
+		FVector PC(X[C], Y[C], Z[C]);
+
+		// Getting intersection points on edges AB and AC
+		float TAB = Dist[A] / (Dist[A] - Dist[B]);
+		float TAC = Dist[A] / (Dist[A] - Dist[C]);
+
+		FVector PAB = FMath::Lerp(PA, PB, TAB);
+		FVector PAC = FMath::Lerp(PA, PC, TAC);
+		FVector NAB = FMath::Lerp(this->Normals[A], this->Normals[B], TAB).GetSafeNormal();
+		FVector NAC = FMath::Lerp(this->Normals[A], this->Normals[C], TAC).GetSafeNormal();
+		FVector2D UVAB = FMath::Lerp(this->UVs[A], this->UVs[B], TAB);
+		FVector2D UVAC = FMath::Lerp(this->UVs[A], this->UVs[C], TAC);
+
+		if (bLoneIsKept)
+		{
+			// One vertex under the surface: triangle (A, AB, AC)
+			WriteVertex(BodyPos, BodyNorm, BodyUV, BodyBase + 0, PA, this->Normals[A], this->UVs[A]);
+			WriteVertex(BodyPos, BodyNorm, BodyUV, BodyBase + 1, PAB, NAB, UVAB);
+			WriteVertex(BodyPos, BodyNorm, BodyUV, BodyBase + 2, PAC, NAC, UVAC);
+			for (int32 k = 3; k < 6; ++k)
+			{
+				WriteVertex(BodyPos, BodyNorm, BodyUV, BodyBase + k, PA, this->Normals[A], this->UVs[A]);
+			}
+		}
+		else
+		{
+			// Two vertices under the surface: quad (AB, B, C, AC)
+			WriteVertex(BodyPos, BodyNorm, BodyUV, BodyBase + 0, PAB, NAB, UVAB);
+			WriteVertex(BodyPos, BodyNorm, BodyUV, BodyBase + 1, PB, this->Normals[B], this->UVs[B]);
+			WriteVertex(BodyPos, BodyNorm, BodyUV, BodyBase + 2, PC, this->Normals[C], this->UVs[C]);
+			WriteVertex(BodyPos, BodyNorm, BodyUV, BodyBase + 3, PAB, NAB, UVAB);
+			WriteVertex(BodyPos, BodyNorm, BodyUV, BodyBase + 4, PC, this->Normals[C], this->UVs[C]);
+			WriteVertex(BodyPos, BodyNorm, BodyUV, BodyBase + 5, PAC, NAC, UVAC);
+		}
+
+		// Storing cut segment, cap centre is filled in after all segments are known
+		CapPos[CapBase + 1] = PAB;
+		CapPos[CapBase + 2] = PAC;
+		CentroidSum += PAB + PAC;
+		Buffers.CrossingTriangles.Add(Tri);
+	}
+
+	// Building cap as a fan around centre of the cut outline
+	int32 NumCrossing = Buffers.CrossingTriangles.Num();
+	if (NumCrossing == 0)
+	{
+		return;
+	}
+
+	FVector Centroid = CentroidSum / float(NumCrossing * 2);
+	FVector CapNormal = -FVector(LocalPlane.X, LocalPlane.Y, LocalPlane.Z).GetSafeNormal();
+	float InvLevel = 1.0f / float(this->CapSubdivision);
+
+	for (int32 Tri : Buffers.CrossingTriangles)
+	{
+		int32 CapBase = Tri * CapBlockSize;
+
+		FVector EdgeB = CapPos[CapBase + 1] - Centroid;
+		FVector EdgeC = CapPos[CapBase + 2] - Centroid;
+
+		// Keeping cap front face pointing away from the liquid
+		FVector GeoNormal = FVector::CrossProduct(EdgeB, EdgeC);
+		bool bFacesOut = (FVector::DotProduct(GeoNormal, CapNormal) >= 0.0f);
+		if (bFacesOut != this->bCrossIsFrontFace)
+		{
+			Swap(EdgeB, EdgeC);
+		}
+
+		// Filling block with fan triangle (split into smaller ones for surface displacement)
+		for (int32 k = 0; k < CapBlockSize; ++k)
+		{
+			const FIntPoint& Coord = this->CapSlotCoords[k];
+			FVector P = Centroid + EdgeB * (Coord.X * InvLevel) + EdgeC * (Coord.Y * InvLevel);
+			WriteVertex(CapPos, CapNorm, CapUV, CapBase + k, P, CapNormal, GetCapUV(P));
+		}
+	}
+}
+
+FVector2D FLiquidSlicer::GetCapUV(const FVector& LocalPosition) const
+{
+	FVector BoundsMin = this->SourceBounds.Min;
+	FVector BoundsSize = this->SourceBounds.GetSize().ComponentMax(FVector(KINDA_SMALL_NUMBER));
+
+	return FVector2D((LocalPosition.X - BoundsMin.X) / BoundsSize.X, (LocalPosition.Y - BoundsMin.Y) / BoundsSize.Y);
+}
+
+void FLiquidSlicer::DisplaceCap(FLiquidSliceBuffers& Buffers, const FLiquidSurfaceHeightfield& Surface, float WaveHeight) const
+{
+	if (!(Surface.IsAwake()))
+	{
+		return;
+	}
+
+	FVector* CapPos = Buffers.CapVertices.GetData();
+	FVector* CapNorm = Buffers.CapNormals.GetData();
+	const FVector2D* CapUV = Buffers.CapUVs.GetData();
+
+	// Converting slope per UV unit into slope per mesh unit
+	FVector BoundsSize = this->SourceBounds.GetSize().ComponentMax(FVector(KINDA_SMALL_NUMBER));
+	FVector2D SlopeScale(WaveHeight / BoundsSize.X, WaveHeight / BoundsSize.Y);
+
+	int32 CapBlockSize = this->CapSlotCoords.Num();
+	for (int32 Tri : Buffers.CrossingTriangles)
+	{
+		int32 CapBase = Tri * CapBlockSize;
+
+		for (int32 k = 0; k < CapBlockSize; ++k)
+		{
+			// Outline vertices are shared with top edge of liquid body
+			const FIntPoint& Coord = this->CapSlotCoords[k];
+			if (Coord.X + Coord.Y == this->CapSubdivision)
+			{
+				continue;
+			}
+
+			int32 Slot = CapBase + k;
+
+			float SurfaceHeight;
+			FVector2D Slope;
+			Surface.Sample(CapUV[Slot], SurfaceHeight, Slope);
+
+			FVector Up = CapNorm[Slot];
+			CapPos[Slot] += Up * (SurfaceHeight * WaveHeight);
+			CapNorm[Slot] = (Up - FVector(Slope.X * SlopeScale.X, Slope.Y * SlopeScale.Y, 0.0f)).GetSafeNormal();
+		}
+	}
+}
+
+void FLiquidSlicer::GetProjectionRange(const FVector& Direction, float& OutMin, float& OutMax) const
+{
+	OutMin = MAX_flt;
+	OutMax = -MAX_flt;
+
+	int32 NumVerts = this->PosX.Num();
+	for (int32 i = 0; i < NumVerts; ++i)
+	{
+		float Projection = this->PosX[i] * Direction.X + this->PosY[i] * Direction.Y + this->PosZ[i] * Direction.Z;
+		OutMin = FMath::Min(OutMin, Projection);
+		OutMax = FMath::Max(OutMax, Projection);
+	}
+}
+
+float FLiquidSlicer::ComputeVolume(const FLiquidSliceBuffers& Buffers)
+{
+	// Summing signed tetrahedron volumes, degenerate slots add nothing
+	auto SumTriangleList = [](const TArray<FVector>& Vertices)
+	{
+		float Sum = 0.0f;
+		for (int32 i = 0; i + 2 < Vertices.Num(); i += 3)
+		{
+			Sum += FVector::DotProduct(Vertices[i], FVector::CrossProduct(Vertices[i + 1], Vertices[i + 2]));
+		}
+		return Sum;
+	};
+
+	float SignedVolume = SumTriangleList(Buffers.BodyVertices) + SumTriangleList(Buffers.CapVertices);
+
+	return FMath::Abs(SignedVolume) / 6.0f;
+}
+
+void FLiquidSlicer::CreateSections(UProceduralMeshComponent* ProcMesh, const FLiquidSliceBuffers& Buffers, UMaterialInterface* Material) const
+{
+	if (ProcMesh == nullptr)
+	{
+		return;
+	}
+
+	ProcMesh->ClearAllMeshSections();
+
+	ProcMesh->CreateMeshSection(LSS_Body, Buffers.BodyVertices, this->BodyTriangles, Buffers.BodyNormals, Buffers.BodyUVs, this->EmptyColors, this->EmptyTangents, false);
+	ProcMesh->CreateMeshSection(LSS_Cap, Buffers.CapVertices, this->CapTriangles, Buffers.CapNormals, Buffers.CapUVs, this->EmptyColors, this->EmptyTangents, false);
+
+	ProcMesh->SetMaterial(LSS_Body, Material);
+	ProcMesh->SetMaterial(LSS_Cap, Material);
+}
+
+void FLiquidSlicer::UpdateSections(UProceduralMeshComponent* ProcMesh, const FLiquidSliceBuffers& Buffers) const
+{
+	if (ProcMesh == nullptr)
+	{
+		return;
+	}
+
+	ProcMesh->UpdateMeshSection(LSS_Body, Buffers.BodyVertices, Buffers.BodyNormals, Buffers.BodyUVs, this->EmptyColors, this->EmptyTangents);
+	ProcMesh->UpdateMeshSection(LSS_Cap, Buffers.CapVertices, Buffers.CapNormals, Buffers.CapUVs, this->EmptyColors, this->EmptyTangents);
+}
@@ -0,0 +1,121 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProceduralMeshComponent.h"
+
+class UStaticMesh;
+class UMaterialInterface;
+class FLiquidSurfaceHeightfield;
+
+// Section indices used by the slicer inside the liquid procedural mesh
+enum ELiquidSliceSection
+{
+	LSS_Body = 0,
+	LSS_Cap = 1
+};
+
+// Output of one slice. Buffers keep a fixed size, so they are allocated once and rewritten in place
+struct FLiquidSliceBuffers
+{
+	// Liquid body section (6 vertex slots per source triangle)
+	TArray<FVector> BodyVertices;
+	TArray<FVector> BodyNormals;
+	TArray<FVector2D> BodyUVs;
+
+	// Cap section (3 vertex slots per source triangle and cap subdivision level squared)
+	TArray<FVector> CapVertices;
+	TArray<FVector> CapNormals;
+	TArray<FVector2D> CapUVs;
+
+	// Scratch data
+	TArray<float> Distances;
+	TArray<int32> CrossingTriangles;
+};
+
+// Clips a cached copy of the liquid static mesh against the surface plane.
+// Source vertex data is extracted once, every slice only rewrites preallocated buffers.
+// Topology is fixed: each source triangle owns a block of vertex slots that is either
+// filled with the clipped triangles or collapsed to a degenerate triangle, which lets us
+// push new data with UpdateMeshSection instead of recreating sections every frame.
+// Cap is a fan around the centre of the cut outline, which is only valid for convex cross
+// sections, so Initialize refuses non-convex meshes and the tank falls back to SliceProceduralMesh.
+class FACILITY_API FLiquidSlicer
+{
+public:
+	FLiquidSlicer();
+
+	// Setting how many times cap triangles are split per edge (call before Initialize)
+	void SetCapSubdivision(int32 Level);
+
+	// Extracting vertex and index buffers from static mesh LOD (mesh needs CPU access in cooked builds).
+	// Returns false if mesh is not convex, as the fan cap would overlap itself
+	bool Initialize(UStaticMesh* SourceMesh, int32 LODIndex);
+
+	// Preallocating buffers for this slicer
+	void InitBuffers(FLiquidSliceBuffers& Buffers) const;
+
+	// Clipping cached mesh against plane given in mesh local space, keeping the positive half
+	void Slice(const FPlane& LocalPlane, FLiquidSliceBuffers& Buffers) const;
+
+	// Moving inner cap vertices along cap normal by surface heights (outline stays on liquid body)
+	void DisplaceCap(FLiquidSliceBuffers& Buffers, const FLiquidSurfaceHeightfield& Surface, float WaveHeight) const;
+
+	// Creating body and cap sections from sliced buffers
+	void CreateSections(UProceduralMeshComponent* ProcMesh, const FLiquidSliceBuffers& Buffers, UMaterialInterface* Material) const;
+
+	// Pushing sliced buffers into existing sections
+	void UpdateSections(UProceduralMeshComponent* ProcMesh, const FLiquidSliceBuffers& Buffers) const;
+
+	// Getting min and max projection of source vertices onto direction
+	void GetProjectionRange(const FVector& Direction, float& OutMin, float& OutMax) const;
+
+	// Getting volume enclosed by sliced body and cap (source mesh has to be closed)
+	static float ComputeVolume(const FLiquidSliceBuffers& Buffers);
+
+	// Getting cap UV (0..1 over source bounds in X and Y) of point in mesh space
+	FVector2D GetCapUV(const FVector& LocalPosition) const;
+
+	bool IsInitialized() const { return this->bIsInitialized; }
+
+	int32 GetNumSourceTriangles() const { return this->NumSourceTriangles; }
+
+	int32 GetNumBodySlots() const { return this->NumSourceTriangles * 6; }
+
+	int32 GetNumCapSlots() const { return this->NumSourceTriangles * this->CapSlotCoords.Num(); }
+
+	const FBox& GetSourceBounds() const { return this->SourceBounds; }
+
+private:
+	// Source positions (SoA, hot in distance pass)
+	TArray<float> PosX;
+	TArray<float> PosY;
+	TArray<float> PosZ;
+
+	// Source attributes
+	TArray<FVector> Normals;
+	TArray<FVector2D> UVs;
+	TArray<int32> Indices;
+
+	// Fixed section topology
+	TArray<int32> BodyTriangles;
+	TArray<int32> CapTriangles;
+
+	// Empty optional streams for section calls
+	TArray<FColor> EmptyColors;
+	TArray<FProcMeshTangent> EmptyTangents;
+
+	// Barycentric grid coordinates of every slot in a cap block
+	TArray<FIntPoint> CapSlotCoords;
+
+	FBox SourceBounds;
+
+	int32 NumSourceTriangles;
+	int32 CapSubdivision;
+
+	// True if cross(B - A, C - A) points along the front face of source triangles
+	bool bCrossIsFrontFace;
+
+	bool bIsInitialized;
+};
@@ -0,0 +1,94 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LiquidSlosh.h"
+#include "Math/UnrealMathUtility.h"
+#include "Math/VectorRegister.h"
+
+int32 FLiquidSlosh::ConsumeSubsteps(float DeltaTime, float& InOutAccumulator)
+{
+	InOutAccumulator += FMath::Max(DeltaTime, 0.0f);
+
+	int32 NumSubsteps = FMath::FloorToInt(InOutAccumulator / LiquidSloshConstants::FixedStep);
+	InOutAccumulator -= NumSubsteps * LiquidSloshConstants::FixedStep;
+
+	return FMath::Min(NumSubsteps, LiquidSloshConstants::MaxSubsteps);
+}
+
+FVector FLiquidSlosh::FilterAcceleration(const FVector& Measured, const FVector& Filtered, float DeltaTime)
+{
+	FVector Clamped = Measured.GetClampedToMaxSize(LiquidSloshConstants::MaxAcceleration);
+
+	// Exponential smoothing, weight depends on elapsed time so result does not depend on framerate
+	float Alpha = 1.0f - FMath::Exp(-FMath::Max(DeltaTime, 0.0f) / LiquidSloshConstants::AccelerationSmoothingTime);
+
+	return FMath::Lerp(Filtered, Clamped, Alpha);
+}
+
+float FLiquidSlosh::GetTargetAngle(float Acceleration)
+{
+	float Angle = FMath::RadiansToDegrees(FMath::Atan(Acceleration / LiquidSloshConstants::Gravity));
+
+	return FMath::Clamp(Angle, -LiquidSloshConstants::MaxAngle, LiquidSloshConstants::MaxAngle);
+}
+
+void FLiquidSlosh::GetSpringParams(float Frequency, float Viscosity, float& OutStiffness, float& OutDamping)
+{
+	// Thick liquids are close to critically damped, water rings for a while
+	float DampingRatio = FMath::Lerp(0.05f, 1.0f, FMath::Clamp(Viscosity / 100.0f, 0.0f, 1.0f));
+	float Omega = 2.0f * PI * FMath::Max(Frequency, 0.01f);
+
+	OutStiffness = Omega * Omega;
+	OutDamping = 2.0f * DampingRatio * Omega;
+}
+
+void FLiquidSlosh::Integrate(int32 Count, float* Angle, float* Rate, const float* Target, const float* Stiffness, const float* Damping, int32 NumSubsteps)
+{
+	if (NumSubsteps <= 0)
+	{
+		return;
+	}
+
+	// Semi-implicit Euler: rate first, then angle with new rate
+	const VectorRegister Step = VectorSetFloat1(LiquidSloshConstants::FixedStep);
+	const VectorRegister MaxAngle = VectorSetFloat1(LiquidSloshConstants::MaxAngle);
+	const VectorRegister MinAngle = VectorSetFloat1(-LiquidSloshConstants::MaxAngle);
+
+	int32 i = 0;
+	for (; i + 4 <= Count; i += 4)
+	{
+		VectorRegister A = VectorLoad(Angle + i);
+		VectorRegister R = VectorLoad(Rate + i);
+		VectorRegister T = VectorLoad(Target + i);
+		VectorRegister K = VectorLoad(Stiffness + i);
+		VectorRegister C = VectorLoad(Damping + i);
+
+		for (int32 Substep = 0; Substep < NumSubsteps; ++Substep)
+		{
+			VectorRegister Accel = VectorSubtract(VectorMultiply(K, VectorSubtract(T, A)), VectorMultiply(C, R));
+			R = VectorMultiplyAdd(Accel, Step, R);
+			A = VectorMultiplyAdd(R, Step, A);
+		}
+
+		A = VectorMin(VectorMax(A, MinAngle), MaxAngle);
+
+		VectorStore(A, Angle + i);
+		VectorStore(R, Rate + i);
+	}
+
+	// Remaining tanks
+	for (; i < Count; ++i)
+	{
+		float A = Angle[i];
+		float R = Rate[i];
+
+		for (int32 Substep = 0; Substep < NumSubsteps; ++Substep)
+		{
+			float Accel = Stiffness[i] * (Target[i] - A) - Damping[i] * R;
+			R += Accel * LiquidSloshConstants::FixedStep;
+			A += R * LiquidSloshConstants::FixedStep;
+		}
+
+		Angle[i] = FMath::Clamp(A, -LiquidSloshConstants::MaxAngle, LiquidSloshConstants::MaxAngle);
+		Rate[i] = R;
+	}
+}
@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+namespace LiquidSloshConstants
+{
+	// Fixed integration step
+	const float FixedStep = 1.0f / 120.0f;
+
+	// Max substeps per update, extra time after hitches is dropped
+	const int32 MaxSubsteps = 16;
+
+	// Steepest surface tilt in degrees (inside volume table range)
+	const float MaxAngle = 40.0f;
+
+	// Gravity used for equilibrium tilt, cm/s^2
+	const float Gravity = 980.0f;
+
+	// Acceleration giving MaxAngle (Gravity * tan(MaxAngle)), anything above comes from hitches or teleports
+	const float MaxAcceleration = 822.0f;
+
+	// Time constant of acceleration low-pass filter, seconds
+	const float AccelerationSmoothingTime = 0.1f;
+}
+
+// Second order slosh model of the liquid surface.
+// Each tilt axis is a spring-damper pulled towards the tilt that container acceleration
+// asks for, integrated with a fixed substep so results do not depend on framerate.
+// State is kept in flat float arrays so many tanks advance in one SIMD loop.
+struct FACILITY_API FLiquidSlosh
+{
+	// Getting substep count for elapsed time, keeping remainder in accumulator
+	static int32 ConsumeSubsteps(float DeltaTime, float& InOutAccumulator);
+
+	// Clamping and low-pass filtering acceleration measured over DeltaTime, so a single long frame or
+	// reduced update interval only moves slosh target by a fraction instead of spiking it
+	static FVector FilterAcceleration(const FVector& Measured, const FVector& Filtered, float DeltaTime);
+
+	// Getting tilt (degrees) the surface settles at under horizontal acceleration
+	static float GetTargetAngle(float Acceleration);
+
+	// Getting spring stiffness and damping from natural frequency (Hz) and viscosity (0..100)
+	static void GetSpringParams(float Frequency, float Viscosity, float& OutStiffness, float& OutDamping);
+
+	// Advancing one tilt axis of many tanks by NumSubsteps fixed steps (4 tanks per SIMD iteration)
+	static void Integrate(int32 Count, float* Angle, float* Rate, const float* Target, const float* Stiffness, const float* Damping, int32 NumSubsteps);
+};
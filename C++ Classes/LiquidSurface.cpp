@@ -0,0 +1,202 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LiquidSurface.h"
+#include "HAL/PlatformTime.h"
+#include "Math/UnrealMathUtility.h"
+#include "Math/VectorRegister.h"
+
+FLiquidSurfaceHeightfield::FLiquidSurfaceHeightfield()
+{
+	this->TimeAccumulator = 0.0f;
+	this->LastStepMicroseconds = 0.0f;
+	this->SettledSteps = 0;
+	this->bIsAsleep = true;
+}
+
+void FLiquidSurfaceHeightfield::Initialize()
+{
+	int32 NumCells = LiquidSurfaceConstants::Stride * LiquidSurfaceConstants::Stride;
+
+	this->Height.SetNumZeroed(NumCells);
+	this->PrevHeight.SetNumZeroed(NumCells);
+
+	Reset();
+}
+
+void FLiquidSurfaceHeightfield::Reset()
+{
+	FMemory::Memzero(this->Height.GetData(), this->Height.Num() * sizeof(float));
+	FMemory::Memzero(this->PrevHeight.GetData(), this->PrevHeight.Num() * sizeof(float));
+
+	this->TimeAccumulator = 0.0f;
+	this->SettledSteps = 0;
+	this->bIsAsleep = true;
+}
+
+void FLiquidSurfaceHeightfield::AddImpulse(const FVector2D& UV, float Radius, float Strength)
+{
+	using namespace LiquidSurfaceConstants;
+
+	if (!(IsInitialized()) || FMath::IsNearlyZero(Strength))
+	{
+		return;
+	}
+
+	// Getting affected cells
+	float CellRadius = FMath::Max(Radius * Resolution, 1.0f);
+	float CenterX = FMath::Clamp(UV.X, 0.0f, 1.0f) * (Resolution - 1);
+	float CenterY = FMath::Clamp(UV.Y, 0.0f, 1.0f) * (Resolution - 1);
+
+	int32 MinX = FMath::Max(FMath::FloorToInt(CenterX - CellRadius), 0);
+	int32 MaxX = FMath::Min(FMath::CeilToInt(CenterX + CellRadius), Resolution - 1);
+	int32 MinY = FMath::Max(FMath::FloorToInt(CenterY - CellRadius), 0);
+	int32 MaxY = FMath::Min(FMath::CeilToInt(CenterY + CellRadius), Resolution - 1);
+
+	// Adding smooth bump, sharp spikes would only ring at grid frequency
+	for (int32 y = MinY; y <= MaxY; ++y)
+	{
+		for (int32 x = MinX; x <= MaxX; ++x)
+		{
+			float Distance = FMath::Sqrt(FMath::Square(x - CenterX) + FMath::Square(y - CenterY)) / CellRadius;
+			if (Distance < 1.0f)
+			{
+				float Falloff = 0.5f + 0.5f * FMath::Cos(Distance * PI);
+				this->Height[(y + 1) * Stride + (x + 1)] += Strength * Falloff;
+			}
+		}
+	}
+
+	this->SettledSteps = 0;
+	this->bIsAsleep = false;
+}
+
+void FLiquidSurfaceHeightfield::Step(float DeltaTime, float Damping, float BudgetMicroseconds)
+{
+	using namespace LiquidSurfaceConstants;
+
+	this->LastStepMicroseconds = 0.0f;
+
+	if (this->bIsAsleep || !(IsInitialized()))
+	{
+		return;
+	}
+
+	this->TimeAccumulator += FMath::Max(DeltaTime, 0.0f);
+
+	int32 NumSubsteps = FMath::Min(FMath::FloorToInt(this->TimeAccumulator / FixedStep), MaxSubsteps);
+	this->TimeAccumulator = FMath::Min(this->TimeAccumulator - NumSubsteps * FixedStep, FixedStep);
+
+	uint32 StartCycles = FPlatformTime::Cycles();
+	for (int32 Substep = 0; Substep < NumSubsteps; ++Substep)
+	{
+		float MaxChange = StepOnce(Damping);
+
+		// Going to sleep once surface has settled for a while
+		this->SettledSteps = (MaxChange < SleepThreshold) ? (this->SettledSteps + 1) : 0;
+		if (this->SettledSteps >= SleepSteps)
+		{
+			Reset();
+			break;
+		}
+
+		// Dropping remaining steps when over budget, surface just runs slower this frame
+		this->LastStepMicroseconds = FPlatformTime::ToMilliseconds(FPlatformTime::Cycles() - StartCycles) * 1000.0f;
+		if (this->LastStepMicroseconds >= BudgetMicroseconds)
+		{
+			this->TimeAccumulator = 0.0f;
+			break;
+		}
+	}
+}
+
+void FLiquidSurfaceHeightfield::UpdateGhostCells()
+{
+	using namespace LiquidSurfaceConstants;
+
+	float* H = this->Height.GetData();
+
+	// Top and bottom rows
+	FMemory::Memcpy(H + 1, H + Stride + 1, Resolution * sizeof(float));
+	FMemory::Memcpy(H + (Resolution + 1) * Stride + 1, H + Resolution * Stride + 1, Resolution * sizeof(float));
+
+	// Left and right columns
+	for (int32 y = 1; y <= Resolution; ++y)
+	{
+		H[y * Stride] = H[y * Stride + 1];
+		H[y * Stride + Resolution + 1] = H[y * Stride + Resolution];
+	}
+}
+
+float FLiquidSurfaceHeightfield::StepOnce(float Damping)
+{
+	using namespace LiquidSurfaceConstants;
+
+	static_assert(Resolution % 4 == 0, "Surface rows are processed 4 cells at a time");
+
+	UpdateGhostCells();
+
+	const float* RESTRICT H = this->Height.GetData();
+	float* RESTRICT Prev = this->PrevHeight.GetData();
+
+	// Verlet step of damped wave equation, new heights overwrite previous ones in place
+	const VectorRegister Keep = VectorSetFloat1(1.0f - FMath::Clamp(Damping, 0.0f, 1.0f));
+	const VectorRegister Coefficient = VectorSetFloat1(WaveCoefficient);
+	const VectorRegister Four = VectorSetFloat1(4.0f);
+	VectorRegister MaxChange = VectorZero();
+
+	for (int32 y = 1; y <= Resolution; ++y)
+	{
+		for (int32 x = 1; x <= Resolution; x += 4)
+		{
+			int32 Index = y * Stride + x;
+
+			VectorRegister Center = VectorLoad(H + Index);
+			VectorRegister Neighbours = VectorAdd(VectorAdd(VectorLoad(H + Index - 1), VectorLoad(H + Index + 1)), VectorAdd(VectorLoad(H + Index - Stride), VectorLoad(H + Index + Stride)));
+			VectorRegister Laplacian = VectorSubtract(Neighbours, VectorMultiply(Four, Center));
+			VectorRegister Velocity = VectorMultiply(VectorSubtract(Center, VectorLoad(Prev + Index)), Keep);
+			VectorRegister Change = VectorMultiplyAdd(Coefficient, Laplacian, Velocity);
+
+			VectorStore(VectorAdd(Center, Change), Prev + Index);
+			MaxChange = VectorMax(MaxChange, VectorAbs(Change));
+		}
+	}
+
+	Swap(this->Height, this->PrevHeight);
+
+	float Lanes[4];
+	VectorStore(MaxChange, Lanes);
+
+	return FMath::Max(FMath::Max(Lanes[0], Lanes[1]), FMath::Max(Lanes[2], Lanes[3]));
+}
+
+void FLiquidSurfaceHeightfield::Sample(const FVector2D& UV, float& OutHeight, FVector2D& OutSlope) const
+{
+	using namespace LiquidSurfaceConstants;
+
+	OutHeight = 0.0f;
+	OutSlope = FVector2D::ZeroVector;
+
+	if (this->bIsAsleep || !(IsInitialized()))
+	{
+		return;
+	}
+
+	float GridX = FMath::Clamp(UV.X, 0.0f, 1.0f) * (Resolution - 1);
+	float GridY = FMath::Clamp(UV.Y, 0.0f, 1.0f) * (Resolution - 1);
+	int32 X0 = FMath::Min(FMath::FloorToInt(GridX), Resolution - 2);
+	int32 Y0 = FMath::Min(FMath::FloorToInt(GridY), Resolution - 2);
+	float AlphaX = GridX - X0;
+	float AlphaY = GridY - Y0;
+
+	int32 Index = (Y0 + 1) * Stride + (X0 + 1);
+	float H00 = this->Height[Index];
+	float H10 = this->Height[Index + 1];
+	float H01 = this->Height[Index + Stride];
+	float H11 = this->Height[Index + Stride + 1];
+
+	OutHeight = FMath::Lerp(FMath::Lerp(H00, H10, AlphaX), FMath::Lerp(H01, H11, AlphaX), AlphaY);
+
+	// Grid spans whole UV range, so one cell is 1 / (Resolution - 1) UV units
+	OutSlope.X = FMath::Lerp(H10 - H00, H11 - H01, AlphaY) * (Resolution - 1);
+	OutSlope.Y = FMath::Lerp(H01 - H00, H11 - H10, AlphaX) * (Resolution - 1);
+}
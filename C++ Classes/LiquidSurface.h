@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+namespace LiquidSurfaceConstants
+{
+	// Cells per side of surface heightfield
+	const int32 Resolution = 32;
+
+	// Row stride with one ghost cell on each side
+	const int32 Stride = Resolution + 2;
+
+	// Fixed solver step
+	const float FixedStep = 1.0f / 60.0f;
+
+	// Max solver steps per update, extra time is dropped
+	const int32 MaxSubsteps = 4;
+
+	// Squared Courant number of wave equation (has to stay under 0.5 to be stable)
+	const float WaveCoefficient = 0.2f;
+
+	// Largest per step height change still counted as settled
+	const float SleepThreshold = 0.001f;
+
+	// Settled steps in a row before surface goes to sleep
+	const int32 SleepSteps = 30;
+}
+
+// Small heightfield of liquid surface displacement, solved as a damped 2D wave equation.
+// Heights are unitless and live on a grid spanning the liquid mesh bounds in X and Y.
+// Each row is advanced 4 cells at a time with SIMD. Once disturbances die out the field
+// is flattened and sleeps until next impulse, so idle tanks cost nothing.
+class FACILITY_API FLiquidSurfaceHeightfield
+{
+public:
+	FLiquidSurfaceHeightfield();
+
+	// Allocating flat surface
+	void Initialize();
+
+	// Flattening surface and putting it to sleep
+	void Reset();
+
+	// Pushing surface around UV (0..1 over liquid bounds), radius in UV units
+	void AddImpulse(const FVector2D& UV, float Radius, float Strength);
+
+	// Advancing fixed steps for elapsed time, stops early once budget (microseconds) is used up
+	void Step(float DeltaTime, float Damping, float BudgetMicroseconds);
+
+	// Getting bilinear height and its slope per UV unit
+	void Sample(const FVector2D& UV, float& OutHeight, FVector2D& OutSlope) const;
+
+	bool IsInitialized() const { return this->Height.Num() > 0; }
+
+	bool IsAwake() const { return !(this->bIsAsleep); }
+
+	float GetLastStepMicroseconds() const { return this->LastStepMicroseconds; }
+
+private:
+	// Copying border cells into ghost ring (reflecting walls)
+	void UpdateGhostCells();
+
+	// Running one solver step, returns largest height change
+	float StepOnce(float Damping);
+
+	// Heights of current and previous step (padded grid)
+	TArray<float> Height;
+	TArray<float> PrevHeight;
+
+	float TimeAccumulator;
+	float LastStepMicroseconds;
+
+	int32 SettledSteps;
+
+	bool bIsAsleep;
+};
@@ -0,0 +1,240 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LiquidVolumeTable.h"
+#include "Engine/StaticMesh.h"
+#include "Math/UnrealMathUtility.h"
+
+// Assets
+#include "LiquidSlicer.h"
+
+namespace LiquidVolumeTableRegistry
+{
+	// Baked tables by mesh asset
+	TMap<TWeakObjectPtr<UStaticMesh>, TSharedPtr<const FLiquidVolumeTable>>& GetTables()
+	{
+		static TMap<TWeakObjectPtr<UStaticMesh>, TSharedPtr<const FLiquidVolumeTable>> Tables;
+		return Tables;
+	}
+
+	// Convexity by mesh asset and LOD
+	TMap<TPair<TWeakObjectPtr<UStaticMesh>, int32>, bool>& GetConvexity()
+	{
+		static TMap<TPair<TWeakObjectPtr<UStaticMesh>, int32>, bool> Convexity;
+		return Convexity;
+	}
+}
+
+FLiquidVolumeTable::FLiquidVolumeTable()
+{
+	this->TiltResolution = 7;
+	this->FillResolution = 25;
+	this->MaxTilt = 0.7f;
+	this->TotalVolume = 0.0f;
+}
+
+TSharedPtr<const FLiquidVolumeTable> FLiquidVolumeTable::FindOrBake(UStaticMesh* Mesh, const FLiquidSlicer& Slicer)
+{
+	if ((Mesh == nullptr) || !(Slicer.IsInitialized()))
+	{
+		return nullptr;
+	}
+
+	TMap<TWeakObjectPtr<UStaticMesh>, TSharedPtr<const FLiquidVolumeTable>>& Tables = LiquidVolumeTableRegistry::GetTables();
+
+	// Reusing table baked for another tank
+	if (const TSharedPtr<const FLiquidVolumeTable>* FoundTable = Tables.Find(Mesh))
+	{
+		return *FoundTable;
+	}
+
+	// Dropping tables of unloaded meshes
+	for (auto It = Tables.CreateIterator(); It; ++It)
+	{
+		if (!(It.Key().IsValid()))
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	TSharedPtr<FLiquidVolumeTable> NewTable = MakeShared<FLiquidVolumeTable>();
+	NewTable->Bake(Slicer);
+	Tables.Add(Mesh, NewTable);
+
+	return NewTable;
+}
+
+bool FLiquidVolumeTable::FindOrComputeConvexity(UStaticMesh* Mesh, int32 LODIndex, TFunctionRef<bool()> Compute)
+{
+	TMap<TPair<TWeakObjectPtr<UStaticMesh>, int32>, bool>& Convexity = LiquidVolumeTableRegistry::GetConvexity();
+
+	TPair<TWeakObjectPtr<UStaticMesh>, int32> Key(Mesh, LODIndex);
+	if (const bool* bFoundIsConvex = Convexity.Find(Key))
+	{
+		return *bFoundIsConvex;
+	}
+
+	// Dropping results of unloaded meshes
+	for (auto It = Convexity.CreateIterator(); It; ++It)
+	{
+		if (!(It.Key().Key.IsValid()))
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	bool bIsConvex = Compute();
+	Convexity.Add(Key, bIsConvex);
+
+	return bIsConvex;
+}
+
+void FLiquidVolumeTable::Bake(const FLiquidSlicer& Slicer)
+{
+	int32 NumCells = this->TiltResolution * this->TiltResolution;
+
+	this->MinDistance.SetNumZeroed(NumCells);
+	this->MaxDistance.SetNumZeroed(NumCells);
+	this->FillForHeight.SetNumZeroed(NumCells * this->FillResolution);
+	this->HeightForFill.SetNumZeroed(NumCells * this->FillResolution);
+	this->TotalVolume = 0.0f;
+
+	FLiquidSliceBuffers Buffers;
+	Slicer.InitBuffers(Buffers);
+
+	TArray<float> Volumes;
+	Volumes.SetNumZeroed(this->FillResolution);
+
+	for (int32 CellY = 0; CellY < this->TiltResolution; ++CellY)
+	{
+		for (int32 CellX = 0; CellX < this->TiltResolution; ++CellX)
+		{
+			int32 Cell = CellY * this->TiltResolution + CellX;
+
+			// Getting up vector of this tilt cell
+			float UpX = FMath::Lerp(-this->MaxTilt, this->MaxTilt, float(CellX) / float(this->TiltResolution - 1));
+			float UpY = FMath::Lerp(-this->MaxTilt, this->MaxTilt, float(CellY) / float(this->TiltResolution - 1));
+			float UpZ = FMath::Sqrt(FMath::Max(0.0f, 1.0f - UpX * UpX - UpY * UpY));
+			FVector Up = FVector(UpX, UpY, UpZ).GetSafeNormal();
+
+			float Min;
+			float Max;
+			Slicer.GetProjectionRange(Up, Min, Max);
+			this->MinDistance[Cell] = Min;
+			this->MaxDistance[Cell] = Max;
+
+			// Slicing at uniformly spaced heights, liquid is kept under the plane
+			for (int32 k = 0; k < this->FillResolution; ++k)
+			{
+				float Distance = FMath::Lerp(Min, Max, float(k) / float(this->FillResolution - 1));
+				Slicer.Slice(FPlane(-Up, -Distance), Buffers);
+				Volumes[k] = FLiquidSlicer::ComputeVolume(Buffers);
+			}
+
+			float FullVolume = Volumes[this->FillResolution - 1];
+			if (FullVolume <= KINDA_SMALL_NUMBER)
+			{
+				continue;
+			}
+			this->TotalVolume = FMath::Max(this->TotalVolume, FullVolume);
+
+			// Normalizing and keeping curve monotonic
+			float RunningMax = 0.0f;
+			for (int32 k = 0; k < this->FillResolution; ++k)
+			{
+				RunningMax = FMath::Clamp(Volumes[k] / FullVolume, RunningMax, 1.0f);
+				Volumes[k] = RunningMax;
+				this->FillForHeight[Cell * this->FillResolution + k] = RunningMax;
+			}
+
+			// Inverting curve at uniformly spaced volume fractions
+			int32 k = 0;
+			for (int32 j = 0; j < this->FillResolution; ++j)
+			{
+				float Target = float(j) / float(this->FillResolution - 1);
+				while ((k < this->FillResolution - 2) && (Volumes[k + 1] < Target))
+				{
+					++k;
+				}
+
+				float Span = Volumes[k + 1] - Volumes[k];
+				float Alpha = (Span > KINDA_SMALL_NUMBER) ? FMath::Clamp((Target - Volumes[k]) / Span, 0.0f, 1.0f) : 0.0f;
+				this->HeightForFill[Cell * this->FillResolution + j] = (float(k) + Alpha) / float(this->FillResolution - 1);
+			}
+		}
+	}
+}
+
+void FLiquidVolumeTable::GetTiltCell(const FVector& LocalUp, int32& OutX0, int32& OutY0, float& OutAlphaX, float& OutAlphaY) const
+{
+	float Scale = float(this->TiltResolution - 1) / (2.0f * this->MaxTilt);
+	float GridX = FMath::Clamp((LocalUp.X + this->MaxTilt) * Scale, 0.0f, float(this->TiltResolution - 1));
+	float GridY = FMath::Clamp((LocalUp.Y + this->MaxTilt) * Scale, 0.0f, float(this->TiltResolution - 1));
+
+	OutX0 = FMath::Min(FMath::FloorToInt(GridX), this->TiltResolution - 2);
+	OutY0 = FMath::Min(FMath::FloorToInt(GridY), this->TiltResolution - 2);
+	OutAlphaX = GridX - float(OutX0);
+	OutAlphaY = GridY - float(OutY0);
+}
+
+float FLiquidVolumeTable::SampleCell(const TArray<float>& Table, int32 Cell, float Fraction) const
+{
+	float Grid = FMath::Clamp(Fraction, 0.0f, 1.0f) * float(this->FillResolution - 1);
+	int32 Index = FMath::Min(FMath::FloorToInt(Grid), this->FillResolution - 2);
+	int32 Base = Cell * this->FillResolution + Index;
+
+	return FMath::Lerp(Table[Base], Table[Base + 1], Grid - float(Index));
+}
+
+float FLiquidVolumeTable::GetVolumeFraction(const FVector& LocalUp, float PlaneDistance) const
+{
+	if (this->TotalVolume <= 0.0f)
+	{
+		return 0.0f;
+	}
+
+	int32 X0;
+	int32 Y0;
+	float AlphaX;
+	float AlphaY;
+	GetTiltCell(LocalUp, X0, Y0, AlphaX, AlphaY);
+
+	auto SampleAt = [this, PlaneDistance](int32 Cell)
+	{
+		float Range = FMath::Max(this->MaxDistance[Cell] - this->MinDistance[Cell], KINDA_SMALL_NUMBER);
+		return SampleCell(this->FillForHeight, Cell, (PlaneDistance - this->MinDistance[Cell]) / Range);
+	};
+
+	int32 Cell00 = Y0 * this->TiltResolution + X0;
+	int32 Cell01 = Cell00 + this->TiltResolution;
+	float Bottom = FMath::Lerp(SampleAt(Cell00), SampleAt(Cell00 + 1), AlphaX);
+	float Top = FMath::Lerp(SampleAt(Cell01), SampleAt(Cell01 + 1), AlphaX);
+
+	return FMath::Lerp(Bottom, Top, AlphaY);
+}
+
+float FLiquidVolumeTable::GetPlaneDistance(const FVector& LocalUp, float VolumeFraction) const
+{
+	if (this->TotalVolume <= 0.0f)
+	{
+		return 0.0f;
+	}
+
+	int32 X0;
+	int32 Y0;
+	float AlphaX;
+	float AlphaY;
+	GetTiltCell(LocalUp, X0, Y0, AlphaX, AlphaY);
+
+	auto SampleAt = [this, VolumeFraction](int32 Cell)
+	{
+		float Height = SampleCell(this->HeightForFill, Cell, VolumeFraction);
+		return FMath::Lerp(this->MinDistance[Cell], this->MaxDistance[Cell], Height);
+	};
+
+	int32 Cell00 = Y0 * this->TiltResolution + X0;
+	int32 Cell01 = Cell00 + this->TiltResolution;
+	float Bottom = FMath::Lerp(SampleAt(Cell00), SampleAt(Cell00 + 1), AlphaX);
+	float Top = FMath::Lerp(SampleAt(Cell01), SampleAt(Cell01 + 1), AlphaX);
+
+	return FMath::Lerp(Bottom, Top, AlphaY);
+}
@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UStaticMesh;
+class FLiquidSlicer;
+
+// Baked relation between surface plane (height and tilt) and enclosed liquid volume of one mesh.
+// Tilt is the X and Y of the local up vector of the surface, height is the normalized plane
+// distance between lowest and highest mesh point along that vector.
+class FACILITY_API FLiquidVolumeTable
+{
+public:
+	FLiquidVolumeTable();
+
+	// Getting table of mesh, baking it on first request. Tables are shared by all tanks using the mesh
+	static TSharedPtr<const FLiquidVolumeTable> FindOrBake(UStaticMesh* Mesh, const FLiquidSlicer& Slicer);
+
+	// Getting convexity of mesh LOD, computing it on first request. Results share registry with tables,
+	// so tanks using the same mesh only scan it once
+	static bool FindOrComputeConvexity(UStaticMesh* Mesh, int32 LODIndex, TFunctionRef<bool()> Compute);
+
+	// Sampling slicer over tilt and height grid
+	void Bake(const FLiquidSlicer& Slicer);
+
+	// Getting volume fraction (0..1) under plane at local distance along local up vector
+	float GetVolumeFraction(const FVector& LocalUp, float PlaneDistance) const;
+
+	// Getting local plane distance along local up vector that encloses volume fraction (0..1)
+	float GetPlaneDistance(const FVector& LocalUp, float VolumeFraction) const;
+
+	// Getting volume of whole mesh in local units
+	float GetTotalVolume() const { return this->TotalVolume; }
+
+public:
+	// Grid resolution
+	int32 TiltResolution;
+	int32 FillResolution;
+
+	// Largest baked tilt (sine of angle), steeper surfaces are clamped
+	float MaxTilt;
+
+private:
+	// Getting tilt cell coordinates for bilinear lookup
+	void GetTiltCell(const FVector& LocalUp, int32& OutX0, int32& OutY0, float& OutAlphaX, float& OutAlphaY) const;
+
+	// Getting one cell value with linear fill interpolation
+	float SampleCell(const TArray<float>& Table, int32 Cell, float Fraction) const;
+
+	// Per tilt cell: lowest and highest point along up vector
+	TArray<float> MinDistance;
+	TArray<float> MaxDistance;
+
+	// Per tilt cell: volume fraction at uniformly spaced heights
+	TArray<float> FillForHeight;
+
+	// Per tilt cell: height fraction at uniformly spaced volume fractions
+	TArray<float> HeightForFill;
+
+	float TotalVolume;
+};
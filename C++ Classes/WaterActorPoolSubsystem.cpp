@@ -0,0 +1,265 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "WaterActorPoolSubsystem.h"
+#include "GameFramework/Actor.h"
+#include "HAL/IConsoleManager.h"
+
+// Assets
+#include "WaterPoolable.h"
+#include "WaterSimulationSubsystem.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogWaterActorPool, Log, All);
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled Water Actors In Use"), STAT_WaterActorPool_InUse, STATGROUP_WaterSimulation);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled Water Actors Peak"), STAT_WaterActorPool_Peak, STATGROUP_WaterSimulation);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled Water Actors Free"), STAT_WaterActorPool_Free, STATGROUP_WaterSimulation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Water Actor Pool Hits"), STAT_WaterActorPool_Hits, STATGROUP_WaterSimulation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Water Actor Pool Misses"), STAT_WaterActorPool_Misses, STATGROUP_WaterSimulation);
+
+namespace WaterActorPoolHelpers
+{
+	void DumpStatsCommand(UWorld* World)
+	{
+		UWaterActorPoolSubsystem* Pool = (World != nullptr) ? World->GetSubsystem<UWaterActorPoolSubsystem>() : nullptr;
+		if (Pool != nullptr)
+		{
+			Pool->DumpStats();
+		}
+	}
+
+	FAutoConsoleCommandWithWorld DumpStatsConsoleCommand(
+		TEXT("Water.Pool.Stats"),
+		TEXT("Logs acquires, hit rate, current and peak usage of every water actor pool."),
+		FConsoleCommandWithWorldDelegate::CreateStatic(&DumpStatsCommand));
+}
+
+FWaterActorPool::FWaterActorPool()
+{
+	this->NumInUse = 0;
+	this->PeakInUse = 0;
+	this->NumAcquired = 0;
+	this->NumReused = 0;
+}
+
+UWaterActorPoolSubsystem::UWaterActorPoolSubsystem()
+{
+	this->NumInUse = 0;
+	this->PeakInUse = 0;
+}
+
+void UWaterActorPoolSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	this->ActorsInitializedHandle = FWorldDelegates::OnWorldInitializedActors.AddUObject(this, &UWaterActorPoolSubsystem::OnWorldInitializedActors);
+}
+
+void UWaterActorPoolSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldInitializedActors.Remove(this->ActorsInitializedHandle);
+
+	this->Pools.Empty();
+	this->PooledActors.Empty();
+	this->PlainPooledClasses.Empty();
+	this->NumInUse = 0;
+	this->PeakInUse = 0;
+
+	Super::Deinitialize();
+}
+
+void UWaterActorPoolSubsystem::OnWorldInitializedActors(const UWorld::FActorsInitializedParams& Params)
+{
+	if ((Params.World != GetWorld()) || !(Params.World->IsGameWorld()))
+	{
+		return;
+	}
+
+	for (const TSoftClassPtr<AActor>& PlainClass : this->PlainClasses)
+	{
+		AddPlainClass(PlainClass.LoadSynchronous());
+	}
+
+	// Spawning actors now so first hits of a fight do not pay for it
+	for (const TPair<TSoftClassPtr<AActor>, int32>& Entry : this->PrewarmCounts)
+	{
+		Prewarm(Entry.Key.LoadSynchronous(), Entry.Value);
+	}
+}
+
+AActor* UWaterActorPoolSubsystem::AcquireActor(TSubclassOf<AActor> ActorClass, const FTransform& Transform)
+{
+	UWorld* const World = GetWorld();
+	if ((World == nullptr) || (ActorClass == nullptr))
+	{
+		return nullptr;
+	}
+
+	FWaterActorPool& Pool = this->Pools.FindOrAdd(ActorClass);
+	++Pool.NumAcquired;
+
+	// Taking newest free actor, destroyed ones are dropped on the way
+	AActor* Actor = nullptr;
+	while ((Actor == nullptr) && (Pool.FreeActors.Num() > 0))
+	{
+		TWeakObjectPtr<AActor> FreeActor = Pool.FreeActors.Pop(false);
+		this->PooledActors.Remove(FreeActor);
+		SET_DWORD_STAT(STAT_WaterActorPool_Free, this->PooledActors.Num());
+
+		if (FreeActor.IsValid() && !(FreeActor->IsPendingKill()))
+		{
+			Actor = FreeActor.Get();
+		}
+	}
+
+	if (Actor != nullptr)
+	{
+		Actor->SetActorTransform(Transform, false, nullptr, ETeleportType::TeleportPhysics);
+		Actor->SetActorHiddenInGame(false);
+		Actor->SetActorEnableCollision(true);
+
+		IWaterPoolable* Poolable = Cast<IWaterPoolable>(Actor);
+		if (Poolable != nullptr)
+		{
+			Poolable->OnAcquiredFromPool();
+		}
+
+		++Pool.NumReused;
+		INC_DWORD_STAT(STAT_WaterActorPool_Hits);
+	}
+	else
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		Actor = World->SpawnActor<AActor>(ActorClass, Transform, SpawnParams);
+
+		INC_DWORD_STAT(STAT_WaterActorPool_Misses);
+	}
+
+	if (Actor != nullptr)
+	{
+		++Pool.NumInUse;
+		Pool.PeakInUse = FMath::Max(Pool.PeakInUse, Pool.NumInUse);
+
+		// Peak of all pools together, per class peaks are in Water.Pool.Stats
+		++this->NumInUse;
+		this->PeakInUse = FMath::Max(this->PeakInUse, this->NumInUse);
+		INC_DWORD_STAT(STAT_WaterActorPool_InUse);
+		SET_DWORD_STAT(STAT_WaterActorPool_Peak, this->PeakInUse);
+	}
+
+	return Actor;
+}
+
+void UWaterActorPoolSubsystem::ReleaseActor(AActor* Actor)
+{
+	if ((Actor == nullptr) || Actor->IsPendingKill() || IsPooled(Actor))
+	{
+		return;
+	}
+
+	// Actors spawned outside of pool are adopted without touching usage
+	FWaterActorPool& Pool = this->Pools.FindOrAdd(Actor->GetClass());
+	if (Pool.NumInUse > 0)
+	{
+		--Pool.NumInUse;
+		--this->NumInUse;
+		DEC_DWORD_STAT(STAT_WaterActorPool_InUse);
+	}
+
+	IWaterPoolable* Poolable = Cast<IWaterPoolable>(Actor);
+	if ((Poolable == nullptr) && !(this->PlainPooledClasses.Contains(Actor->GetClass())))
+	{
+		Actor->Destroy();
+		return;
+	}
+
+	if (Poolable != nullptr)
+	{
+		Poolable->OnReleasedToPool();
+	}
+	Actor->DetachFromActor(FDetachmentTransformRules::KeepWorldTransform);
+	Actor->SetActorHiddenInGame(true);
+	Actor->SetActorEnableCollision(false);
+
+	Pool.FreeActors.Add(Actor);
+	this->PooledActors.Add(Actor);
+	SET_DWORD_STAT(STAT_WaterActorPool_Free, this->PooledActors.Num());
+}
+
+void UWaterActorPoolSubsystem::Prewarm(TSubclassOf<AActor> ActorClass, int32 Count)
+{
+	UWorld* const World = GetWorld();
+	if ((World == nullptr) || !(IsPoolableClass(ActorClass)))
+	{
+		return;
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	FWaterActorPool& Pool = this->Pools.FindOrAdd(ActorClass);
+	for (int32 i = Pool.FreeActors.Num(); i < Count; ++i)
+	{
+		AActor* Actor = World->SpawnActor<AActor>(ActorClass, FTransform::Identity, SpawnParams);
+		ReleaseActor(Actor);
+	}
+}
+
+void UWaterActorPoolSubsystem::AddPlainClass(TSubclassOf<AActor> ActorClass)
+{
+	if (ActorClass != nullptr)
+	{
+		this->PlainPooledClasses.Add(ActorClass);
+	}
+}
+
+bool UWaterActorPoolSubsystem::IsPoolableClass(const UClass* ActorClass) const
+{
+	return (ActorClass != nullptr) && (ActorClass->ImplementsInterface(UWaterPoolable::StaticClass()) || this->PlainPooledClasses.Contains(ActorClass));
+}
+
+bool UWaterActorPoolSubsystem::IsPooled(const AActor* Actor) const
+{
+	return this->PooledActors.Contains(TWeakObjectPtr<AActor>(const_cast<AActor*>(Actor)));
+}
+
+void UWaterActorPoolSubsystem::ReleaseOrDestroy(AActor* Actor)
+{
+	if (Actor == nullptr)
+	{
+		return;
+	}
+
+	UWorld* const World = Actor->GetWorld();
+	UWaterActorPoolSubsystem* Pool = (World != nullptr) ? World->GetSubsystem<UWaterActorPoolSubsystem>() : nullptr;
+	if (Pool != nullptr)
+	{
+		Pool->ReleaseActor(Actor);
+	}
+	else
+	{
+		Actor->Destroy();
+	}
+}
+
+bool UWaterActorPoolSubsystem::IsActorPooled(const AActor* Actor)
+{
+	UWorld* const World = (Actor != nullptr) ? Actor->GetWorld() : nullptr;
+	UWaterActorPoolSubsystem* Pool = (World != nullptr) ? World->GetSubsystem<UWaterActorPoolSubsystem>() : nullptr;
+
+	return (Pool != nullptr) && Pool->IsPooled(Actor);
+}
+
+void UWaterActorPoolSubsystem::DumpStats() const
+{
+	for (const TPair<UClass*, FWaterActorPool>& Entry : this->Pools)
+	{
+		const FWaterActorPool& Pool = Entry.Value;
+		float HitRate = (Pool.NumAcquired > 0) ? 100.0f * Pool.NumReused / Pool.NumAcquired : 0.0f;
+
+		UE_LOG(LogWaterActorPool, Display, TEXT("%s: %d acquired, %.1f%% from pool, %d in use, %d peak, %d free"),
+			   *GetNameSafe(Entry.Key), Pool.NumAcquired, HitRate, Pool.NumInUse, Pool.PeakInUse, Pool.FreeActors.Num());
+	}
+
+	UE_LOG(LogWaterActorPool, Display, TEXT("All pools: %d in use, %d peak, %d free"), this->NumInUse, this->PeakInUse, this->PooledActors.Num());
+}
@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Engine/World.h"
+#include "WaterActorPoolSubsystem.generated.h"
+
+// Free actors and usage of one actor class
+struct FWaterActorPool
+{
+	FWaterActorPool();
+
+	TArray<TWeakObjectPtr<AActor>> FreeActors;
+
+	int32 NumInUse;
+	int32 PeakInUse;
+	int32 NumAcquired;
+	int32 NumReused;
+};
+
+// Keeps water actors (puddles, waterfalls, projectiles) alive between uses.
+// Released actors are hidden and kept per class, acquiring hands one out again or spawns a new one.
+// Only classes implementing IWaterPoolable or added as plain classes are kept, anything else is
+// spawned and destroyed as usual.
+UCLASS(Config = Game)
+class FACILITY_API UWaterActorPoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UWaterActorPoolSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// Actors spawned into pool per class once level actors are initialized
+	UPROPERTY(Config)
+	TMap<TSoftClassPtr<AActor>, int32> PrewarmCounts;
+
+	// Classes pooled without IWaterPoolable (see AddPlainClass)
+	UPROPERTY(Config)
+	TArray<TSoftClassPtr<AActor>> PlainClasses;
+
+	// Getting actor of class at transform, from pool if there is a free one
+	UFUNCTION(BlueprintCallable, Category = "Water Actor Pool", meta = (DeterminesOutputType = "ActorClass"))
+	AActor* AcquireActor(TSubclassOf<AActor> ActorClass, const FTransform& Transform);
+
+	template<typename ActorType>
+	ActorType* Acquire(TSubclassOf<ActorType> ActorClass, const FTransform& Transform)
+	{
+		return Cast<ActorType>(AcquireActor(ActorClass, Transform));
+	}
+
+	// Putting actor into pool (destroying it if its class is not poolable)
+	UFUNCTION(BlueprintCallable, Category = "Water Actor Pool")
+	void ReleaseActor(AActor* Actor);
+
+	// Filling pool of class up to count free actors
+	UFUNCTION(BlueprintCallable, Category = "Water Actor Pool")
+	void Prewarm(TSubclassOf<AActor> ActorClass, int32 Count);
+
+	bool IsPooled(const AActor* Actor) const;
+
+	// Pooling class that can not implement IWaterPoolable (defined outside of water code, like glass feathers).
+	// Its actors only get transform, visibility, collision and attachment reset, so they must keep no other state
+	UFUNCTION(BlueprintCallable, Category = "Water Actor Pool")
+	void AddPlainClass(TSubclassOf<AActor> ActorClass);
+
+	// Checking if actors of class are kept in pool
+	bool IsPoolableClass(const UClass* ActorClass) const;
+
+	// Releasing actor through pool of its world, destroying it if there is no pool
+	static void ReleaseOrDestroy(AActor* Actor);
+
+	// Checking if actor is waiting in pool of its world
+	static bool IsActorPooled(const AActor* Actor);
+
+	// Logging usage and hit rate of every pool
+	void DumpStats() const;
+
+protected:
+	void OnWorldInitializedActors(const UWorld::FActorsInitializedParams& Params);
+
+	TMap<UClass*, FWaterActorPool> Pools;
+
+	// Plain classes from config and AddPlainClass
+	UPROPERTY()
+	TSet<UClass*> PlainPooledClasses;
+
+	// Actors currently waiting in pools
+	TSet<TWeakObjectPtr<AActor>> PooledActors;
+
+	// Usage summed over all pools
+	int32 NumInUse;
+	int32 PeakInUse;
+
+	FDelegateHandle ActorsInitializedHandle;
+};
@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "WaterPoolable.generated.h"
+
+UINTERFACE(MinimalAPI, meta = (CannotImplementInterfaceInBlueprint))
+class UWaterPoolable : public UInterface
+{
+	GENERATED_BODY()
+};
+
+// Actor that water actor pool keeps hidden instead of destroying.
+// Pool sets transform, visibility and collision, the actor resets everything else.
+class FACILITY_API IWaterPoolable
+{
+	GENERATED_BODY()
+
+public:
+	// Resetting state when pool hands actor out (transform is already set)
+	virtual void OnAcquiredFromPool() = 0;
+
+	// Stopping actor when it goes back to pool
+	virtual void OnReleasedToPool() = 0;
+};
@@ -12,6 +12,10 @@
 // Assets
 #include "Waterfall.h"
 #include "WaterTank.h"
+#include "WaterActorPoolSubsystem.h"
+#include "WaterSimulationSubsystem.h"
+
+const FName AWaterPuddle::CollisionBoxTag(TEXT("WaterPuddleCollisionBox"));
 
 // Sets default values
 AWaterPuddle::AWaterPuddle()
@@ -35,6 +39,9 @@ AWaterPuddle::AWaterPuddle()
 	this->WaterPuddleCollisionBoxComponent->SetRelativeScale3D(FVector(2.0f, 2.0f, 0.05f));
 	this->WaterPuddleCollisionBoxComponent->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Overlap);
 	this->WaterPuddleCollisionBoxComponent->SetCollisionResponseToChannel(ECollisionChannel::ECC_Pawn, ECollisionResponse::ECR_Ignore);
+	this->WaterPuddleCollisionBoxComponent->ComponentTags.Add(CollisionBoxTag);
+	this->WaterPuddleCollisionBoxComponent->OnComponentBeginOverlap.AddDynamic(this, &AWaterPuddle::OnWaterfallBeginOverlap);
+	this->WaterPuddleCollisionBoxComponent->OnComponentEndOverlap.AddDynamic(this, &AWaterPuddle::OnWaterfallEndOverlap);
 
 	// Setting default variables
 	this->DeltaWaterPuddleScale = 0.005f;
@@ -43,9 +50,13 @@ AWaterPuddle::AWaterPuddle()
 	this->WaterPuddleStartDelay = 3.0f;
 	this->WaterPuddleDuration = 5.0f;
 	this->IsAbleToFade = false;
-	this->flag25 = false;
-	this->flag50 = false;
-	this->flag75 = false;
+	this->SimulationIndex = INDEX_NONE;
+	this->LastFedTime = 0.0f;
+	this->bIsRetiring = false;
+	this->LiquidVolume = 0.0f;
+	this->GrowthStartScale = FVector::OneVector;
+	this->GrownScale = FVector::OneVector;
+	this->InflowTime = 0.0f;
 }
 
 // Called when the game starts or when spawned
@@ -53,13 +64,106 @@ void AWaterPuddle::BeginPlay()
 {
 	Super::BeginPlay();
 	
-	// Setting waterfall detector flag
-	this->IsUnderWaterfall = false;
+	// Setting waterfall detector flag (overlaps may have been found on spawn)
+	SetWaterfallFlag();
+
+	// Pooled puddles start fading and join water simulation when handed out
+	if (UWaterActorPoolSubsystem::IsActorPooled(this))
+	{
+		SetActorTickEnabled(false);
+		return;
+	}
+
+	// Letting waterfalls and puddle budget find this puddle
+	this->LastFedTime = GetWorld()->GetTimeSeconds();
+	UpdateSpatialHashEntry(true);
 
 	// Setting water puddle fade function
 	if (this->IsAbleToFade)
 	{
-		this->WaterPuddleDecalComponent->SetFadeOut(this->WaterPuddleStartDelay, this->WaterPuddleDuration, true);
+		FadeOutAndRelease(this->WaterPuddleStartDelay, this->WaterPuddleDuration);
+	}
+
+	// Handing per frame update over to water simulation, which only runs puddles under waterfalls
+	UWorld* const World = GetWorld();
+	if ((World != nullptr) && (World->GetSubsystem<UWaterSimulationSubsystem>() != nullptr))
+	{
+		SetActorTickEnabled(false);
+		UpdateWaterSimulationRegistration();
+	}
+}
+
+void AWaterPuddle::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	ClearOverlappingWaterfalls();
+	UpdateSpatialHashEntry(false);
+
+	// Leaving water simulation
+	UWorld* const World = GetWorld();
+	if (World != nullptr)
+	{
+		UWaterSimulationSubsystem* WaterSimulation = World->GetSubsystem<UWaterSimulationSubsystem>();
+		if (WaterSimulation != nullptr)
+		{
+			WaterSimulation->UnregisterWaterPuddle(this);
+		}
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AWaterPuddle::LifeSpanExpired()
+{
+	UWaterActorPoolSubsystem::ReleaseOrDestroy(this);
+}
+
+void AWaterPuddle::OnAcquiredFromPool()
+{
+	// Resetting growth, liquid and age
+	this->LiquidVolume = 0.0f;
+	this->bIsRetiring = false;
+	this->LastFedTime = GetWorld()->GetTimeSeconds();
+	RestartGrowth();
+
+	// Restarting water puddle fade function
+	if (this->IsAbleToFade)
+	{
+		FadeOutAndRelease(this->WaterPuddleStartDelay, this->WaterPuddleDuration);
+	}
+
+	// Ticking on its own only without water simulation, which drives puddles under waterfalls
+	UWorld* const World = GetWorld();
+	SetActorTickEnabled((World == nullptr) || (World->GetSubsystem<UWaterSimulationSubsystem>() == nullptr));
+
+	// Rejoining water simulation if pool placed puddle under a waterfall
+	UpdateSpatialHashEntry(true);
+	UpdateWaterSimulationRegistration();
+}
+
+void AWaterPuddle::OnReleasedToPool()
+{
+	// Pooled puddles do nothing until handed out
+	SetActorTickEnabled(false);
+
+	// Stopping fade, decal is shown fully again when puddle is handed out
+	SetLifeSpan(0.0f);
+	this->WaterPuddleDecalComponent->SetFadeOut(0.0f, 0.0f, false);
+	this->bIsRetiring = false;
+
+	// Forgetting waterfalls, overlaps are found again when puddle is handed out
+	ClearOverlappingWaterfalls();
+	SetWaterfallFlag();
+	UpdateSpatialHashEntry(false);
+
+	// Leaving water simulation
+	UWorld* const World = GetWorld();
+	if (World != nullptr)
+	{
+		UWaterSimulationSubsystem* WaterSimulation = World->GetSubsystem<UWaterSimulationSubsystem>();
+		if (WaterSimulation != nullptr)
+		{
+			WaterSimulation->UnregisterWaterPuddle(this);
+		}
 	}
 }
 
@@ -72,98 +176,235 @@ void AWaterPuddle::Tick(float DeltaTime)
 	SetWaterfallFlag();
 
 	// Scaling puddle under waterfall
-	ScaleWaterPuddle();
-
-	// Managing water puddle scale
-	ManageWaterPuddleScale();
+	ScaleWaterPuddle(DeltaTime);
 
 	// Setting water puddle rotation depending on actor under it
 	// SetWaterPuddleRotation();
+}
 
-	// Fixing water puddle collision box scale
-	FVector CurrentWPCBCScale = this->WaterPuddleCollisionBoxComponent->GetRelativeScale3D();
-	this->WaterPuddleCollisionBoxComponent->SetRelativeScale3D(FVector(CurrentWPCBCScale.X, CurrentWPCBCScale.Y, 0.05f));
+void AWaterPuddle::ScaleWaterPuddle(float DeltaTime)
+{
+	if (this->IsUnderWaterfall)
+	{
+		GrowWaterPuddle(DeltaTime * this->VisibleWaterfallCount);
+	}
 }
 
-void AWaterPuddle::ManageWaterPuddleScale()
+float AWaterPuddle::ComputeGrowth(const FVector& StartScale, float InflowTime, float DeltaScale, float DeltaScaleStep, float MaxScale)
 {
-	// Get current water scale
-	FVector CurrentWaterPuddleScale = GetActorScale3D();
+	using namespace WaterPuddleConstants;
 
-	if (!this->flag25)
+	float MinAxis = StartScale.GetMin();
+	float MaxGrowth = MaxScale - StartScale.GetMax();
+	float Growth = 0.0f;
+	float RemainingTime = FMath::Max(InflowTime, 0.0f);
+
+	// Walking quarters of max scale, growth rate is constant within one
+	for (int32 Quarter = 0; (Quarter < 4) && (Growth < MaxGrowth) && (RemainingTime > 0.0f); ++Quarter)
 	{
-		if ((CurrentWaterPuddleScale.X >= this->MaxWaterPuddleScale * 0.25) &&
-			(CurrentWaterPuddleScale.Y >= this->MaxWaterPuddleScale * 0.25) &&
-			(CurrentWaterPuddleScale.Z >= this->MaxWaterPuddleScale * 0.25))
+		float QuarterEnd = (Quarter < 3) ? (MaxScale * (Quarter + 1) * 0.25f - MinAxis) : MaxGrowth;
+		if (Growth >= QuarterEnd)
 		{
-			// Decrease water puddle scale
-			if (this->DeltaWaterPuddleScale > 0.001f)
+			// Lowering step for passed quarter
+			if ((Quarter < 3) && (DeltaScale > MinDeltaScale))
 			{
-				this->DeltaWaterPuddleScale -= this->DeltaWaterPuddleScaleStep;
-				this->flag25 = true;
+				DeltaScale -= DeltaScaleStep;
 			}
+			continue;
 		}
-	}
 
-	if (!this->flag50)
-	{
-		if ((CurrentWaterPuddleScale.X >= this->MaxWaterPuddleScale * 0.5) &&
-			(CurrentWaterPuddleScale.Y >= this->MaxWaterPuddleScale * 0.5) &&
-			(CurrentWaterPuddleScale.Z >= this->MaxWaterPuddleScale * 0.5))
+		float Rate = DeltaScale * GrowthStepsPerSecond;
+		if (Rate <= 0.0f)
 		{
-			// Decrease water puddle scale
-			if (this->DeltaWaterPuddleScale > 0.001f)
-			{
-				this->DeltaWaterPuddleScale -= this->DeltaWaterPuddleScaleStep;
-				this->flag50 = true;
-			}
+			break;
 		}
-	}
 
-	if (!this->flag75)
-	{
-		if ((CurrentWaterPuddleScale.X >= this->MaxWaterPuddleScale * 0.75) &&
-			(CurrentWaterPuddleScale.Y >= this->MaxWaterPuddleScale * 0.75) &&
-			(CurrentWaterPuddleScale.Z >= this->MaxWaterPuddleScale * 0.75))
+		float SegmentEnd = FMath::Min(QuarterEnd, MaxGrowth);
+		float SegmentTime = (SegmentEnd - Growth) / Rate;
+		if (RemainingTime < SegmentTime)
 		{
-			// Decrease water puddle scale
-			if (this->DeltaWaterPuddleScale > 0.001f)
-			{
-				this->DeltaWaterPuddleScale -= this->DeltaWaterPuddleScaleStep;
-				this->flag75 = true;
-			}
+			Growth += Rate * RemainingTime;
+			break;
+		}
+
+		Growth = SegmentEnd;
+		RemainingTime -= SegmentTime;
+		if ((Quarter < 3) && (DeltaScale > MinDeltaScale))
+		{
+			DeltaScale -= DeltaScaleStep;
 		}
 	}
+
+	return FMath::Max(Growth, 0.0f);
 }
 
-void AWaterPuddle::ScaleWaterPuddle()
+void AWaterPuddle::ApplyWaterPuddleScale(FVector NewScale)
 {
-	if (this->IsUnderWaterfall)
+	// Updating water puddle fade function
+	if (this->IsAbleToFade && !(this->bIsRetiring))
+	{
+		FadeOutAndRelease(this->WaterPuddleStartDelay, this->WaterPuddleDuration);
+	}
+
+	if (!(NewScale.Equals(GetActorScale3D(), 0.0f)))
 	{
-		// Updating water puddle fade function
-		if (this->IsAbleToFade)
+		SetActorScale3D(NewScale);
+		FixCollisionBoxScale();
+
+		// Larger and growing puddles are more important
+		UWorld* const World = GetWorld();
+		UWaterSimulationSubsystem* WaterSimulation = (World != nullptr) ? World->GetSubsystem<UWaterSimulationSubsystem>() : nullptr;
+		if (WaterSimulation != nullptr)
 		{
-			this->WaterPuddleDecalComponent->SetFadeOut(this->WaterPuddleStartDelay, this->WaterPuddleDuration, true);
+			this->LastFedTime = World->GetTimeSeconds();
+			WaterSimulation->RescoreWaterPuddle(this);
 		}
+	}
+}
 
-		// Getting current water puddle scale
-		FVector CurrentWaterPuddleScale = GetActorScale3D();
+void AWaterPuddle::RestartGrowth()
+{
+	this->GrowthStartScale = GetActorScale3D();
+	this->GrownScale = this->GrowthStartScale;
+	this->InflowTime = 0.0f;
+}
 
-		// New actor scale to set
-		FVector NewActorScale(0.0f, 0.0f, 0.0f);
+void AWaterPuddle::GrowWaterPuddle(float ReceivedInflowTime)
+{
+	// Restarting growth from scale set from outside (spawners, merges)
+	if (!(GetActorScale3D().Equals(this->GrownScale, 0.0f)))
+	{
+		RestartGrowth();
+	}
 
-		// Setting new water puddle scale
-		if ((CurrentWaterPuddleScale.X < this->MaxWaterPuddleScale) &&
-			(CurrentWaterPuddleScale.Y < this->MaxWaterPuddleScale) &&
-			(CurrentWaterPuddleScale.Z < this->MaxWaterPuddleScale))
-		{
-			NewActorScale.X = CurrentWaterPuddleScale.X + (this->DeltaWaterPuddleScale * this->VisibleWaterfallCount);
-			NewActorScale.Y = CurrentWaterPuddleScale.Y + (this->DeltaWaterPuddleScale * this->VisibleWaterfallCount);
-			NewActorScale.Z = CurrentWaterPuddleScale.Z + (this->DeltaWaterPuddleScale * this->VisibleWaterfallCount);
+	this->InflowTime += FMath::Max(ReceivedInflowTime, 0.0f);
+	this->GrownScale = this->GrowthStartScale + FVector(ComputeGrowth(this->GrowthStartScale, this->InflowTime, this->DeltaWaterPuddleScale, this->DeltaWaterPuddleScaleStep, this->MaxWaterPuddleScale));
 
-			SetActorScale3D(NewActorScale);
-		}
+	ApplyWaterPuddleScale(this->GrownScale);
+}
+
+void AWaterPuddle::UpdateSpatialHashEntry(bool bIsInWorld)
+{
+	UWorld* const World = GetWorld();
+	UWaterSimulationSubsystem* WaterSimulation = (World != nullptr) ? World->GetSubsystem<UWaterSimulationSubsystem>() : nullptr;
+	if (WaterSimulation == nullptr)
+	{
+		return;
+	}
+
+	// Retiring puddles are already gone for waterfalls and budget
+	if (bIsInWorld && !(this->bIsRetiring))
+	{
+		WaterSimulation->GetPuddleSpatialHash().Add(this, GetActorLocation());
+		WaterSimulation->UpdateWaterPuddleBudget(this, true);
+	}
+	else
+	{
+		WaterSimulation->GetPuddleSpatialHash().Remove(this);
+		WaterSimulation->UpdateWaterPuddleBudget(this, false);
+	}
+}
+
+void AWaterPuddle::FadeOutAndRelease(float StartDelay, float Duration)
+{
+	// Decal is only faded, puddle goes back to pool through life span
+	this->WaterPuddleDecalComponent->SetFadeOut(StartDelay, Duration, false);
+	SetLifeSpan(FMath::Max(StartDelay + Duration - WaterPuddleConstants::FadeReleaseMargin, KINDA_SMALL_NUMBER));
+}
+
+void AWaterPuddle::RetireWaterPuddle(float FadeDuration)
+{
+	if (this->bIsRetiring)
+	{
+		return;
 	}
+
+	this->bIsRetiring = true;
+	UpdateSpatialHashEntry(false);
+
+	// Leaving water simulation
+	UWorld* const World = GetWorld();
+	UWaterSimulationSubsystem* WaterSimulation = (World != nullptr) ? World->GetSubsystem<UWaterSimulationSubsystem>() : nullptr;
+	if (WaterSimulation != nullptr)
+	{
+		WaterSimulation->UnregisterWaterPuddle(this);
+	}
+
+	FadeOutAndRelease(0.0f, FadeDuration);
+}
+
+float AWaterPuddle::GetWaterPuddleRadius() const
+{
+	// Decal projects along its X axis, Y and Z lie on floor
+	return this->WaterPuddleDecalComponent->DecalSize.Y * this->WaterPuddleDecalComponent->GetComponentScale().Y;
+}
+
+FVector AWaterPuddle::ComputeMergedScale(const FVector& ScaleA, const FVector& ScaleB, float MaxScale)
+{
+	// Decal area grows with square of scale
+	FVector MergedScale(FMath::Sqrt(FMath::Square(ScaleA.X) + FMath::Square(ScaleB.X)),
+						FMath::Sqrt(FMath::Square(ScaleA.Y) + FMath::Square(ScaleB.Y)),
+						FMath::Sqrt(FMath::Square(ScaleA.Z) + FMath::Square(ScaleB.Z)));
+
+	return MergedScale.BoundToBox(FVector::ZeroVector, FVector(MaxScale));
+}
+
+bool AWaterPuddle::CanMergeScales(const FVector& ScaleA, const FVector& ScaleB, float MaxScale)
+{
+	// Largest axis decides, growth stops at the same point
+	return ComputeMergedScale(ScaleA, ScaleB, BIG_NUMBER).GetMax() <= MaxScale;
+}
+
+bool AWaterPuddle::AbsorbWaterPuddle(AWaterPuddle* Other)
+{
+	if ((Other == nullptr) || (Other == this))
+	{
+		return false;
+	}
+
+	// Keeping overdraw bounded, two puddles too large for one stay apart
+	if (!(CanMergeScales(GetActorScale3D(), Other->GetActorScale3D(), this->MaxWaterPuddleScale)))
+	{
+		return false;
+	}
+
+	// Moving to area weighted centre, staying on own floor height
+	float Area = FMath::Square(GetWaterPuddleRadius());
+	float OtherArea = FMath::Square(Other->GetWaterPuddleRadius());
+	FVector NewLocation = GetActorLocation();
+	if (Area + OtherArea > KINDA_SMALL_NUMBER)
+	{
+		FVector Centre = (GetActorLocation() * Area + Other->GetActorLocation() * OtherArea) / (Area + OtherArea);
+		NewLocation.X = Centre.X;
+		NewLocation.Y = Centre.Y;
+	}
+
+	this->LiquidVolume += Other->LiquidVolume;
+	FVector NewScale = ComputeMergedScale(GetActorScale3D(), Other->GetActorScale3D(), this->MaxWaterPuddleScale);
+
+	UWaterActorPoolSubsystem::ReleaseOrDestroy(Other);
+
+	SetActorLocation(NewLocation);
+	ApplyWaterPuddleScale(NewScale);
+	RestartGrowth();
+	UpdateSpatialHashEntry(true);
+
+	return true;
+}
+
+void AWaterPuddle::FixCollisionBoxScale()
+{
+	// Fixing water puddle collision box scale (only if something changed it)
+	FVector CurrentWPCBCScale = this->WaterPuddleCollisionBoxComponent->GetRelativeScale3D();
+	if (CurrentWPCBCScale.Z != 0.05f)
+	{
+		this->WaterPuddleCollisionBoxComponent->SetRelativeScale3D(FVector(CurrentWPCBCScale.X, CurrentWPCBCScale.Y, 0.05f));
+	}
+}
+
+void AWaterPuddle::AddLiquidVolume(float Volume)
+{
+	this->LiquidVolume += FMath::Max(Volume, 0.0f);
 }
 
 /*
@@ -212,61 +453,110 @@ void AWaterPuddle::SetWaterPuddleRotation()
 
 void AWaterPuddle::SetWaterfallFlag()
 {
-	// Setting counters
-	this->VisibleWaterfallCount = 0;
-	this->WaterfallCount = 0;
+	// Counters are kept by overlap and waterfall visibility events
+	this->WaterfallCount = this->OverlappingWaterfalls.Num();
+	this->IsUnderWaterfall = (this->VisibleWaterfallCount > 0);
+}
 
-	// Setting array with overlapping actors
-	TArray<AActor*> OverlappingActorsArray;
-	GetOverlappingActors(OverlappingActorsArray);
-	int64 LenOAA = OverlappingActorsArray.Num();
+void AWaterPuddle::OnWaterfallBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+{
+	AWaterfall* WaterfallActor = Cast<AWaterfall>(OtherActor);
+	if ((WaterfallActor == nullptr) || (OtherComp == nullptr) || !(OtherComp->ComponentHasTag(AWaterfall::CollisionBoxTag)))
+	{
+		return;
+	}
 
-	// Detecting waterfall actors
-	for (int64 i = 0; i < LenOAA; ++i)
+	// Listening to waterfall visibility from its first overlapping box on
+	int32& Count = this->OverlappingWaterfalls.FindOrAdd(WaterfallActor);
+	if (++Count == 1)
 	{
-		// Getting waterfall actor
-		AWaterfall* WaterfallActor = Cast<AWaterfall>(OverlappingActorsArray[i]);
-		if (WaterfallActor != nullptr)
+		WaterfallActor->OnWaterfallVisibilityChanged.AddUObject(this, &AWaterPuddle::OnWaterfallVisibilityChanged);
+		if (WaterfallActor->bIsWaterfallVisibleReported)
 		{
-			// Checking if waterfall is visible
-			UParticleSystemComponent* PSComp = Cast<UParticleSystemComponent>(WaterfallActor->GetDefaultSubobjectByName(TEXT("WaterfallParticleSystem")));
-			if ((PSComp != nullptr) && (PSComp->IsVisible()))
-			{
-				++this->VisibleWaterfallCount;
-			}
+			++this->VisibleWaterfallCount;
 		}
+
+		SetWaterfallFlag();
+		UpdateWaterSimulationRegistration();
 	}
+}
 
-	// Setting waterfall flag
-	if (this->VisibleWaterfallCount > 0)
+void AWaterPuddle::OnWaterfallEndOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
+{
+	AWaterfall* WaterfallActor = Cast<AWaterfall>(OtherActor);
+	if ((WaterfallActor == nullptr) || (OtherComp == nullptr) || !(OtherComp->ComponentHasTag(AWaterfall::CollisionBoxTag)))
 	{
-		// Setting array with overlapping components
-		TArray<UPrimitiveComponent*> OverlappingComponentsArray;
-		GetOverlappingComponents(OverlappingComponentsArray);
-		int64 LenOCA = OverlappingComponentsArray.Num();
+		return;
+	}
 
-		// Detecting visible overlapping waterfalls
-		for (int64 i = 0; i < LenOCA; ++i)
+	int32* Count = this->OverlappingWaterfalls.Find(WaterfallActor);
+	if ((Count != nullptr) && (--(*Count) <= 0))
+	{
+		this->OverlappingWaterfalls.Remove(WaterfallActor);
+		WaterfallActor->OnWaterfallVisibilityChanged.RemoveAll(this);
+		if (WaterfallActor->bIsWaterfallVisibleReported)
 		{
-			// Detecting waterfall collision components
-			UBoxComponent* BoxComp = Cast<UBoxComponent>(OverlappingComponentsArray[i]);
-			if ((BoxComp != nullptr) && (BoxComp->GetName() == "WaterfallCollisionBox"))
-			{
-				++this->WaterfallCount;
-			}
+			--this->VisibleWaterfallCount;
 		}
 
-		if (this->WaterfallCount > 0)
+		SetWaterfallFlag();
+		UpdateWaterSimulationRegistration();
+	}
+}
+
+void AWaterPuddle::OnWaterfallVisibilityChanged(AWaterfall* Waterfall, bool bIsVisible)
+{
+	// Updating visible waterfall counter
+	this->VisibleWaterfallCount += bIsVisible ? 1 : -1;
+
+	SetWaterfallFlag();
+	UpdateWaterSimulationRegistration();
+}
+
+void AWaterPuddle::ClearOverlappingWaterfalls()
+{
+	for (const TPair<TWeakObjectPtr<AWaterfall>, int32>& Entry : this->OverlappingWaterfalls)
+	{
+		if (Entry.Key.IsValid())
 		{
-			this->IsUnderWaterfall = true;
+			Entry.Key->OnWaterfallVisibilityChanged.RemoveAll(this);
 		}
-		else
+	}
+
+	this->OverlappingWaterfalls.Reset();
+	this->VisibleWaterfallCount = 0;
+}
+
+void AWaterPuddle::UpdateWaterSimulationRegistration()
+{
+	// Waiting for BeginPlay, pooled puddles wait until handed out, retiring ones stay out
+	if (!(HasActorBegunPlay()) || UWaterActorPoolSubsystem::IsActorPooled(this) || this->bIsRetiring)
+	{
+		return;
+	}
+
+	UWorld* const World = GetWorld();
+	UWaterSimulationSubsystem* WaterSimulation = (World != nullptr) ? World->GetSubsystem<UWaterSimulationSubsystem>() : nullptr;
+	if (WaterSimulation == nullptr)
+	{
+		return;
+	}
+
+	// Fed puddles are kept out of budget eviction
+	WaterSimulation->RescoreWaterPuddle(this);
+
+	// Puddles without visible waterfall do not change, so they cost nothing per frame
+	if (this->IsUnderWaterfall)
+	{
+		if (this->SimulationIndex == INDEX_NONE)
 		{
-			this->IsUnderWaterfall = false;
+			// Growing from scale puddle had while it was left out
+			RestartGrowth();
+			WaterSimulation->RegisterWaterPuddle(this);
 		}
 	}
 	else
 	{
-		this->IsUnderWaterfall = false;
+		WaterSimulation->UnregisterWaterPuddle(this);
 	}
 }
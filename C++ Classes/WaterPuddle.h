@@ -4,10 +4,25 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "WaterPoolable.h"
 #include "WaterPuddle.generated.h"
 
+class AWaterfall;
+
+namespace WaterPuddleConstants
+{
+	// Growth steps per second of one waterfall, DeltaWaterPuddleScale is scale added per step
+	const float GrowthStepsPerSecond = 60.0f;
+
+	// Growth step is not lowered below this
+	const float MinDeltaScale = 0.001f;
+
+	// Faded puddles go back to pool this long before decal ends its fade (which destroys decal)
+	const float FadeReleaseMargin = 0.05f;
+}
+
 UCLASS()
-class FACILITY_API AWaterPuddle : public AActor
+class FACILITY_API AWaterPuddle : public AActor, public IWaterPoolable
 {
 	GENERATED_BODY()
 	
@@ -20,9 +35,15 @@ protected:
 	virtual void BeginPlay() override;
 
 public:	
-	// Called every frame
+	// Called every frame (only while puddle is not driven by water simulation subsystem)
 	virtual void Tick(float DeltaTime) override;
 
+	// Called when puddle is removed from level
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	// Going back to actor pool instead of being destroyed when fade ends
+	virtual void LifeSpanExpired() override;
+
 public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Water Puddle Components")
 	USceneComponent* SceneRootComponent;
@@ -36,9 +57,11 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Water Puddle Options")
 	bool IsAbleToFade;
 
+	// Scale added per growth step under one waterfall
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Water Puddle Options")
 	float DeltaWaterPuddleScale;
 
+	// Growth step is lowered by this once puddle passes each quarter of max scale
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Water Puddle Options")
 	float DeltaWaterPuddleScaleStep;
 
@@ -51,27 +74,118 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Water Puddle Options")
 	float WaterPuddleDuration;
 
-	bool flag25;
-	bool flag50;
-	bool flag75;
 	bool IsUnderWaterfall;
 	// bool WasWaterPuddleRotated;
 
 	int64 WaterfallCount;
 	int64 VisibleWaterfallCount;
 
+	// Waterfalls whose puddle detectors overlap collision box, with number of overlapping boxes
+	TMap<TWeakObjectPtr<AWaterfall>, int32> OverlappingWaterfalls;
+
+	// Liquid volume received from water tanks, in cm^3
+	float LiquidVolume;
+
+	// Scale growth started from, and waterfall time received since (seconds times visible waterfalls)
+	FVector GrowthStartScale;
+	float InflowTime;
+
+	// Scale last set by growth, any other scale means puddle was scaled from outside
+	FVector GrownScale;
+
 	// FRotator OtherActorRot;
 
+	// Slot in water simulation subsystem
+	int32 SimulationIndex;
+
+	// World time puddle was last spawned, handed out, fed or grown, puddles idle for longest are evicted first
+	float LastFedTime;
+
+	// Set while puddle fades out after being evicted by puddle budget
+	bool bIsRetiring;
+
+	// Tag of puddle collision box, waterfalls look for it in overlap events
+	static const FName CollisionBoxTag;
+
+	// IWaterPoolable
+	virtual void OnAcquiredFromPool() override;
+	virtual void OnReleasedToPool() override;
+
+	// Getting growth added to every axis of start scale after inflow time.
+	// Growth is piecewise linear: step drops once smallest axis passes each quarter of max scale,
+	// and growth stops once largest axis reaches max scale
+	static float ComputeGrowth(const FVector& StartScale, float InflowTime, float DeltaScale, float DeltaScaleStep, float MaxScale);
+
+	// Getting scale of one puddle covering area of two puddles of same class, clamped to max scale
+	static FVector ComputeMergedScale(const FVector& ScaleA, const FVector& ScaleB, float MaxScale);
+
+	// Checking if area of two puddles fits into one puddle of max scale
+	static bool CanMergeScales(const FVector& ScaleA, const FVector& ScaleB, float MaxScale);
+
+	// Puddle update steps, used by Tick and by water simulation subsystem
+
+	UFUNCTION()
+	void SetWaterfallFlag();
+
+	UFUNCTION()
+	void ApplyWaterPuddleScale(FVector NewScale);
+
+	UFUNCTION()
+	void FixCollisionBoxScale();
+
+	// Starting growth again from current scale
+	UFUNCTION()
+	void RestartGrowth();
+
+	// Adding liquid drained by a water tank
+	UFUNCTION()
+	void AddLiquidVolume(float Volume);
+
+	// Joining water simulation while under visible waterfall, leaving it otherwise
+	UFUNCTION()
+	void UpdateWaterSimulationRegistration();
+
+	// Growing by waterfall time received (seconds times waterfalls), continuing closed form growth.
+	// Used under waterfalls and for streams landing next to puddle
+	UFUNCTION()
+	void GrowWaterPuddle(float ReceivedInflowTime);
+
+	// Adding puddle to spatial hash of its world at current location, or removing it
+	UFUNCTION()
+	void UpdateSpatialHashEntry(bool bIsInWorld);
+
+	// Getting radius of decal on floor in world units
+	UFUNCTION()
+	float GetWaterPuddleRadius() const;
+
+	// Taking over area and liquid of other puddle, which goes back to pool.
+	// Returns false and leaves both puddles as they are if merged puddle would be above max scale
+	UFUNCTION()
+	bool AbsorbWaterPuddle(AWaterPuddle* Other);
+
+	// Fading decal out, then going back to pool
+	UFUNCTION()
+	void FadeOutAndRelease(float StartDelay, float Duration);
+
+	// Leaving spatial hash, budget and simulation, then fading out
+	UFUNCTION()
+	void RetireWaterPuddle(float FadeDuration);
+
 protected:
 	UFUNCTION()
-	void ManageWaterPuddleScale();
+	void OnWaterfallBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
 
 	UFUNCTION()
-	void ScaleWaterPuddle();
+	void OnWaterfallEndOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex);
 
-	// UFUNCTION()
-	// void SetWaterPuddleRotation();
+	void OnWaterfallVisibilityChanged(AWaterfall* Waterfall, bool bIsVisible);
+
+	// Stopping to listen to all overlapping waterfalls
+	void ClearOverlappingWaterfalls();
 
 	UFUNCTION()
-	void SetWaterfallFlag();
+	void ScaleWaterPuddle(float DeltaTime);
+
+	// UFUNCTION()
+	// void SetWaterPuddleRotation();
 };
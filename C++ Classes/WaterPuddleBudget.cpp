@@ -0,0 +1,150 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "WaterPuddleBudget.h"
+
+FWaterPuddleBudget::FWaterPuddleBudget()
+{
+}
+
+void FWaterPuddleBudget::Update(AWaterPuddle* Puddle, float Score, bool bIsFed)
+{
+	if (Puddle == nullptr)
+	{
+		return;
+	}
+
+	if (bIsFed)
+	{
+		RemoveFromHeap(Puddle);
+		this->FedPuddles.Add(Puddle);
+		return;
+	}
+	this->FedPuddles.Remove(Puddle);
+
+	int32* Index = this->HeapIndices.Find(Puddle);
+	if (Index == nullptr)
+	{
+		FEntry Entry;
+		Entry.Puddle = Puddle;
+		Entry.Score = Score;
+
+		int32 NewIndex = this->Heap.Add(Entry);
+		this->HeapIndices.Add(Puddle, NewIndex);
+		SiftUp(NewIndex);
+		return;
+	}
+
+	// Moving towards top or bottom depending on score change
+	int32 CurrentIndex = *Index;
+	float OldScore = this->Heap[CurrentIndex].Score;
+	this->Heap[CurrentIndex].Score = Score;
+
+	if (Score < OldScore)
+	{
+		SiftUp(CurrentIndex);
+	}
+	else
+	{
+		SiftDown(CurrentIndex);
+	}
+}
+
+void FWaterPuddleBudget::Remove(AWaterPuddle* Puddle)
+{
+	this->FedPuddles.Remove(Puddle);
+	RemoveFromHeap(Puddle);
+}
+
+void FWaterPuddleBudget::RemoveFromHeap(AWaterPuddle* Puddle)
+{
+	int32 Index = INDEX_NONE;
+	if (!(this->HeapIndices.RemoveAndCopyValue(Puddle, Index)))
+	{
+		return;
+	}
+
+	// Filling slot with last entry, which may belong above or below it
+	int32 LastIndex = this->Heap.Num() - 1;
+	if (Index != LastIndex)
+	{
+		this->Heap[Index] = this->Heap[LastIndex];
+		this->HeapIndices[this->Heap[Index].Puddle] = Index;
+	}
+	this->Heap.RemoveAt(LastIndex, 1, false);
+
+	if (Index < this->Heap.Num())
+	{
+		SiftUp(Index);
+		SiftDown(this->HeapIndices[this->Heap[Index].Puddle]);
+	}
+}
+
+AWaterPuddle* FWaterPuddleBudget::PopLowest()
+{
+	if (this->Heap.Num() == 0)
+	{
+		return nullptr;
+	}
+
+	AWaterPuddle* Puddle = this->Heap[0].Puddle;
+	RemoveFromHeap(Puddle);
+
+	return Puddle;
+}
+
+void FWaterPuddleBudget::SiftUp(int32 Index)
+{
+	while (Index > 0)
+	{
+		int32 Parent = (Index - 1) / 2;
+		if (this->Heap[Parent].Score <= this->Heap[Index].Score)
+		{
+			break;
+		}
+
+		SwapEntries(Index, Parent);
+		Index = Parent;
+	}
+}
+
+void FWaterPuddleBudget::SiftDown(int32 Index)
+{
+	int32 Count = this->Heap.Num();
+	for (;;)
+	{
+		int32 Smallest = Index;
+		int32 Left = Index * 2 + 1;
+		int32 Right = Left + 1;
+
+		if ((Left < Count) && (this->Heap[Left].Score < this->Heap[Smallest].Score))
+		{
+			Smallest = Left;
+		}
+		if ((Right < Count) && (this->Heap[Right].Score < this->Heap[Smallest].Score))
+		{
+			Smallest = Right;
+		}
+
+		if (Smallest == Index)
+		{
+			break;
+		}
+
+		SwapEntries(Index, Smallest);
+		Index = Smallest;
+	}
+}
+
+void FWaterPuddleBudget::SwapEntries(int32 A, int32 B)
+{
+	this->Heap.Swap(A, B);
+	this->HeapIndices[this->Heap[A].Puddle] = A;
+	this->HeapIndices[this->Heap[B].Puddle] = B;
+}
+
+void FWaterPuddleBudget::Reset()
+{
+	this->Heap.Reset();
+	this->HeapIndices.Reset();
+	this->FedPuddles.Reset();
+}
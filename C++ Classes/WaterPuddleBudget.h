@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class AWaterPuddle;
+
+// Live puddles ordered by importance, least important first.
+// Binary min-heap with index of every puddle in a map, so adding, rescoring and removing a puddle
+// are O(log n) and the puddle to evict is always at the top. Heap slots are dense, so rescoring
+// passes over all puddles can be spread over frames by index. Fed puddles count towards budget
+// but are kept out of heap, so they are never evicted whatever their score.
+class FACILITY_API FWaterPuddleBudget
+{
+public:
+	FWaterPuddleBudget();
+
+	// Adding puddle with score, or moving it to new score. Fed puddles go to fed tier instead of heap
+	void Update(AWaterPuddle* Puddle, float Score, bool bIsFed);
+
+	void Remove(AWaterPuddle* Puddle);
+
+	bool Contains(AWaterPuddle* Puddle) const { return this->HeapIndices.Contains(Puddle) || this->FedPuddles.Contains(Puddle); }
+
+	// Removing and returning least important puddle that is not fed, nullptr if there is none
+	AWaterPuddle* PopLowest();
+
+	// Getting all live puddles, fed ones included
+	int32 Num() const { return this->Heap.Num() + this->FedPuddles.Num(); }
+
+	// Getting puddles in heap, which are the ones that can be evicted
+	int32 NumEvictable() const { return this->Heap.Num(); }
+
+	AWaterPuddle* GetPuddle(int32 Index) const { return this->Heap[Index].Puddle; }
+
+	void Reset();
+
+protected:
+	void RemoveFromHeap(AWaterPuddle* Puddle);
+
+	void SiftUp(int32 Index);
+	void SiftDown(int32 Index);
+
+	// Swapping heap slots and their indices
+	void SwapEntries(int32 A, int32 B);
+
+	struct FEntry
+	{
+		AWaterPuddle* Puddle;
+		float Score;
+	};
+
+	TArray<FEntry> Heap;
+	TMap<AWaterPuddle*, int32> HeapIndices;
+	TSet<AWaterPuddle*> FedPuddles;
+};
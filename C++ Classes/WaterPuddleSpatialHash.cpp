@@ -0,0 +1,137 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "WaterPuddleSpatialHash.h"
+#include "Math/UnrealMathUtility.h"
+
+template<typename KeyType>
+TWaterSpatialHash<KeyType>::TWaterSpatialHash()
+{
+}
+
+template<typename KeyType>
+FIntPoint TWaterSpatialHash<KeyType>::GetCell(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / WaterPuddleSpatialHashConstants::CellSize),
+					 FMath::FloorToInt(Location.Y / WaterPuddleSpatialHashConstants::CellSize));
+}
+
+template<typename KeyType>
+void TWaterSpatialHash<KeyType>::Add(KeyType Key, const FVector& Location)
+{
+	if (Key == KeyType())
+	{
+		return;
+	}
+
+	Remove(Key);
+
+	FEntry Entry;
+	Entry.Key = Key;
+	Entry.Location = Location;
+	Entry.Cell = GetCell(Location);
+
+	int32 Index = this->Entries.Add(Entry);
+	this->Cells.FindOrAdd(Entry.Cell).Add(Index);
+	this->EntryIndices.Add(Key, Index);
+}
+
+template<typename KeyType>
+void TWaterSpatialHash<KeyType>::Remove(KeyType Key)
+{
+	int32 Index;
+	if (!(this->EntryIndices.RemoveAndCopyValue(Key, Index)))
+	{
+		return;
+	}
+
+	// Taking entry out of its cell, dropping empty cells so map only grows with wet floor area
+	FIntPoint Cell = this->Entries[Index].Cell;
+	TArray<int32, TInlineAllocator<4>>& CellEntries = this->Cells.FindChecked(Cell);
+	CellEntries.RemoveSingleSwap(Index, false);
+	if (CellEntries.Num() == 0)
+	{
+		this->Cells.Remove(Cell);
+	}
+
+	// Moving last entry into freed slot
+	int32 LastIndex = this->Entries.Num() - 1;
+	if (Index != LastIndex)
+	{
+		const FEntry& LastEntry = this->Entries[LastIndex];
+		TArray<int32, TInlineAllocator<4>>& LastCellEntries = this->Cells.FindChecked(LastEntry.Cell);
+		LastCellEntries[LastCellEntries.Find(LastIndex)] = Index;
+		this->EntryIndices[LastEntry.Key] = Index;
+	}
+
+	this->Entries.RemoveAtSwap(Index, 1, false);
+}
+
+template<typename KeyType>
+template<typename FunctionType>
+void TWaterSpatialHash<KeyType>::ForEachInCells(const FVector& Location, float Radius, const FunctionType& Function) const
+{
+	FIntPoint MinCell = GetCell(Location - FVector(Radius, Radius, 0.0f));
+	FIntPoint MaxCell = GetCell(Location + FVector(Radius, Radius, 0.0f));
+
+	for (int32 y = MinCell.Y; y <= MaxCell.Y; ++y)
+	{
+		for (int32 x = MinCell.X; x <= MaxCell.X; ++x)
+		{
+			const TArray<int32, TInlineAllocator<4>>* CellEntries = this->Cells.Find(FIntPoint(x, y));
+			if (CellEntries == nullptr)
+			{
+				continue;
+			}
+
+			for (int32 Index : *CellEntries)
+			{
+				Function(Index);
+			}
+		}
+	}
+}
+
+template<typename KeyType>
+KeyType TWaterSpatialHash<KeyType>::FindClosest(const FVector& Location, float Radius) const
+{
+	KeyType ClosestKey = KeyType();
+	float ClosestDistanceSquared = FMath::Square(Radius);
+
+	ForEachInCells(Location, Radius, [this, &Location, &ClosestKey, &ClosestDistanceSquared](int32 Index)
+	{
+		float DistanceSquared = FVector::DistSquared(this->Entries[Index].Location, Location);
+		if (DistanceSquared <= ClosestDistanceSquared)
+		{
+			ClosestDistanceSquared = DistanceSquared;
+			ClosestKey = this->Entries[Index].Key;
+		}
+	});
+
+	return ClosestKey;
+}
+
+template<typename KeyType>
+void TWaterSpatialHash<KeyType>::FindInRadius(const FVector& Location, float Radius, TArray<KeyType, TInlineAllocator<8>>& OutKeys) const
+{
+	float RadiusSquared = FMath::Square(Radius);
+
+	ForEachInCells(Location, Radius, [this, &Location, RadiusSquared, &OutKeys](int32 Index)
+	{
+		if (FVector::DistSquared(this->Entries[Index].Location, Location) <= RadiusSquared)
+		{
+			OutKeys.Add(this->Entries[Index].Key);
+		}
+	});
+}
+
+template<typename KeyType>
+void TWaterSpatialHash<KeyType>::Reset()
+{
+	this->Entries.Reset();
+	this->Cells.Reset();
+	this->EntryIndices.Reset();
+}
+
+// Puddles in game, plain ids in benchmarks
+template class TWaterSpatialHash<AWaterPuddle*>;
+template class TWaterSpatialHash<int32>;
@@ -0,0 +1,66 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class AWaterPuddle;
+
+namespace WaterPuddleSpatialHashConstants
+{
+	// Cell edge in world units, about the size of a grown puddle
+	const float CellSize = 200.0f;
+}
+
+// Uniform grid of puddle locations on world XY plane.
+// Puddles lie on floors, so Z only matters for the distance check. A query looks at cells
+// overlapping its radius, which is 4 cells for radius up to half a cell. Entries are kept
+// dense, so passes over all puddles can be spread over frames by index.
+// Keys are only compared and hashed, so benchmarks can fill the grid with plain ids.
+template<typename KeyType>
+class TWaterSpatialHash
+{
+public:
+	TWaterSpatialHash();
+
+	// Adding key at location, moving it if it is already in grid
+	void Add(KeyType Key, const FVector& Location);
+
+	void Remove(KeyType Key);
+
+	// Getting key closest to location within radius, default key (nullptr) if there is none
+	KeyType FindClosest(const FVector& Location, float Radius) const;
+
+	// Getting all keys within radius of location
+	void FindInRadius(const FVector& Location, float Radius, TArray<KeyType, TInlineAllocator<8>>& OutKeys) const;
+
+	int32 Num() const { return this->Entries.Num(); }
+
+	KeyType GetKey(int32 Index) const { return this->Entries[Index].Key; }
+
+	void Reset();
+
+protected:
+	FIntPoint GetCell(const FVector& Location) const;
+
+	// Calling function with index of every entry in cells overlapping radius
+	template<typename FunctionType>
+	void ForEachInCells(const FVector& Location, float Radius, const FunctionType& Function) const;
+
+	struct FEntry
+	{
+		KeyType Key;
+		FVector Location;
+		FIntPoint Cell;
+	};
+
+	TArray<FEntry> Entries;
+
+	// Entry indices per cell
+	TMap<FIntPoint, TArray<int32, TInlineAllocator<4>>> Cells;
+
+	// Entry index of every key in grid
+	TMap<KeyType, int32> EntryIndices;
+};
+
+typedef TWaterSpatialHash<AWaterPuddle*> FWaterPuddleSpatialHash;
@@ -0,0 +1,1653 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "WaterSimulationSubsystem.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Components/PrimitiveComponent.h"
+#include "Kismet/GameplayStatics.h"
+#include "Sound/SoundBase.h"
+#include "CollisionQueryParams.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+#include "Math/UnrealMathUtility.h"
+
+// Assets
+#include "LiquidOutflow.h"
+#include "LiquidSlosh.h"
+#include "WaterTank.h"
+#include "Waterfall.h"
+#include "WaterPuddle.h"
+#include "WaterActorPoolSubsystem.h"
+#include "WaterWetnessDecals.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogWaterSimulation, Log, All);
+
+DECLARE_CYCLE_STAT(TEXT("Water Simulation Tick"), STAT_WaterSimulation_Tick, STATGROUP_WaterSimulation);
+DECLARE_CYCLE_STAT(TEXT("Water Tanks"), STAT_WaterSimulation_Tanks, STATGROUP_WaterSimulation);
+DECLARE_CYCLE_STAT(TEXT("Water Tank Slicing"), STAT_WaterSimulation_Slicing, STATGROUP_WaterSimulation);
+DECLARE_CYCLE_STAT(TEXT("Water Tank Slice Upload"), STAT_WaterSimulation_SliceUpload, STATGROUP_WaterSimulation);
+DECLARE_CYCLE_STAT(TEXT("Waterfalls"), STAT_WaterSimulation_Waterfalls, STATGROUP_WaterSimulation);
+DECLARE_CYCLE_STAT(TEXT("Water Puddles"), STAT_WaterSimulation_Puddles, STATGROUP_WaterSimulation);
+DECLARE_CYCLE_STAT(TEXT("Water Tank Breaks"), STAT_WaterSimulation_Breaks, STATGROUP_WaterSimulation);
+DECLARE_CYCLE_STAT(TEXT("Water Puddle Coalescing"), STAT_WaterSimulation_Coalescing, STATGROUP_WaterSimulation);
+DECLARE_CYCLE_STAT(TEXT("Water Wetness"), STAT_WaterSimulation_Wetness, STATGROUP_WaterSimulation);
+DECLARE_CYCLE_STAT(TEXT("Water Puddle Budget"), STAT_WaterSimulation_Budget, STATGROUP_WaterSimulation);
+DECLARE_CYCLE_STAT(TEXT("Glass Hit Effects"), STAT_WaterSimulation_GlassHits, STATGROUP_WaterSimulation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Active Water Tanks"), STAT_WaterSimulation_ActiveTanks, STATGROUP_WaterSimulation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rebuilt Water Tanks"), STAT_WaterSimulation_DirtyTanks, STATGROUP_WaterSimulation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Deferred Water Tanks"), STAT_WaterSimulation_DeferredTanks, STATGROUP_WaterSimulation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Full LOD Water Tanks"), STAT_WaterSimulation_FullTanks, STATGROUP_WaterSimulation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Reduced LOD Water Tanks"), STAT_WaterSimulation_ReducedTanks, STATGROUP_WaterSimulation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Frozen LOD Water Tanks"), STAT_WaterSimulation_FrozenTanks, STATGROUP_WaterSimulation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Flowing Water Tank Holes"), STAT_WaterSimulation_FlowingHoles, STATGROUP_WaterSimulation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Waterfall Proxies In Use"), STAT_WaterSimulation_UsedProxies, STATGROUP_WaterSimulation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Hashed Water Puddles"), STAT_WaterSimulation_HashedPuddles, STATGROUP_WaterSimulation);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Coalesced Water Puddles"), STAT_WaterSimulation_CoalescedPuddles, STATGROUP_WaterSimulation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Live Water Puddles"), STAT_WaterSimulation_LivePuddles, STATGROUP_WaterSimulation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Water Puddle Budget"), STAT_WaterSimulation_PuddleBudget, STATGROUP_WaterSimulation);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Evicted Water Puddles"), STAT_WaterSimulation_EvictedPuddles, STATGROUP_WaterSimulation);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Glass Hits"), STAT_WaterSimulation_GlassHits_Count, STATGROUP_WaterSimulation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Queued Glass Hit Effects"), STAT_WaterSimulation_QueuedGlassHits, STATGROUP_WaterSimulation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Wet Tiles"), STAT_WaterSimulation_WetTiles, STATGROUP_WaterSimulation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Flowing Wet Tiles"), STAT_WaterSimulation_FlowingTiles, STATGROUP_WaterSimulation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Wet Tiles Waiting For Ground"), STAT_WaterSimulation_GroundTraceTiles, STATGROUP_WaterSimulation);
+
+namespace WaterSimulationHelpers
+{
+	// Elements per parallel task, pure stages are too cheap to split finer
+	const int32 ChunkSize = 64;
+
+	// Depth below broken tank searched for ground
+	const float BreakTraceDepth = 200.0f;
+
+	// Puddle importance per cm of radius, per second since puddle was last fed or grew and per cm of view distance
+	const float PuddleRadiusImportance = 0.01f;
+	const float PuddleIdleTimeImportance = 1.0f / 60.0f;
+	const float PuddleDistanceImportance = 0.001f;
+
+	TAutoConsoleVariable<int32> CVarAsyncSlicing(
+		TEXT("Water.Simulation.AsyncSlicing"),
+		1,
+		TEXT("1: liquid meshes are sliced on task graph and shown next frame. 0: sliced and shown in same frame."));
+
+	TAutoConsoleVariable<int32> CVarMaxWaterfallProxies(
+		TEXT("Water.Simulation.MaxWaterfallProxies"),
+		32,
+		TEXT("Waterfalls shown at once. Flowing holes closest to viewers get them, other holes drain without visuals."));
+
+	TAutoConsoleVariable<float> CVarWaterfallProxyDistance(
+		TEXT("Water.Simulation.WaterfallProxyDistance"),
+		4000.0f,
+		TEXT("Holes further than this from every viewer get no waterfall."));
+
+	TAutoConsoleVariable<int32> CVarCoalesceChecks(
+		TEXT("Water.Puddles.CoalesceChecksPerFrame"),
+		8,
+		TEXT("Puddles checked for overlapping neighbours per frame. Overlapping puddles are merged into one. 0 disables coalescing."));
+
+	TAutoConsoleVariable<float> CVarCoalesceOverlap(
+		TEXT("Water.Puddles.CoalesceOverlap"),
+		0.75f,
+		TEXT("Puddles are merged once centre distance is below this share of their summed radii."));
+
+	TAutoConsoleVariable<int32> CVarWetnessMode(
+		TEXT("Water.Wetness.Enabled"),
+		0,
+		TEXT("1: waterfalls and broken tanks wet a sparse floor field shown by a few large decals. 0: they spawn and grow puddle actors."));
+
+	TAutoConsoleVariable<float> CVarWetnessEvaporation(
+		TEXT("Water.Wetness.EvaporationRate"),
+		0.002f,
+		TEXT("Water depth (cm) evaporating from wetness field per second. Dry tiles are dropped."));
+
+	TAutoConsoleVariable<int32> CVarPuddleBudget(
+		TEXT("Water.Puddles.Budget"),
+		256,
+		TEXT("Puddles alive at once. Least important puddles (small, old, far, not fed) fade out and go back to pool. 0 disables budget."));
+
+	TAutoConsoleVariable<int32> CVarPuddleBudgetRescores(
+		TEXT("Water.Puddles.BudgetRescoresPerFrame"),
+		16,
+		TEXT("Puddles whose view distance is scored again per frame. Size and feeding are scored when they change."));
+
+	TAutoConsoleVariable<float> CVarPuddleEvictFadeTime(
+		TEXT("Water.Puddles.EvictFadeTime"),
+		2.0f,
+		TEXT("Seconds puddles evicted by budget take to fade out."));
+
+	TAutoConsoleVariable<int32> CVarGlassHitEffects(
+		TEXT("Water.GlassHits.MaxEffectsPerFrame"),
+		16,
+		TEXT("Glass feathers spawned per frame. Further hits wait for next frames, holes are made right away."));
+
+	TAutoConsoleVariable<int32> CVarGlassHitSounds(
+		TEXT("Water.GlassHits.MaxSoundsPerFrame"),
+		4,
+		TEXT("Glass smash sounds played per frame, sounds of further hits in same batch are skipped."));
+
+	TAutoConsoleVariable<int32> CVarWetnessGroundTraces(
+		TEXT("Water.Wetness.GroundTracesPerFrame"),
+		256,
+		TEXT("Async floor traces sent per frame for new wetness tiles. Tiles are flat until all their cells are traced."));
+
+	TAutoConsoleVariable<float> CVarSliceBudget(
+		TEXT("Water.Simulation.SliceBudgetMs"),
+		2.0f,
+		TEXT("CPU time all liquid slices of a frame may take. Least significant tanks wait for later frames. 0 disables budget."));
+
+	// Getting camera locations of local players
+	void GetViewLocations(UWorld* World, TArray<FVector, TInlineAllocator<4>>& OutLocations)
+	{
+		for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+		{
+			APlayerController* PlayerController = It->Get();
+			if ((PlayerController != nullptr) && (PlayerController->PlayerCameraManager != nullptr))
+			{
+				OutLocations.Add(PlayerController->PlayerCameraManager->GetCameraLocation());
+			}
+		}
+	}
+
+	// Getting distance to closest viewer
+	float GetViewDistance(const TArray<FVector, TInlineAllocator<4>>& ViewLocations, const FVector& Location)
+	{
+		float MinDistanceSquared = (ViewLocations.Num() > 0) ? MAX_flt : 0.0f;
+		for (const FVector& ViewLocation : ViewLocations)
+		{
+			MinDistanceSquared = FMath::Min(MinDistanceSquared, FVector::DistSquared(ViewLocation, Location));
+		}
+
+		return FMath::Sqrt(MinDistanceSquared);
+	}
+
+	// Near and visible tanks come first when budget runs out
+	float ComputeSignificance(float ViewDistance, bool bWasRecentlyRendered)
+	{
+		return (bWasRecentlyRendered ? 1.0f : 0.1f) / (1.0f + ViewDistance / 1000.0f);
+	}
+
+	// Large, new, near and fed puddles are kept when puddle budget runs out. Spawn time grows
+	// with age of world, so order of puddles by age never changes and needs no rescoring
+	// Fed puddles are kept out of eviction by puddle budget, so their score does not matter
+	float ComputePuddleImportance(float Radius, float IdleTime, float ViewDistance)
+	{
+		return Radius * PuddleRadiusImportance
+			 - FMath::Max(IdleTime, 0.0f) * PuddleIdleTimeImportance
+			 - ViewDistance * PuddleDistanceImportance;
+	}
+
+	template<typename FunctionType>
+	void ParallelForChunks(int32 Count, const FunctionType& Function, bool bForceSingleThread)
+	{
+		int32 NumChunks = FMath::DivideAndRoundUp(Count, ChunkSize);
+		ParallelFor(NumChunks, [&Function, Count](int32 Chunk)
+		{
+			int32 Start = Chunk * ChunkSize;
+			int32 End = FMath::Min(Start + ChunkSize, Count);
+			for (int32 i = Start; i < End; ++i)
+			{
+				Function(i);
+			}
+		}, bForceSingleThread);
+	}
+
+	void RunBenchmarkCommand(const TArray<FString>& Args)
+	{
+		int32 Iterations = (Args.Num() > 0) ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 200;
+		UWaterSimulationSubsystem::RunScalingBenchmark(Iterations);
+	}
+
+	FAutoConsoleCommand BenchmarkCommand(
+		TEXT("Water.Simulation.Benchmark"),
+		TEXT("Times water simulation stages for 10 to 2000 actors of each kind. Optional argument: iterations per size."),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&RunBenchmarkCommand));
+
+	void RunWetnessBenchmarkCommand(const TArray<FString>& Args)
+	{
+		int32 NumEvents = (Args.Num() > 0) ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 1000;
+		UWaterSimulationSubsystem::RunWetnessBenchmark(NumEvents);
+	}
+
+	FAutoConsoleCommand WetnessBenchmarkCommand(
+		TEXT("Water.Wetness.Benchmark"),
+		TEXT("Times puddle and wetness field math for spill events, without actor spawns, overlaps, decals or texture uploads. Optional argument: number of spills (default 1000)."),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&RunWetnessBenchmarkCommand));
+}
+
+int32 FWaterTankSimData::Add(AWaterTank* Tank, float CurrentTime)
+{
+	this->Location.Add(FVector::ZeroVector);
+	this->LastLocation.Add(FVector::ZeroVector);
+	this->Velocity.Add(FVector::ZeroVector);
+	this->Acceleration.Add(FVector::ZeroVector);
+	this->PlaneRotation.Add(FRotator::ZeroRotator);
+	this->Viscosity.Add(0.0f);
+	this->SloshAngleX.Add(0.0f);
+	this->SloshAngleY.Add(0.0f);
+	this->SloshRateX.Add(0.0f);
+	this->SloshRateY.Add(0.0f);
+	this->SloshTargetX.Add(0.0f);
+	this->SloshTargetY.Add(0.0f);
+	this->SloshStiffness.Add(0.0f);
+	this->SloshDamping.Add(0.0f);
+	this->FillHeight.Add(0.0f);
+	this->Volume.Add(0.0f);
+	this->Capacity.Add(0.0f);
+	this->SurfaceArea.Add(0.0f);
+	this->DrainedVolume.Add(0.0f);
+	this->OutflowTimeAccumulator.Add(0.0f);
+	this->HoleStart.Add(0);
+	this->HoleCount.Add(0);
+	this->DeltaTime.Add(0.0f);
+	this->LastUpdateTime.Add(CurrentTime);
+	this->NextUpdateTime.Add(CurrentTime);
+	this->Significance.Add(0.0f);
+	this->bIsActive.Add(false);
+	this->bIsAtRest.Add(true);
+	this->bIsDirty.Add(false);
+
+	return this->Actors.Add(Tank);
+}
+
+void FWaterTankSimData::RemoveAtSwap(int32 Index)
+{
+	this->Actors.RemoveAtSwap(Index, 1, false);
+	this->Location.RemoveAtSwap(Index, 1, false);
+	this->LastLocation.RemoveAtSwap(Index, 1, false);
+	this->Velocity.RemoveAtSwap(Index, 1, false);
+	this->Acceleration.RemoveAtSwap(Index, 1, false);
+	this->PlaneRotation.RemoveAtSwap(Index, 1, false);
+	this->Viscosity.RemoveAtSwap(Index, 1, false);
+	this->SloshAngleX.RemoveAtSwap(Index, 1, false);
+	this->SloshAngleY.RemoveAtSwap(Index, 1, false);
+	this->SloshRateX.RemoveAtSwap(Index, 1, false);
+	this->SloshRateY.RemoveAtSwap(Index, 1, false);
+	this->SloshTargetX.RemoveAtSwap(Index, 1, false);
+	this->SloshTargetY.RemoveAtSwap(Index, 1, false);
+	this->SloshStiffness.RemoveAtSwap(Index, 1, false);
+	this->SloshDamping.RemoveAtSwap(Index, 1, false);
+	this->FillHeight.RemoveAtSwap(Index, 1, false);
+	this->Volume.RemoveAtSwap(Index, 1, false);
+	this->Capacity.RemoveAtSwap(Index, 1, false);
+	this->SurfaceArea.RemoveAtSwap(Index, 1, false);
+	this->DrainedVolume.RemoveAtSwap(Index, 1, false);
+	this->OutflowTimeAccumulator.RemoveAtSwap(Index, 1, false);
+	this->HoleStart.RemoveAtSwap(Index, 1, false);
+	this->HoleCount.RemoveAtSwap(Index, 1, false);
+	this->DeltaTime.RemoveAtSwap(Index, 1, false);
+	this->LastUpdateTime.RemoveAtSwap(Index, 1, false);
+	this->NextUpdateTime.RemoveAtSwap(Index, 1, false);
+	this->Significance.RemoveAtSwap(Index, 1, false);
+	this->bIsActive.RemoveAtSwap(Index, 1, false);
+	this->bIsAtRest.RemoveAtSwap(Index, 1, false);
+	this->bIsDirty.RemoveAtSwap(Index, 1, false);
+}
+
+int32 FWaterHoleSimData::Add(int32 Hole, float HoleArea, float HoleHead)
+{
+	this->Area.Add(HoleArea);
+	this->Head.Add(HoleHead);
+	this->Outflow.Add(0.0f);
+
+	return this->HoleIndex.Add(Hole);
+}
+
+void FWaterHoleSimData::Reset()
+{
+	this->HoleIndex.Reset();
+	this->Area.Reset();
+	this->Head.Reset();
+	this->Outflow.Reset();
+}
+
+int32 FWaterfallSimData::Add(AWaterfall* Waterfall)
+{
+	this->ForwardVector.Add(FVector::ForwardVector);
+	this->MaxAngle.Add(0.0f);
+	this->LocationZ.Add(0.0f);
+	this->TankPlaneZ.Add(0.0f);
+	this->TankFillHeight.Add(0.0f);
+	this->bHasWaterTank.Add(false);
+	this->bIsVisible.Add(false);
+
+	return this->Actors.Add(Waterfall);
+}
+
+void FWaterfallSimData::RemoveAtSwap(int32 Index)
+{
+	this->Actors.RemoveAtSwap(Index, 1, false);
+	this->ForwardVector.RemoveAtSwap(Index, 1, false);
+	this->MaxAngle.RemoveAtSwap(Index, 1, false);
+	this->LocationZ.RemoveAtSwap(Index, 1, false);
+	this->TankPlaneZ.RemoveAtSwap(Index, 1, false);
+	this->TankFillHeight.RemoveAtSwap(Index, 1, false);
+	this->bHasWaterTank.RemoveAtSwap(Index, 1, false);
+	this->bIsVisible.RemoveAtSwap(Index, 1, false);
+}
+
+int32 FWaterPuddleSimData::Add(AWaterPuddle* Puddle)
+{
+	this->Scale.Add(FVector::OneVector);
+	this->StartScale.Add(FVector::OneVector);
+	this->InflowTime.Add(0.0f);
+	this->DeltaScale.Add(0.0f);
+	this->DeltaScaleStep.Add(0.0f);
+	this->MaxScale.Add(0.0f);
+	this->VisibleWaterfallCount.Add(0);
+	this->bIsUnderWaterfall.Add(false);
+
+	return this->Actors.Add(Puddle);
+}
+
+void FWaterPuddleSimData::RemoveAtSwap(int32 Index)
+{
+	this->Actors.RemoveAtSwap(Index, 1, false);
+	this->Scale.RemoveAtSwap(Index, 1, false);
+	this->StartScale.RemoveAtSwap(Index, 1, false);
+	this->InflowTime.RemoveAtSwap(Index, 1, false);
+	this->DeltaScale.RemoveAtSwap(Index, 1, false);
+	this->DeltaScaleStep.RemoveAtSwap(Index, 1, false);
+	this->MaxScale.RemoveAtSwap(Index, 1, false);
+	this->VisibleWaterfallCount.RemoveAtSwap(Index, 1, false);
+	this->bIsUnderWaterfall.RemoveAtSwap(Index, 1, false);
+}
+
+UWaterSimulationSubsystem::UWaterSimulationSubsystem()
+{
+	this->bIsInitialized = false;
+	this->bIsSimulating = false;
+	this->bHasRemovedEntries = false;
+	this->SloshTimeAccumulator = 0.0f;
+	this->CoalesceCursor = 0;
+	this->BudgetCursor = 0;
+}
+
+void UWaterSimulationSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	this->WetnessField.SetGroundRequest([this](const FIntVector& Key, float FloorZ)
+	{
+		RequestWetnessGround(Key, FloorZ);
+	});
+
+	this->bIsInitialized = true;
+}
+
+void UWaterSimulationSubsystem::Deinitialize()
+{
+	this->bIsInitialized = false;
+	this->QueuedBreaks.Empty();
+	this->TracedBreaks.Empty();
+	this->QueuedGlassHits.Empty();
+	this->PuddleSpatialHash.Reset();
+	this->PuddleBudget.Reset();
+	this->WetnessField.Reset();
+	this->GroundTraces.Empty();
+	this->GroundTraceQueue.Empty();
+	this->WetnessDecals.Reset();
+
+	Super::Deinitialize();
+}
+
+bool UWaterSimulationSubsystem::IsTickable() const
+{
+	UWorld* const World = GetWorld();
+
+	return this->bIsInitialized && !(IsTemplate()) && (World != nullptr) && World->IsGameWorld();
+}
+
+TStatId UWaterSimulationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UWaterSimulationSubsystem, STATGROUP_Tickables);
+}
+
+void UWaterSimulationSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_WaterSimulation_Tick);
+
+	UWorld* const World = GetWorld();
+	if (World == nullptr)
+	{
+		return;
+	}
+
+	this->bIsSimulating = true;
+
+	TickWaterTanks(World->GetTimeSeconds(), DeltaTime);
+	AssignWaterfallProxies();
+	TickWaterfalls(DeltaTime);
+	TickWaterPuddles(DeltaTime);
+
+	this->bIsSimulating = false;
+
+	CoalesceWaterPuddles();
+	TickWaterTankBreaks();
+	TickWaterPuddleBudget();
+	TickGlassHits();
+	TickWetness(DeltaTime);
+
+	// Actors destroyed during simulation only cleared their slots
+	if (this->bHasRemovedEntries)
+	{
+		CompactRemovedEntries();
+	}
+}
+
+void UWaterSimulationSubsystem::RegisterWaterTank(AWaterTank* Tank)
+{
+	if ((Tank == nullptr) || (Tank->SimulationIndex != INDEX_NONE))
+	{
+		return;
+	}
+
+	UWorld* const World = GetWorld();
+	float CurrentTime = (World != nullptr) ? World->GetTimeSeconds() : 0.0f;
+
+	int32 Index = this->TankData.Add(Tank, CurrentTime);
+	this->TankData.LastLocation[Index] = Tank->LastPosition;
+	this->TankData.Velocity[Index] = Tank->LiquidVelocity;
+	this->TankData.Acceleration[Index] = Tank->LiquidAcceleration;
+	this->TankData.SloshAngleX[Index] = Tank->SloshAngle.X;
+	this->TankData.SloshAngleY[Index] = Tank->SloshAngle.Y;
+	this->TankData.SloshRateX[Index] = Tank->SloshRate.X;
+	this->TankData.SloshRateY[Index] = Tank->SloshRate.Y;
+	Tank->SimulationIndex = Index;
+}
+
+void UWaterSimulationSubsystem::UnregisterWaterTank(AWaterTank* Tank)
+{
+	if ((Tank == nullptr) || !(this->TankData.Actors.IsValidIndex(Tank->SimulationIndex)) || (this->TankData.Actors[Tank->SimulationIndex] != Tank))
+	{
+		return;
+	}
+
+	int32 Index = Tank->SimulationIndex;
+	Tank->SimulationIndex = INDEX_NONE;
+
+	// Keeping arrays stable while they are iterated
+	if (this->bIsSimulating)
+	{
+		this->TankData.Actors[Index] = nullptr;
+		this->bHasRemovedEntries = true;
+		return;
+	}
+
+	this->TankData.RemoveAtSwap(Index);
+	if (this->TankData.Actors.IsValidIndex(Index) && (this->TankData.Actors[Index] != nullptr))
+	{
+		this->TankData.Actors[Index]->SimulationIndex = Index;
+	}
+}
+
+void UWaterSimulationSubsystem::RegisterWaterfall(AWaterfall* Waterfall)
+{
+	if ((Waterfall == nullptr) || (Waterfall->SimulationIndex != INDEX_NONE))
+	{
+		return;
+	}
+
+	Waterfall->SimulationIndex = this->WaterfallData.Add(Waterfall);
+}
+
+void UWaterSimulationSubsystem::UnregisterWaterfall(AWaterfall* Waterfall)
+{
+	if ((Waterfall == nullptr) || !(this->WaterfallData.Actors.IsValidIndex(Waterfall->SimulationIndex)) || (this->WaterfallData.Actors[Waterfall->SimulationIndex] != Waterfall))
+	{
+		return;
+	}
+
+	int32 Index = Waterfall->SimulationIndex;
+	Waterfall->SimulationIndex = INDEX_NONE;
+
+	// Keeping arrays stable while they are iterated
+	if (this->bIsSimulating)
+	{
+		this->WaterfallData.Actors[Index] = nullptr;
+		this->bHasRemovedEntries = true;
+		return;
+	}
+
+	this->WaterfallData.RemoveAtSwap(Index);
+	if (this->WaterfallData.Actors.IsValidIndex(Index) && (this->WaterfallData.Actors[Index] != nullptr))
+	{
+		this->WaterfallData.Actors[Index]->SimulationIndex = Index;
+	}
+}
+
+void UWaterSimulationSubsystem::RegisterWaterPuddle(AWaterPuddle* Puddle)
+{
+	if ((Puddle == nullptr) || (Puddle->SimulationIndex != INDEX_NONE))
+	{
+		return;
+	}
+
+	Puddle->SimulationIndex = this->PuddleData.Add(Puddle);
+}
+
+void UWaterSimulationSubsystem::UnregisterWaterPuddle(AWaterPuddle* Puddle)
+{
+	if ((Puddle == nullptr) || !(this->PuddleData.Actors.IsValidIndex(Puddle->SimulationIndex)) || (this->PuddleData.Actors[Puddle->SimulationIndex] != Puddle))
+	{
+		return;
+	}
+
+	int32 Index = Puddle->SimulationIndex;
+	Puddle->SimulationIndex = INDEX_NONE;
+
+	// Keeping arrays stable while they are iterated
+	if (this->bIsSimulating)
+	{
+		this->PuddleData.Actors[Index] = nullptr;
+		this->bHasRemovedEntries = true;
+		return;
+	}
+
+	this->PuddleData.RemoveAtSwap(Index);
+	if (this->PuddleData.Actors.IsValidIndex(Index) && (this->PuddleData.Actors[Index] != nullptr))
+	{
+		this->PuddleData.Actors[Index]->SimulationIndex = Index;
+	}
+}
+
+void UWaterSimulationSubsystem::CoalesceWaterPuddles()
+{
+	SCOPE_CYCLE_COUNTER(STAT_WaterSimulation_Coalescing);
+
+	int32 NumChecks = FMath::Min(WaterSimulationHelpers::CVarCoalesceChecks.GetValueOnGameThread(), this->PuddleSpatialHash.Num());
+	float OverlapShare = WaterSimulationHelpers::CVarCoalesceOverlap.GetValueOnGameThread();
+
+	TArray<AWaterPuddle*, TInlineAllocator<8>> Neighbours;
+	for (int32 Check = 0; Check < NumChecks; ++Check)
+	{
+		// Merges remove entries, so cursor is wrapped against current count
+		if (this->PuddleSpatialHash.Num() == 0)
+		{
+			break;
+		}
+		this->CoalesceCursor = (this->CoalesceCursor + 1) % this->PuddleSpatialHash.Num();
+
+		AWaterPuddle* Puddle = this->PuddleSpatialHash.GetKey(this->CoalesceCursor);
+		float Radius = Puddle->GetWaterPuddleRadius();
+		float MaxRadius = Radius / FMath::Max(Puddle->GetActorScale3D().Y, KINDA_SMALL_NUMBER) * Puddle->MaxWaterPuddleScale;
+
+		// Neighbours can be at most as large as max scale or this puddle
+		Neighbours.Reset();
+		this->PuddleSpatialHash.FindInRadius(Puddle->GetActorLocation(), Radius + FMath::Max(Radius, MaxRadius), Neighbours);
+
+		for (AWaterPuddle* Neighbour : Neighbours)
+		{
+			if ((Neighbour == Puddle) || (Neighbour->GetClass() != Puddle->GetClass()))
+			{
+				continue;
+			}
+
+			float Distance = FVector::Dist(Puddle->GetActorLocation(), Neighbour->GetActorLocation());
+			if (Distance < OverlapShare * (Puddle->GetWaterPuddleRadius() + Neighbour->GetWaterPuddleRadius()))
+			{
+				// Larger puddle stays, smaller one is retired
+				AWaterPuddle* Survivor = (Puddle->GetWaterPuddleRadius() >= Neighbour->GetWaterPuddleRadius()) ? Puddle : Neighbour;
+				AWaterPuddle* Retired = (Survivor == Puddle) ? Neighbour : Puddle;
+				if (!(Survivor->AbsorbWaterPuddle(Retired)))
+				{
+					// Merged area would not fit into max scale, trying other neighbours
+					continue;
+				}
+
+				INC_DWORD_STAT(STAT_WaterSimulation_CoalescedPuddles);
+
+				// One merge per check, survivor is looked at again on a later pass
+				break;
+			}
+		}
+	}
+}
+
+void UWaterSimulationSubsystem::QueueGlassHit(UPrimitiveComponent* Glass, const FVector& Location, const FVector& Normal, TSubclassOf<AActor> FeatherClass, USoundBase* Sound)
+{
+	FWaterGlassHit GlassHit;
+	GlassHit.Glass = Glass;
+	GlassHit.Location = Location;
+	GlassHit.Normal = Normal;
+	GlassHit.FeatherClass = FeatherClass;
+	GlassHit.Sound = Sound;
+
+	this->QueuedGlassHits.Add(GlassHit);
+
+	INC_DWORD_STAT(STAT_WaterSimulation_GlassHits_Count);
+}
+
+void UWaterSimulationSubsystem::TickGlassHits()
+{
+	SCOPE_CYCLE_COUNTER(STAT_WaterSimulation_GlassHits);
+
+	UWorld* const World = GetWorld();
+	UWaterActorPoolSubsystem* ActorPool = World->GetSubsystem<UWaterActorPoolSubsystem>();
+
+	int32 MaxEffects = FMath::Max(WaterSimulationHelpers::CVarGlassHitEffects.GetValueOnGameThread(), 1);
+	int32 MaxSounds = WaterSimulationHelpers::CVarGlassHitSounds.GetValueOnGameThread();
+	int32 NumEffects = 0;
+	int32 NumSounds = 0;
+
+	FAttachmentTransformRules AttachmentRules(EAttachmentRule::KeepWorld, EAttachmentRule::KeepWorld, EAttachmentRule::KeepWorld, true);
+
+	// Walking queue until batch is full, hits on broken tanks are dropped without using up the batch
+	int32 NumConsumed = 0;
+	for (; (NumConsumed < this->QueuedGlassHits.Num()) && (NumEffects < MaxEffects); ++NumConsumed)
+	{
+		const FWaterGlassHit& GlassHit = this->QueuedGlassHits[NumConsumed];
+
+		// Tank may have broken since hit, its feathers would have nothing to stick to
+		UPrimitiveComponent* Glass = GlassHit.Glass.Get();
+		if ((Glass == nullptr) || Glass->IsPendingKill())
+		{
+			continue;
+		}
+
+		++NumEffects;
+
+		// Attaching glass feather, tank hands it back to pool when it breaks (feather classes are registered as plain pooled classes by projectiles)
+		if ((ActorPool != nullptr) && (GlassHit.FeatherClass != nullptr))
+		{
+			AActor* Feather = ActorPool->AcquireActor(GlassHit.FeatherClass, FTransform(GlassHit.Normal.Rotation(), GlassHit.Location));
+			if (Feather != nullptr)
+			{
+				Feather->AttachToComponent(Glass, AttachmentRules);
+			}
+		}
+
+		// Playing sound at hit location
+		if (GlassHit.Sound.IsValid() && (NumSounds < MaxSounds))
+		{
+			UGameplayStatics::PlaySoundAtLocation(World, GlassHit.Sound.Get(), GlassHit.Location);
+			++NumSounds;
+		}
+	}
+
+	this->QueuedGlassHits.RemoveAt(0, NumConsumed, false);
+
+	SET_DWORD_STAT(STAT_WaterSimulation_QueuedGlassHits, this->QueuedGlassHits.Num());
+}
+
+void UWaterSimulationSubsystem::RegisterWetnessDecals(AWaterWetnessDecals* Decals)
+{
+	if (this->WetnessDecals.IsValid() && (this->WetnessDecals.Get() != Decals))
+	{
+		UE_LOG(LogWaterSimulation, Warning, TEXT("Wetness field is already shown by %s, ignoring %s"), *this->WetnessDecals->GetName(), *GetNameSafe(Decals));
+		return;
+	}
+
+	this->WetnessDecals = Decals;
+}
+
+void UWaterSimulationSubsystem::UnregisterWetnessDecals(AWaterWetnessDecals* Decals)
+{
+	if (this->WetnessDecals.Get() == Decals)
+	{
+		this->WetnessDecals.Reset();
+	}
+}
+
+bool UWaterSimulationSubsystem::IsWetnessModeEnabled()
+{
+	return (WaterSimulationHelpers::CVarWetnessMode.GetValueOnGameThread() != 0);
+}
+
+void UWaterSimulationSubsystem::TickWetness(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_WaterSimulation_Wetness);
+
+	// Floor traces answered since last frame were stored by their callbacks
+	TraceWetnessGround();
+
+	// Field keeps flowing and drying after wetness mode is turned off
+	this->WetnessField.Step(DeltaTime);
+	this->WetnessField.Evaporate(DeltaTime, WaterSimulationHelpers::CVarWetnessEvaporation.GetValueOnGameThread());
+
+	if (this->WetnessDecals.IsValid())
+	{
+		this->WetnessDecals->UpdateWetnessDecals(this->WetnessField);
+	}
+	else
+	{
+		TArray<FIntVector> RemovedKeys;
+		this->WetnessField.ConsumeRemovedTiles(RemovedKeys);
+	}
+
+	SET_DWORD_STAT(STAT_WaterSimulation_WetTiles, this->WetnessField.GetNumTiles());
+	SET_DWORD_STAT(STAT_WaterSimulation_FlowingTiles, this->WetnessField.GetNumAwakeTiles());
+	SET_DWORD_STAT(STAT_WaterSimulation_GroundTraceTiles, this->GroundTraces.Num());
+}
+
+void UWaterSimulationSubsystem::RequestWetnessGround(const FIntVector& Key, float FloorZ)
+{
+	using namespace WaterWetnessConstants;
+
+	// Traces still running for a tile whose heights were dropped land in its new cache entry
+	if (this->GroundTraces.Contains(Key))
+	{
+		return;
+	}
+
+	FWaterWetnessGroundTrace& GroundTrace = this->GroundTraces.Add(Key);
+	GroundTrace.FloorZ = FloorZ;
+	GroundTrace.NextCell = 0;
+	GroundTrace.NumPending = 0;
+	GroundTrace.Heights.SetNumUninitialized(TileResolution * TileResolution);
+	this->GroundTraceQueue.Add(Key);
+}
+
+void UWaterSimulationSubsystem::TraceWetnessGround()
+{
+	using namespace WaterWetnessConstants;
+
+	UWorld* const World = GetWorld();
+	if (World == nullptr)
+	{
+		return;
+	}
+
+	static const FName GroundTraceTag(TEXT("WetnessGround"));
+	FCollisionQueryParams QueryParams(GroundTraceTag, false);
+
+	int32 NumTraces = FMath::Max(WaterSimulationHelpers::CVarWetnessGroundTraces.GetValueOnGameThread(), 1);
+	int32 NumSentTiles = 0;
+	for (const FIntVector& Key : this->GroundTraceQueue)
+	{
+		if (NumTraces <= 0)
+		{
+			break;
+		}
+
+		// Tracing static floor through layer, cells without floor in reach stay dry like walls
+		FWaterWetnessGroundTrace& GroundTrace = this->GroundTraces[Key];
+		FVector Origin(Key.X * TileSize, Key.Y * TileSize, GroundTrace.FloorZ + LayerHeight * 0.5f);
+		for (; (GroundTrace.NextCell < TileResolution * TileResolution) && (NumTraces > 0); ++GroundTrace.NextCell, --NumTraces)
+		{
+			int32 x = GroundTrace.NextCell % TileResolution;
+			int32 y = GroundTrace.NextCell / TileResolution;
+			FVector Start = Origin + FVector((x + 0.5f) * CellSize, (y + 0.5f) * CellSize, 0.0f);
+
+			FTraceDelegate TraceDelegate = FTraceDelegate::CreateUObject(this, &UWaterSimulationSubsystem::OnWetnessGroundTraced, Key, GroundTrace.NextCell);
+			World->AsyncLineTraceByChannel(EAsyncTraceType::Single,
+										   Start,
+										   Start - FVector(0.0f, 0.0f, LayerHeight),
+										   ECollisionChannel::ECC_WorldStatic,
+										   QueryParams,
+										   FCollisionResponseParams::DefaultResponseParam,
+										   &TraceDelegate);
+			++GroundTrace.NumPending;
+		}
+
+		if (GroundTrace.NextCell >= TileResolution * TileResolution)
+		{
+			++NumSentTiles;
+		}
+	}
+
+	// Tiles with all traces sent leave queue, they finish in trace callbacks
+	this->GroundTraceQueue.RemoveAt(0, NumSentTiles, false);
+}
+
+void UWaterSimulationSubsystem::OnWetnessGroundTraced(const FTraceHandle& TraceHandle, FTraceDatum& TraceData, FIntVector Key, int32 Cell)
+{
+	using namespace WaterWetnessConstants;
+
+	FWaterWetnessGroundTrace* GroundTrace = this->GroundTraces.Find(Key);
+	if (GroundTrace == nullptr)
+	{
+		return;
+	}
+
+	GroundTrace->Heights[Cell] = GroundTrace->FloorZ + LayerHeight;
+	for (const FHitResult& Hit : TraceData.OutHits)
+	{
+		if (Hit.bBlockingHit)
+		{
+			GroundTrace->Heights[Cell] = Hit.ImpactPoint.Z;
+			break;
+		}
+	}
+
+	--GroundTrace->NumPending;
+	if ((GroundTrace->NumPending == 0) && (GroundTrace->NextCell >= TileResolution * TileResolution))
+	{
+		this->WetnessField.SetGround(Key, GroundTrace->Heights);
+		this->GroundTraces.Remove(Key);
+	}
+}
+
+void UWaterSimulationSubsystem::UpdateWaterPuddleBudget(AWaterPuddle* Puddle, bool bIsLive)
+{
+	if (bIsLive)
+	{
+		this->PuddleBudget.Update(Puddle, ComputeWaterPuddleImportance(Puddle), Puddle->IsUnderWaterfall);
+	}
+	else
+	{
+		this->PuddleBudget.Remove(Puddle);
+	}
+}
+
+void UWaterSimulationSubsystem::RescoreWaterPuddle(AWaterPuddle* Puddle)
+{
+	if (this->PuddleBudget.Contains(Puddle))
+	{
+		this->PuddleBudget.Update(Puddle, ComputeWaterPuddleImportance(Puddle), Puddle->IsUnderWaterfall);
+	}
+}
+
+float UWaterSimulationSubsystem::ComputeWaterPuddleImportance(AWaterPuddle* Puddle) const
+{
+	float ViewDistance = WaterSimulationHelpers::GetViewDistance(this->BudgetViewLocations, Puddle->GetActorLocation());
+	float IdleTime = GetWorld()->GetTimeSeconds() - Puddle->LastFedTime;
+
+	return WaterSimulationHelpers::ComputePuddleImportance(Puddle->GetWaterPuddleRadius(), IdleTime, ViewDistance);
+}
+
+void UWaterSimulationSubsystem::TickWaterPuddleBudget()
+{
+	SCOPE_CYCLE_COUNTER(STAT_WaterSimulation_Budget);
+
+	// Viewers move and idle time grows all the time, so both are refreshed for a few puddles per frame
+	this->BudgetViewLocations.Reset();
+	WaterSimulationHelpers::GetViewLocations(GetWorld(), this->BudgetViewLocations);
+
+	int32 NumRescores = FMath::Min(WaterSimulationHelpers::CVarPuddleBudgetRescores.GetValueOnGameThread(), this->PuddleBudget.NumEvictable());
+	for (int32 Rescore = 0; (Rescore < NumRescores) && (this->PuddleBudget.NumEvictable() > 0); ++Rescore)
+	{
+		this->BudgetCursor = (this->BudgetCursor + 1) % this->PuddleBudget.NumEvictable();
+
+		AWaterPuddle* Puddle = this->PuddleBudget.GetPuddle(this->BudgetCursor);
+		this->PuddleBudget.Update(Puddle, ComputeWaterPuddleImportance(Puddle), Puddle->IsUnderWaterfall);
+	}
+
+	// Retiring least important puddles, they leave budget before fading out. Fed puddles are never retired
+	int32 Budget = WaterSimulationHelpers::CVarPuddleBudget.GetValueOnGameThread();
+	float FadeTime = WaterSimulationHelpers::CVarPuddleEvictFadeTime.GetValueOnGameThread();
+	while ((Budget > 0) && (this->PuddleBudget.Num() > Budget) && (this->PuddleBudget.NumEvictable() > 0))
+	{
+		AWaterPuddle* Puddle = this->PuddleBudget.PopLowest();
+		Puddle->RetireWaterPuddle(FadeTime);
+
+		INC_DWORD_STAT(STAT_WaterSimulation_EvictedPuddles);
+	}
+
+	SET_DWORD_STAT(STAT_WaterSimulation_LivePuddles, this->PuddleBudget.Num());
+	SET_DWORD_STAT(STAT_WaterSimulation_PuddleBudget, Budget);
+}
+
+void UWaterSimulationSubsystem::QueueWaterTankBreak(const FVector& Location, TSubclassOf<AWaterPuddle> PuddleClass, const FVector& PuddleScale, float Volume)
+{
+	// Wetness field takes released volume, puddle presets only matter for puddle actors
+	bool bHasWetness = IsWetnessModeEnabled() && (Volume > 0.0f);
+	bool bHasPuddle = !(IsWetnessModeEnabled()) && (PuddleClass != nullptr) && !(PuddleScale.IsNearlyZero());
+	if (!bHasWetness && !bHasPuddle)
+	{
+		return;
+	}
+
+	FWaterTankBreak Break;
+	Break.Location = Location;
+	Break.PuddleScale = PuddleScale;
+	Break.PuddleClass = PuddleClass;
+	Break.Volume = Volume;
+
+	this->QueuedBreaks.Add(Break);
+}
+
+void UWaterSimulationSubsystem::TickWaterTankBreaks()
+{
+	SCOPE_CYCLE_COUNTER(STAT_WaterSimulation_Breaks);
+
+	UWorld* const World = GetWorld();
+
+	// Pouring remaining liquid of breaks traced since last tick, field spreads it over floor
+	if (IsWetnessModeEnabled())
+	{
+		for (const FWaterTankBreak& Break : this->TracedBreaks)
+		{
+			this->WetnessField.AddWater(Break.Location, WaterWetnessConstants::SpillRadius, Break.Volume);
+		}
+		this->TracedBreaks.Reset();
+	}
+
+	// Spawning puddles of breaks traced since last tick
+	UWaterActorPoolSubsystem* ActorPool = World->GetSubsystem<UWaterActorPoolSubsystem>();
+	if (ActorPool != nullptr)
+	{
+		for (const FWaterTankBreak& Break : this->TracedBreaks)
+		{
+			// Break queued for wetness field before mode was switched off
+			if ((Break.PuddleClass == nullptr) || Break.PuddleScale.IsNearlyZero())
+			{
+				continue;
+			}
+
+			AWaterPuddle* SpawnedWaterPuddle = ActorPool->Acquire<AWaterPuddle>(Break.PuddleClass, FTransform(Break.Location));
+			if (SpawnedWaterPuddle != nullptr)
+			{
+				SpawnedWaterPuddle->SetActorScale3D(Break.PuddleScale);
+			}
+		}
+	}
+	this->TracedBreaks.Reset();
+
+	// Tracing ground under breaks of this frame, world runs all async traces together
+	static const FName BreakTraceTag(TEXT("WaterTankBreak"));
+	FCollisionQueryParams QueryParams(BreakTraceTag, false);
+
+	for (const FWaterTankBreak& Break : this->QueuedBreaks)
+	{
+		FTraceDelegate TraceDelegate = FTraceDelegate::CreateUObject(this, &UWaterSimulationSubsystem::OnWaterTankBreakTraced, Break);
+		World->AsyncLineTraceByChannel(EAsyncTraceType::Single,
+									   Break.Location,
+									   Break.Location - FVector(0.0f, 0.0f, WaterSimulationHelpers::BreakTraceDepth),
+									   ECollisionChannel::ECC_WorldStatic,
+									   QueryParams,
+									   FCollisionResponseParams::DefaultResponseParam,
+									   &TraceDelegate);
+	}
+	this->QueuedBreaks.Reset();
+}
+
+void UWaterSimulationSubsystem::OnWaterTankBreakTraced(const FTraceHandle& TraceHandle, FTraceDatum& TraceData, FWaterTankBreak Break)
+{
+	// Puddle lies on ground, or at end of trace if there is none
+	Break.Location = TraceData.End;
+	for (const FHitResult& Hit : TraceData.OutHits)
+	{
+		if (Hit.bBlockingHit)
+		{
+			Break.Location = Hit.Location;
+			break;
+		}
+	}
+
+	this->TracedBreaks.Add(Break);
+}
+
+void UWaterSimulationSubsystem::CompactRemovedEntries()
+{
+	// Walking backwards so swapped in entries are already checked
+	for (int32 i = this->TankData.Num() - 1; i >= 0; --i)
+	{
+		if (this->TankData.Actors[i] == nullptr)
+		{
+			this->TankData.RemoveAtSwap(i);
+			if (this->TankData.Actors.IsValidIndex(i))
+			{
+				this->TankData.Actors[i]->SimulationIndex = i;
+			}
+		}
+	}
+
+	for (int32 i = this->WaterfallData.Num() - 1; i >= 0; --i)
+	{
+		if (this->WaterfallData.Actors[i] == nullptr)
+		{
+			this->WaterfallData.RemoveAtSwap(i);
+			if (this->WaterfallData.Actors.IsValidIndex(i))
+			{
+				this->WaterfallData.Actors[i]->SimulationIndex = i;
+			}
+		}
+	}
+
+	for (int32 i = this->PuddleData.Num() - 1; i >= 0; --i)
+	{
+		if (this->PuddleData.Actors[i] == nullptr)
+		{
+			this->PuddleData.RemoveAtSwap(i);
+			if (this->PuddleData.Actors.IsValidIndex(i))
+			{
+				this->PuddleData.Actors[i]->SimulationIndex = i;
+			}
+		}
+	}
+
+	this->bHasRemovedEntries = false;
+}
+
+void UWaterSimulationSubsystem::SimulateWaterTanks(FWaterTankSimData& Data, FWaterHoleSimData& Holes, int32 Count, int32 NumSloshSubsteps, bool bForceSingleThread)
+{
+	using namespace WaterSimulationHelpers;
+
+	// Chunks are a multiple of 4, so slosh integration stays on full SIMD lanes
+	int32 NumChunks = FMath::DivideAndRoundUp(Count, ChunkSize);
+	ParallelFor(NumChunks, [&Data, &Holes, Count, NumSloshSubsteps](int32 Chunk)
+	{
+		int32 Start = Chunk * ChunkSize;
+		int32 End = FMath::Min(Start + ChunkSize, Count);
+
+		for (int32 i = Start; i < End; ++i)
+		{
+			if (!(Data.bIsActive[i]))
+			{
+				// Tanks at rest settle towards flat surface, tanks waiting for their LOD interval keep last target
+				if (Data.bIsAtRest[i])
+				{
+					Data.SloshTargetX[i] = 0.0f;
+					Data.SloshTargetY[i] = 0.0f;
+				}
+				continue;
+			}
+
+			// Getting liquid velocity and acceleration from container movement
+			if (Data.DeltaTime[i] > KINDA_SMALL_NUMBER)
+			{
+				FVector NewVelocity = (Data.Location[i] - Data.LastLocation[i]) / Data.DeltaTime[i];
+				FVector Acceleration = (NewVelocity - Data.Velocity[i]) / Data.DeltaTime[i];
+				Data.Velocity[i] = NewVelocity;
+				Data.Acceleration[i] = FLiquidSlosh::FilterAcceleration(Acceleration, Data.Acceleration[i], Data.DeltaTime[i]);
+				Data.SloshTargetX[i] = FLiquidSlosh::GetTargetAngle(Data.Acceleration[i].X);
+				Data.SloshTargetY[i] = FLiquidSlosh::GetTargetAngle(Data.Acceleration[i].Y);
+			}
+			Data.LastLocation[i] = Data.Location[i];
+		}
+
+		// Advancing slosh of whole chunk in SIMD
+		FLiquidSlosh::Integrate(End - Start, &Data.SloshAngleX[Start], &Data.SloshRateX[Start], &Data.SloshTargetX[Start], &Data.SloshStiffness[Start], &Data.SloshDamping[Start], NumSloshSubsteps);
+		FLiquidSlosh::Integrate(End - Start, &Data.SloshAngleY[Start], &Data.SloshRateY[Start], &Data.SloshTargetY[Start], &Data.SloshStiffness[Start], &Data.SloshDamping[Start], NumSloshSubsteps);
+
+		for (int32 i = Start; i < End; ++i)
+		{
+			if (!(Data.bIsActive[i]))
+			{
+				continue;
+			}
+
+			// Getting surface tilt
+			Data.PlaneRotation[i] = AWaterTank::ComputePlaneRotation(FVector2D(Data.SloshAngleX[i], Data.SloshAngleY[i]));
+
+			// Draining through holes of visible waterfalls, every tank owns its range of holes
+			Data.DrainedVolume[i] = 0.0f;
+			if (Data.HoleCount[i] <= 0)
+			{
+				Data.OutflowTimeAccumulator[i] = 0.0f;
+				continue;
+			}
+
+			int32 HoleStart = Data.HoleStart[i];
+			int32 NumOutflowSubsteps = FLiquidOutflow::ConsumeSubsteps(Data.DeltaTime[i], Data.OutflowTimeAccumulator[i]);
+			Data.DrainedVolume[i] = FLiquidOutflow::Drain(Data.HoleCount[i], &Holes.Area[HoleStart], &Holes.Head[HoleStart], &Holes.Outflow[HoleStart], Data.Volume[i], Data.SurfaceArea[i], NumOutflowSubsteps);
+			Data.Volume[i] -= Data.DrainedVolume[i];
+			Data.FillHeight[i] = (Data.Capacity[i] > 0.0f) ? Data.Volume[i] / Data.Capacity[i] * 100.0f : 0.0f;
+		}
+	}, bForceSingleThread);
+}
+
+void UWaterSimulationSubsystem::SimulateWaterfalls(FWaterfallSimData& Data, int32 Count, bool bForceSingleThread)
+{
+	WaterSimulationHelpers::ParallelForChunks(Count, [&Data](int32 i)
+	{
+		Data.bIsVisible[i] = AWaterfall::ComputeWaterfallVisibility(Data.ForwardVector[i],
+																	Data.MaxAngle[i],
+																	Data.LocationZ[i],
+																	Data.bHasWaterTank[i],
+																	Data.TankPlaneZ[i],
+																	Data.TankFillHeight[i]);
+	}, bForceSingleThread);
+}
+
+void UWaterSimulationSubsystem::SimulateWaterPuddles(FWaterPuddleSimData& Data, int32 Count, float DeltaTime, bool bForceSingleThread)
+{
+	WaterSimulationHelpers::ParallelForChunks(Count, [&Data, DeltaTime](int32 i)
+	{
+		// Evaluating growth for all waterfall time received so far
+		if (Data.bIsUnderWaterfall[i])
+		{
+			Data.InflowTime[i] += DeltaTime * Data.VisibleWaterfallCount[i];
+			Data.Scale[i] = Data.StartScale[i] + FVector(AWaterPuddle::ComputeGrowth(Data.StartScale[i], Data.InflowTime[i], Data.DeltaScale[i], Data.DeltaScaleStep[i], Data.MaxScale[i]));
+		}
+	}, bForceSingleThread);
+}
+
+void UWaterSimulationSubsystem::TickWaterTanks(float CurrentTime, float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_WaterSimulation_Tanks);
+
+	FWaterTankSimData& Data = this->TankData;
+	int32 Count = Data.Num();
+	int32 ActiveCount = 0;
+	int32 DirtyCount = 0;
+
+	// Showing slices launched last frame, before their back buffers are written again
+	{
+		SCOPE_CYCLE_COUNTER(STAT_WaterSimulation_SliceUpload);
+
+		for (int32 i = 0; i < Count; ++i)
+		{
+			if (Data.Actors[i] != nullptr)
+			{
+				Data.Actors[i]->FinishLiquidSlice();
+			}
+		}
+	}
+
+	// Picking update LOD of every tank from view distance and visibility
+	TArray<FVector, TInlineAllocator<4>> ViewLocations;
+	WaterSimulationHelpers::GetViewLocations(GetWorld(), ViewLocations);
+	int32 LODCounts[3] = { 0, 0, 0 };
+	for (int32 i = 0; i < Count; ++i)
+	{
+		AWaterTank* Tank = Data.Actors[i];
+		if (Tank == nullptr)
+		{
+			continue;
+		}
+
+		float ViewDistance = WaterSimulationHelpers::GetViewDistance(ViewLocations, Tank->GetActorLocation());
+		bool bWasRecentlyRendered = Tank->WasRecentlyRendered(0.2f);
+		Tank->SetLiquidUpdateLOD(AWaterTank::ComputeUpdateLOD(ViewDistance, bWasRecentlyRendered, Tank->LODReducedDistance, Tank->LODFrozenDistance));
+		Data.Significance[i] = WaterSimulationHelpers::ComputeSignificance(ViewDistance, bWasRecentlyRendered);
+		++LODCounts[int32(Tank->LiquidUpdateLOD)];
+	}
+
+	// Gathering inputs, tanks at rest are only checked every RestTickInterval, reduced ones every LODReducedInterval
+	this->HoleData.Reset();
+	for (int32 i = 0; i < Count; ++i)
+	{
+		AWaterTank* Tank = Data.Actors[i];
+		bool bIsDue = (CurrentTime >= Data.NextUpdateTime[i]);
+		bool bIsReduced = (Tank != nullptr) && (Tank->LiquidUpdateLOD == ELiquidUpdateLOD::Reduced);
+		Data.bIsActive[i] = (Tank != nullptr) && ((!(Tank->bIsLiquidAtRest) && !bIsReduced) || bIsDue);
+		Data.bIsAtRest[i] = (Tank == nullptr) || Tank->bIsLiquidAtRest;
+		Data.bIsDirty[i] = false;
+		if (!(Data.bIsActive[i]))
+		{
+			continue;
+		}
+
+		Data.Location[i] = Tank->GlassComponent->GetComponentLocation();
+		Data.Viscosity[i] = Tank->Viscosity;
+		FLiquidSlosh::GetSpringParams(Tank->SloshFrequency, Tank->Viscosity, Data.SloshStiffness[i], Data.SloshDamping[i]);
+		Data.FillHeight[i] = Tank->FillHeight;
+		Data.DeltaTime[i] = CurrentTime - Data.LastUpdateTime[i];
+
+		// Gathering flowing holes next to each other
+		Tank->UpdateHoles();
+		Data.HoleStart[i] = this->HoleData.Num();
+		if (Tank->FlowingHoleCount > 0)
+		{
+			for (int32 Hole = 0; Hole < Tank->Holes.Num(); ++Hole)
+			{
+				if (Tank->Holes[Hole].bIsFlowing)
+				{
+					this->HoleData.Add(Hole, FLiquidOutflow::GetHoleArea(Tank->Holes[Hole].Radius), Tank->Holes[Hole].Head);
+				}
+			}
+		}
+		Data.HoleCount[i] = this->HoleData.Num() - Data.HoleStart[i];
+
+		if (Data.HoleCount[i] > 0)
+		{
+			Data.Capacity[i] = Tank->GetLiquidCapacity();
+			Data.Volume[i] = Data.Capacity[i] * FMath::Clamp(Tank->FillHeight, 0.0f, 100.0f) / 100.0f;
+			Data.SurfaceArea[i] = Tank->GetLiquidSurfaceArea();
+		}
+		Data.LastUpdateTime[i] = CurrentTime;
+		++ActiveCount;
+	}
+
+	// All tanks share fixed slosh substeps of the subsystem
+	int32 NumSloshSubsteps = FLiquidSlosh::ConsumeSubsteps(DeltaTime, this->SloshTimeAccumulator);
+	SimulateWaterTanks(Data, this->HoleData, Count, NumSloshSubsteps, false);
+
+	// Placing surface planes of tanks whose liquid has changed
+	for (int32 i = 0; i < Count; ++i)
+	{
+		AWaterTank* Tank = Data.Actors[i];
+		if (!(Data.bIsActive[i]) || (Tank == nullptr))
+		{
+			continue;
+		}
+
+		Tank->LiquidVelocity = Data.Velocity[i];
+		Tank->LiquidAcceleration = Data.Acceleration[i];
+		Tank->SloshAngle = FVector2D(Data.SloshAngleX[i], Data.SloshAngleY[i]);
+		Tank->SloshRate = FVector2D(Data.SloshRateX[i], Data.SloshRateY[i]);
+
+		// Frozen geometry, only rest state is refreshed and fill height is pushed below
+		if (Tank->LiquidUpdateLOD == ELiquidUpdateLOD::Frozen)
+		{
+			Tank->RefreshLiquidState();
+			Data.NextUpdateTime[i] = CurrentTime + Tank->RestTickInterval;
+			continue;
+		}
+
+		Tank->UpdateLiquidSurface(Data.DeltaTime[i]);
+		Data.bIsDirty[i] = Tank->RefreshLiquidState();
+
+		if (Data.bIsDirty[i])
+		{
+			Tank->SetPlanePositionAndRotation(Data.PlaneRotation[i]);
+			Tank->PrepareLiquidSlice();
+			this->SliceOrder.Add(i);
+		}
+
+		bool bIsReduced = (Tank->LiquidUpdateLOD == ELiquidUpdateLOD::Reduced);
+		if (!(Data.bIsDirty[i]) || bIsReduced)
+		{
+			Data.NextUpdateTime[i] = CurrentTime + (Data.bIsDirty[i] ? Tank->LODReducedInterval : Tank->RestTickInterval);
+		}
+	}
+
+	// Keeping slicing inside frame budget, least significant tanks wait for a later frame
+	float BudgetMicroseconds = WaterSimulationHelpers::CVarSliceBudget.GetValueOnGameThread() * 1000.0f;
+	int32 DeferredCount = 0;
+	if (BudgetMicroseconds > 0.0f)
+	{
+		this->SliceOrder.Sort([&Data](int32 A, int32 B)
+		{
+			return Data.Significance[A] > Data.Significance[B];
+		});
+
+		float SpentMicroseconds = 0.0f;
+		for (int32 i : this->SliceOrder)
+		{
+			float Cost = Data.Actors[i]->LiquidSliceMicroseconds;
+			if ((SpentMicroseconds > 0.0f) && (SpentMicroseconds + Cost > BudgetMicroseconds))
+			{
+				// Forcing rebuild once there is room
+				Data.bIsDirty[i] = false;
+				Data.Actors[i]->WakeLiquid();
+				++DeferredCount;
+				continue;
+			}
+
+			SpentMicroseconds += Cost;
+		}
+	}
+	DirtyCount = this->SliceOrder.Num() - DeferredCount;
+	this->SliceOrder.Reset();
+
+	bool bUseAsyncSlicing = (WaterSimulationHelpers::CVarAsyncSlicing.GetValueOnGameThread() != 0);
+	if (bUseAsyncSlicing)
+	{
+		// Slicing liquid meshes on task graph, results are shown next frame
+		SCOPE_CYCLE_COUNTER(STAT_WaterSimulation_Slicing);
+
+		for (int32 i = 0; i < Count; ++i)
+		{
+			if (Data.bIsDirty[i] && (Data.Actors[i] != nullptr))
+			{
+				Data.Actors[i]->LaunchLiquidSlice();
+			}
+		}
+	}
+	else
+	{
+		// Slicing liquid meshes in parallel (every tank owns its buffers)
+		SCOPE_CYCLE_COUNTER(STAT_WaterSimulation_Slicing);
+
+		ParallelFor(Count, [&Data](int32 i)
+		{
+			if (Data.bIsDirty[i] && (Data.Actors[i] != nullptr))
+			{
+				Data.Actors[i]->SliceLiquid();
+			}
+		});
+	}
+
+	// Pushing results back to tanks
+	for (int32 i = 0; i < Count; ++i)
+	{
+		AWaterTank* Tank = Data.Actors[i];
+		if (!(Data.bIsActive[i]) || (Tank == nullptr))
+		{
+			continue;
+		}
+
+		if (Data.bIsDirty[i] && !(bUseAsyncSlicing))
+		{
+			Tank->UpdateLiquid();
+		}
+
+		// Keeping volume ledger, waterfalls pass drained volume on to puddles
+		if (Data.HoleCount[i] > 0)
+		{
+			Tank->DrainedVolume += Data.DrainedVolume[i];
+			for (int32 Hole = Data.HoleStart[i]; Hole < Data.HoleStart[i] + Data.HoleCount[i]; ++Hole)
+			{
+				Tank->AddHoleOutflow(this->HoleData.HoleIndex[Hole], this->HoleData.Outflow[Hole]);
+			}
+		}
+
+		// Checking if we should destroy water tank
+		Tank->DestroyWaterTank();
+
+		// Depleting water tank if there are any visible waterfalls
+		Tank->FillHeight = Data.FillHeight[i];
+	}
+
+	SET_DWORD_STAT(STAT_WaterSimulation_ActiveTanks, ActiveCount);
+	SET_DWORD_STAT(STAT_WaterSimulation_DirtyTanks, DirtyCount);
+	SET_DWORD_STAT(STAT_WaterSimulation_DeferredTanks, DeferredCount);
+	SET_DWORD_STAT(STAT_WaterSimulation_FullTanks, LODCounts[int32(ELiquidUpdateLOD::Full)]);
+	SET_DWORD_STAT(STAT_WaterSimulation_ReducedTanks, LODCounts[int32(ELiquidUpdateLOD::Reduced)]);
+	SET_DWORD_STAT(STAT_WaterSimulation_FrozenTanks, LODCounts[int32(ELiquidUpdateLOD::Frozen)]);
+	SET_DWORD_STAT(STAT_WaterSimulation_FlowingHoles, this->HoleData.Num());
+}
+
+void UWaterSimulationSubsystem::AssignWaterfallProxies()
+{
+	struct FProxyCandidate
+	{
+		AWaterTank* Tank;
+		int32 Hole;
+		float ViewDistance;
+	};
+
+	float MaxDistance = WaterSimulationHelpers::CVarWaterfallProxyDistance.GetValueOnGameThread();
+	int32 MaxProxies = FMath::Max(WaterSimulationHelpers::CVarMaxWaterfallProxies.GetValueOnGameThread(), 0);
+
+	TArray<FVector, TInlineAllocator<4>> ViewLocations;
+	WaterSimulationHelpers::GetViewLocations(GetWorld(), ViewLocations);
+
+	// Collecting flowing holes of tanks that are still updated
+	TArray<FProxyCandidate, TInlineAllocator<64>> Candidates;
+	for (AWaterTank* Tank : this->TankData.Actors)
+	{
+		if (Tank == nullptr)
+		{
+			continue;
+		}
+
+		for (int32 Hole = 0; Hole < Tank->Holes.Num(); ++Hole)
+		{
+			FWaterTankHole& TankHole = Tank->Holes[Hole];
+			TankHole.bWantsProxy = false;
+			if (!(TankHole.bIsFlowing) || (Tank->LiquidUpdateLOD == ELiquidUpdateLOD::Frozen))
+			{
+				continue;
+			}
+
+			float ViewDistance = WaterSimulationHelpers::GetViewDistance(ViewLocations, Tank->GetHoleLocation(Hole));
+			if (ViewDistance <= MaxDistance)
+			{
+				Candidates.Add({ Tank, Hole, ViewDistance });
+			}
+		}
+	}
+
+	// Closest holes win when there are more than proxies
+	if (Candidates.Num() > MaxProxies)
+	{
+		Candidates.Sort([](const FProxyCandidate& A, const FProxyCandidate& B)
+		{
+			return A.ViewDistance < B.ViewDistance;
+		});
+		Candidates.SetNum(MaxProxies, false);
+	}
+
+	for (const FProxyCandidate& Candidate : Candidates)
+	{
+		Candidate.Tank->Holes[Candidate.Hole].bWantsProxy = true;
+	}
+
+	// Releasing first so freed waterfalls can be handed out right away
+	int32 UsedCount = 0;
+	for (AWaterTank* Tank : this->TankData.Actors)
+	{
+		if (Tank == nullptr)
+		{
+			continue;
+		}
+
+		for (int32 Hole = 0; Hole < Tank->Holes.Num(); ++Hole)
+		{
+			if (Tank->Holes[Hole].Proxy.IsValid() && !(Tank->Holes[Hole].bWantsProxy))
+			{
+				Tank->ReleaseHoleProxy(Hole);
+			}
+		}
+	}
+
+	for (const FProxyCandidate& Candidate : Candidates)
+	{
+		Candidate.Tank->AcquireHoleProxy(Candidate.Hole);
+		UsedCount += Candidate.Tank->Holes[Candidate.Hole].Proxy.IsValid() ? 1 : 0;
+	}
+
+	SET_DWORD_STAT(STAT_WaterSimulation_UsedProxies, UsedCount);
+}
+
+void UWaterSimulationSubsystem::TickWaterfalls(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_WaterSimulation_Waterfalls);
+
+	FWaterfallSimData& Data = this->WaterfallData;
+	int32 Count = Data.Num();
+
+	// Updating components and gathering inputs
+	for (int32 i = 0; i < Count; ++i)
+	{
+		AWaterfall* Waterfall = Data.Actors[i];
+		if (Waterfall == nullptr)
+		{
+			continue;
+		}
+
+		Waterfall->UpdateWaterfallComponents(DeltaTime);
+
+		AWaterTank* WaterTank = Waterfall->RegisteredWaterTank.Get();
+		Data.ForwardVector[i] = Waterfall->GetActorForwardVector();
+		Data.MaxAngle[i] = Waterfall->WaterfallMaxAngle;
+		Data.LocationZ[i] = Waterfall->GetActorLocation().Z;
+		Data.bHasWaterTank[i] = (WaterTank != nullptr);
+		Data.TankPlaneZ[i] = (WaterTank != nullptr) ? WaterTank->PlanePosition.Z : 0.0f;
+		Data.TankFillHeight[i] = (WaterTank != nullptr) ? WaterTank->FillHeight : 0.0f;
+	}
+
+	SimulateWaterfalls(Data, Count, false);
+
+	// Pushing results back to waterfalls
+	for (int32 i = 0; i < Count; ++i)
+	{
+		AWaterfall* Waterfall = Data.Actors[i];
+		if (Waterfall == nullptr)
+		{
+			continue;
+		}
+
+		Waterfall->bIsWaterfallVisible = Data.bIsVisible[i];
+		Waterfall->SetPSAccelAtRuntime();
+	}
+}
+
+void UWaterSimulationSubsystem::TickWaterPuddles(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_WaterSimulation_Puddles);
+
+	FWaterPuddleSimData& Data = this->PuddleData;
+	int32 Count = Data.Num();
+
+	// Gathering inputs, waterfall counters are kept by puddle events
+	for (int32 i = 0; i < Count; ++i)
+	{
+		AWaterPuddle* Puddle = Data.Actors[i];
+		if (Puddle == nullptr)
+		{
+			continue;
+		}
+
+		// Restarting growth from scale set from outside (spawners, merges)
+		if (!(Puddle->GetActorScale3D().Equals(Puddle->GrownScale, 0.0f)))
+		{
+			Puddle->RestartGrowth();
+		}
+
+		Data.Scale[i] = Puddle->GrownScale;
+		Data.StartScale[i] = Puddle->GrowthStartScale;
+		Data.InflowTime[i] = Puddle->InflowTime;
+		Data.DeltaScale[i] = Puddle->DeltaWaterPuddleScale;
+		Data.DeltaScaleStep[i] = Puddle->DeltaWaterPuddleScaleStep;
+		Data.MaxScale[i] = Puddle->MaxWaterPuddleScale;
+		Data.VisibleWaterfallCount[i] = Puddle->VisibleWaterfallCount;
+		Data.bIsUnderWaterfall[i] = Puddle->IsUnderWaterfall;
+	}
+
+	SimulateWaterPuddles(Data, Count, DeltaTime, false);
+
+	// Pushing results back to puddles
+	for (int32 i = 0; i < Count; ++i)
+	{
+		AWaterPuddle* Puddle = Data.Actors[i];
+		if (Puddle == nullptr)
+		{
+			continue;
+		}
+
+		Puddle->InflowTime = Data.InflowTime[i];
+		Puddle->GrownScale = Data.Scale[i];
+
+		if (Data.bIsUnderWaterfall[i])
+		{
+			Puddle->ApplyWaterPuddleScale(Data.Scale[i]);
+		}
+	}
+
+	SET_DWORD_STAT(STAT_WaterSimulation_HashedPuddles, this->PuddleSpatialHash.Num());
+}
+
+void UWaterSimulationSubsystem::RunScalingBenchmark(int32 Iterations)
+{
+	const int32 ActorCounts[] = { 10, 50, 100, 250, 500, 1000, 2000 };
+
+	for (int32 Count : ActorCounts)
+	{
+		FWaterTankSimData Tanks;
+		FWaterHoleSimData Holes;
+		FWaterfallSimData Waterfalls;
+		FWaterPuddleSimData Puddles;
+
+		// Filling synthetic state (pure stages never touch actors)
+		FRandomStream Random(Count);
+		for (int32 i = 0; i < Count; ++i)
+		{
+			Tanks.Add(nullptr, 0.0f);
+			Tanks.Location[i] = Random.GetUnitVector() * 100.0f;
+			Tanks.Viscosity[i] = 90.0f;
+			FLiquidSlosh::GetSpringParams(1.5f, 90.0f, Tanks.SloshStiffness[i], Tanks.SloshDamping[i]);
+			Tanks.FillHeight[i] = 50.0f;
+			Tanks.Capacity[i] = 100000.0f;
+			Tanks.Volume[i] = 50000.0f;
+			Tanks.SurfaceArea[i] = 1000.0f;
+			Tanks.HoleStart[i] = Holes.Add(0, FLiquidOutflow::GetHoleArea(0.5f), 50.0f);
+			Tanks.HoleCount[i] = 1;
+			Tanks.DeltaTime[i] = 1.0f / 60.0f;
+			Tanks.bIsActive[i] = true;
+
+			Waterfalls.Add(nullptr);
+			Waterfalls.ForwardVector[i] = Random.GetUnitVector();
+			Waterfalls.MaxAngle[i] = 60.0f;
+			Waterfalls.LocationZ[i] = Random.FRandRange(0.0f, 100.0f);
+			Waterfalls.TankPlaneZ[i] = 50.0f;
+			Waterfalls.TankFillHeight[i] = 50.0f;
+			Waterfalls.bHasWaterTank[i] = true;
+
+			Puddles.Add(nullptr);
+			Puddles.Scale[i] = FVector(0.2f);
+			Puddles.StartScale[i] = FVector(0.2f);
+			Puddles.InflowTime[i] = Random.FRandRange(0.0f, 60.0f);
+			Puddles.DeltaScale[i] = 0.005f;
+			Puddles.DeltaScaleStep[i] = 0.001f;
+			Puddles.MaxScale[i] = 3.0f;
+			Puddles.VisibleWaterfallCount[i] = 1;
+			Puddles.bIsUnderWaterfall[i] = true;
+		}
+
+		double Timings[2];
+		for (int32 Mode = 0; Mode < 2; ++Mode)
+		{
+			bool bForceSingleThread = (Mode == 0);
+
+			double StartTime = FPlatformTime::Seconds();
+			for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+			{
+				SimulateWaterTanks(Tanks, Holes, Count, 2, bForceSingleThread);
+				SimulateWaterfalls(Waterfalls, Count, bForceSingleThread);
+				SimulateWaterPuddles(Puddles, Count, 1.0f / 60.0f, bForceSingleThread);
+			}
+			Timings[Mode] = (FPlatformTime::Seconds() - StartTime) * 1000000.0 / double(Iterations);
+		}
+
+		UE_LOG(LogWaterSimulation, Display, TEXT("%4d actors of each kind: single thread %8.2f us/frame, parallel %8.2f us/frame, %8.1f actors/us, speedup %.2fx"),
+			   Count, Timings[0], Timings[1], double(Count * 3) / FMath::Max(Timings[1], 0.001), Timings[0] / FMath::Max(Timings[1], 0.001));
+	}
+}
+
+void UWaterSimulationSubsystem::RunWetnessBenchmark(int32 NumEvents)
+{
+	using namespace WaterWetnessConstants;
+
+	const int32 NumFrames = 60;
+	const float FrameTime = 1.0f / 60.0f;
+
+	// Spills spread over a 40 m square room, like a shootout over rows of tanks
+	TArray<FVector> Locations;
+	FRandomStream Random(NumEvents);
+	for (int32 i = 0; i < NumEvents; ++i)
+	{
+		Locations.Add(FVector(Random.FRandRange(-2000.0f, 2000.0f), Random.FRandRange(-2000.0f, 2000.0f), 0.0f));
+	}
+
+	// Puddle actors: every spill without a puddle within merge radius adds one, and all of them grow every frame.
+	// Only bookkeeping and growth math is timed, puddles are plain ids (0 means none found)
+	TWaterSpatialHash<int32> SpatialHash;
+	FWaterPuddleSimData Puddles;
+	double StartTime = FPlatformTime::Seconds();
+	for (int32 i = 0; i < NumEvents; ++i)
+	{
+		if (SpatialHash.FindClosest(Locations[i], 100.0f) == 0)
+		{
+			SpatialHash.Add(i + 1, Locations[i]);
+
+			int32 Index = Puddles.Add(nullptr);
+			Puddles.Scale[Index] = FVector(0.2f);
+			Puddles.StartScale[Index] = FVector(0.2f);
+			Puddles.DeltaScale[Index] = 0.005f;
+			Puddles.DeltaScaleStep[Index] = 0.001f;
+			Puddles.MaxScale[Index] = 3.0f;
+			Puddles.VisibleWaterfallCount[Index] = 1;
+			Puddles.bIsUnderWaterfall[Index] = true;
+		}
+	}
+	double PuddleSpillTime = (FPlatformTime::Seconds() - StartTime) * 1000000.0;
+
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		SimulateWaterPuddles(Puddles, Puddles.Num(), FrameTime, false);
+	}
+	double PuddleFrameTime = (FPlatformTime::Seconds() - StartTime) * 1000000.0 / NumFrames;
+
+	// Wetness field: every spill pours one litre on flat floor, field flows and evaporates every frame
+	FWaterWetnessField Field;
+	StartTime = FPlatformTime::Seconds();
+	for (int32 i = 0; i < NumEvents; ++i)
+	{
+		Field.AddWater(Locations[i], SpillRadius, 1000.0f);
+	}
+	double WetnessSpillTime = (FPlatformTime::Seconds() - StartTime) * 1000000.0;
+
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		Field.Step(FrameTime);
+		Field.Evaporate(FrameTime, 0.002f);
+	}
+	double WetnessFrameTime = (FPlatformTime::Seconds() - StartTime) * 1000000.0 / NumFrames;
+
+	// Numbers are not a like for like cost: puddle side leaves out actor spawns, overlaps and decals,
+	// wetness side leaves out decals and texture uploads. Use stat WaterSimulation in game for those
+	UE_LOG(LogWaterSimulation, Display, TEXT("Math only, actor spawns, overlaps, decals and texture uploads are not included"));
+	UE_LOG(LogWaterSimulation, Display, TEXT("%d spills, puddle math: %d puddles, spills %8.2f us, growth %8.2f us/frame"),
+		   NumEvents, Puddles.Num(), PuddleSpillTime, PuddleFrameTime);
+	UE_LOG(LogWaterSimulation, Display, TEXT("%d spills, wetness field math: %d tiles (%.0f cm each), spills %8.2f us, flow and evaporation %8.2f us/frame"),
+		   NumEvents, Field.GetNumTiles(), TileSize, WetnessSpillTime, WetnessFrameTime);
+}
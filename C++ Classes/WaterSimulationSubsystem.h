@@ -0,0 +1,290 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "WorldCollision.h"
+#include "WaterPuddleSpatialHash.h"
+#include "WaterPuddleBudget.h"
+#include "WaterWetnessField.h"
+#include "WaterSimulationSubsystem.generated.h"
+
+class AWaterTank;
+class AWaterfall;
+class AWaterPuddle;
+class AWaterWetnessDecals;
+class UPrimitiveComponent;
+class USoundBase;
+
+DECLARE_STATS_GROUP(TEXT("WaterSimulation"), STATGROUP_WaterSimulation, STATCAT_Advanced);
+
+// Water tank state, one entry per registered tank
+struct FWaterTankSimData
+{
+	TArray<AWaterTank*> Actors;
+	TArray<FVector> Location;
+	TArray<FVector> LastLocation;
+	TArray<FVector> Velocity;
+	TArray<FVector> Acceleration;
+	TArray<FRotator> PlaneRotation;
+	TArray<float> Viscosity;
+	TArray<float> SloshAngleX;
+	TArray<float> SloshAngleY;
+	TArray<float> SloshRateX;
+	TArray<float> SloshRateY;
+	TArray<float> SloshTargetX;
+	TArray<float> SloshTargetY;
+	TArray<float> SloshStiffness;
+	TArray<float> SloshDamping;
+	TArray<float> FillHeight;
+	TArray<float> Volume;
+	TArray<float> Capacity;
+	TArray<float> SurfaceArea;
+	TArray<float> DrainedVolume;
+	TArray<float> OutflowTimeAccumulator;
+	TArray<int32> HoleStart;
+	TArray<int32> HoleCount;
+	TArray<float> DeltaTime;
+	TArray<float> LastUpdateTime;
+	TArray<float> NextUpdateTime;
+	TArray<float> Significance;
+	TArray<bool> bIsActive;
+	TArray<bool> bIsAtRest;
+	TArray<bool> bIsDirty;
+
+	int32 Num() const { return this->Actors.Num(); }
+	int32 Add(AWaterTank* Tank, float CurrentTime);
+	void RemoveAtSwap(int32 Index);
+};
+
+// Draining holes of active tanks, rebuilt every frame with holes of a tank kept contiguous
+struct FWaterHoleSimData
+{
+	TArray<int32> HoleIndex;
+	TArray<float> Area;
+	TArray<float> Head;
+	TArray<float> Outflow;
+
+	int32 Num() const { return this->HoleIndex.Num(); }
+	int32 Add(int32 Hole, float HoleArea, float HoleHead);
+	void Reset();
+};
+
+// Waterfall state, one entry per registered waterfall
+struct FWaterfallSimData
+{
+	TArray<AWaterfall*> Actors;
+	TArray<FVector> ForwardVector;
+	TArray<float> MaxAngle;
+	TArray<float> LocationZ;
+	TArray<float> TankPlaneZ;
+	TArray<float> TankFillHeight;
+	TArray<bool> bHasWaterTank;
+	TArray<bool> bIsVisible;
+
+	int32 Num() const { return this->Actors.Num(); }
+	int32 Add(AWaterfall* Waterfall);
+	void RemoveAtSwap(int32 Index);
+};
+
+// Water puddle state, one entry per puddle fed by a visible waterfall
+struct FWaterPuddleSimData
+{
+	TArray<AWaterPuddle*> Actors;
+	TArray<FVector> Scale;
+	TArray<FVector> StartScale;
+	TArray<float> InflowTime;
+	TArray<float> DeltaScale;
+	TArray<float> DeltaScaleStep;
+	TArray<float> MaxScale;
+	TArray<int64> VisibleWaterfallCount;
+	TArray<bool> bIsUnderWaterfall;
+
+	int32 Num() const { return this->Actors.Num(); }
+	int32 Add(AWaterPuddle* Puddle);
+	void RemoveAtSwap(int32 Index);
+};
+
+// Puddle left by a broken tank, spawned once its ground trace is done
+struct FWaterTankBreak
+{
+	FVector Location;
+	FVector PuddleScale;
+	TSubclassOf<AWaterPuddle> PuddleClass;
+
+	// Liquid left in tank, poured into wetness field in wetness mode
+	float Volume;
+};
+
+// Floor traces of one wetness tile, sent over several frames
+struct FWaterWetnessGroundTrace
+{
+	float FloorZ;
+
+	// Next cell to send trace for, and traces sent but not answered yet
+	int32 NextCell;
+	int32 NumPending;
+
+	TArray<float> Heights;
+};
+
+// Effects of a projectile hit on tank glass, spawned in per frame batches
+struct FWaterGlassHit
+{
+	TWeakObjectPtr<UPrimitiveComponent> Glass;
+	FVector Location;
+	FVector Normal;
+	TSubclassOf<AActor> FeatherClass;
+	TWeakObjectPtr<USoundBase> Sound;
+};
+
+// Updates all water actors of a world in one pass.
+// Actors register on BeginPlay and stop ticking themselves. Every frame the subsystem gathers
+// their inputs into SoA arrays on the game thread, runs pure math with ParallelFor, and pushes
+// results back to the actors. Liquid meshes are sliced on task graph and shown one frame later.
+UCLASS()
+class FACILITY_API UWaterSimulationSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UWaterSimulationSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+
+public:
+	void RegisterWaterTank(AWaterTank* Tank);
+	void UnregisterWaterTank(AWaterTank* Tank);
+
+	void RegisterWaterfall(AWaterfall* Waterfall);
+	void UnregisterWaterfall(AWaterfall* Waterfall);
+
+	void RegisterWaterPuddle(AWaterPuddle* Puddle);
+	void UnregisterWaterPuddle(AWaterPuddle* Puddle);
+
+	// Adding live puddle to puddle budget, or removing it
+	void UpdateWaterPuddleBudget(AWaterPuddle* Puddle, bool bIsLive);
+
+	// Scoring puddle again after its size or feeding changed (ignored for puddles outside budget)
+	void RescoreWaterPuddle(AWaterPuddle* Puddle);
+
+	// Leaving puddle of scale under broken tank location, or pouring volume into wetness field in wetness mode.
+	// Breaks of a frame are traced together on async trace and spawned from pool a frame later
+	void QueueWaterTankBreak(const FVector& Location, TSubclassOf<AWaterPuddle> PuddleClass, const FVector& PuddleScale, float Volume = 0.0f);
+
+	// Attaching glass feather from pool and playing smash sound of a glass hit.
+	// Hits are spawned in batches of Water.GlassHits.MaxEffectsPerFrame, so bursts spread over frames
+	void QueueGlassHit(UPrimitiveComponent* Glass, const FVector& Location, const FVector& Normal, TSubclassOf<AActor> FeatherClass, USoundBase* Sound);
+
+	void RegisterWetnessDecals(AWaterWetnessDecals* Decals);
+	void UnregisterWetnessDecals(AWaterWetnessDecals* Decals);
+
+	// Checking if spills wet floor field instead of spawning puddle actors
+	static bool IsWetnessModeEnabled();
+
+	int32 GetNumWaterTanks() const { return this->TankData.Num(); }
+	int32 GetNumWaterfalls() const { return this->WaterfallData.Num(); }
+	int32 GetNumWaterPuddles() const { return this->PuddleData.Num(); }
+
+	// Locations of all puddles in world, simulated or not
+	FWaterPuddleSpatialHash& GetPuddleSpatialHash() { return this->PuddleSpatialHash; }
+
+	// Water on floors in wetness mode
+	FWaterWetnessField& GetWetnessField() { return this->WetnessField; }
+
+	// Pure simulation stages, safe to run on synthetic data (used by benchmark)
+	static void SimulateWaterTanks(FWaterTankSimData& Data, FWaterHoleSimData& Holes, int32 Count, int32 NumSloshSubsteps, bool bForceSingleThread);
+	static void SimulateWaterfalls(FWaterfallSimData& Data, int32 Count, bool bForceSingleThread);
+	static void SimulateWaterPuddles(FWaterPuddleSimData& Data, int32 Count, float DeltaTime, bool bForceSingleThread);
+
+	// Timing pure stages for 10 to 2000 water actors of each kind
+	static void RunScalingBenchmark(int32 Iterations);
+
+	// Timing bookkeeping and math of spill events for puddles against wetness field.
+	// Actor spawns, overlaps, decals and texture uploads are not part of it
+	static void RunWetnessBenchmark(int32 NumEvents);
+
+protected:
+	void TickWaterTanks(float CurrentTime, float DeltaTime);
+
+	// Giving pooled waterfalls to flowing holes closest to viewers
+	void AssignWaterfallProxies();
+	void TickWaterfalls(float DeltaTime);
+	void TickWaterPuddles(float DeltaTime);
+
+	// Merging overlapping puddles, a few puddles per frame
+	void CoalesceWaterPuddles();
+
+	// Rescoring a few puddles per frame, then retiring least important puddles over budget
+	void TickWaterPuddleBudget();
+
+	float ComputeWaterPuddleImportance(AWaterPuddle* Puddle) const;
+
+	// Spawning puddles of traced breaks, then tracing breaks queued since last tick
+	void TickWaterTankBreaks();
+	void OnWaterTankBreakTraced(const FTraceHandle& TraceHandle, FTraceDatum& TraceData, FWaterTankBreak Break);
+
+	// Spawning effects of oldest queued glass hits
+	void TickGlassHits();
+
+	// Flowing and evaporating wetness field, then showing its changed tiles
+	void TickWetness(float DeltaTime);
+
+	// Queueing floor traces of wetness tile, tile stays flat until all of them are answered
+	void RequestWetnessGround(const FIntVector& Key, float FloorZ);
+
+	// Sending queued floor traces, a few per frame
+	void TraceWetnessGround();
+	void OnWetnessGroundTraced(const FTraceHandle& TraceHandle, FTraceDatum& TraceData, FIntVector Key, int32 Cell);
+
+	// Removing entries unregistered during simulation
+	void CompactRemovedEntries();
+
+	FWaterTankSimData TankData;
+	FWaterHoleSimData HoleData;
+	FWaterfallSimData WaterfallData;
+	FWaterPuddleSimData PuddleData;
+	FWaterPuddleSpatialHash PuddleSpatialHash;
+	FWaterPuddleBudget PuddleBudget;
+	FWaterWetnessField WetnessField;
+
+	// Level actor showing wetness field
+	TWeakObjectPtr<AWaterWetnessDecals> WetnessDecals;
+
+	// Breaks waiting for ground trace, and breaks with trace done waiting for spawn
+	TArray<FWaterTankBreak> QueuedBreaks;
+	TArray<FWaterTankBreak> TracedBreaks;
+
+	// Glass hits waiting for their effects, oldest first
+	TArray<FWaterGlassHit> QueuedGlassHits;
+
+	// Wetness tiles waiting for floor traces, in request order
+	TMap<FIntVector, FWaterWetnessGroundTrace> GroundTraces;
+	TArray<FIntVector> GroundTraceQueue;
+
+	// Dirty tanks ordered by significance (reused every frame)
+	TArray<int32> SliceOrder;
+
+	// Next spatial hash entry checked by coalescing
+	int32 CoalesceCursor;
+
+	// Next puddle budget entry rescored, and viewers puddles were last scored against
+	int32 BudgetCursor;
+	TArray<FVector, TInlineAllocator<4>> BudgetViewLocations;
+
+	// Time not yet consumed by fixed slosh substeps
+	float SloshTimeAccumulator;
+
+	bool bIsInitialized;
+	bool bIsSimulating;
+	bool bHasRemovedEntries;
+};
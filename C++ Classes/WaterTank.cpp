@@ -16,11 +16,133 @@
 #include "Materials/Material.h"
 #include "Engine/World.h"
 #include "Engine/EngineTypes.h"
+#include "Engine/StaticMesh.h"
+#include "Curves/CurveFloat.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/IConsoleManager.h"
 
 // Assets
 #include "GlassFeather.h"
+#include "LiquidOutflow.h"
+#include "LiquidSliceAtlas.h"
 #include "Waterfall.h"
 #include "WaterPuddle.h"
+#include "WaterActorPoolSubsystem.h"
+#include "WaterSimulationSubsystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("Water Tank Plane Placement"), STAT_WaterTank_PlanePlacement, STATGROUP_WaterSimulation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Water Tank Geometry Rebuilds"), STAT_WaterTank_GeometryRebuilds, STATGROUP_WaterSimulation);
+
+namespace WaterTankHelpers
+{
+	TAutoConsoleVariable<int32> CVarLegacyBounds(
+		TEXT("Water.Tank.LegacyBounds"),
+		0,
+		TEXT("1: surface plane placement queries component bounds and plane rotation every time, as before geometry caching. Used to compare Water Tank Plane Placement cost. 0: cached geometry profile."));
+
+	FORCEINLINE bool UseLegacyBounds()
+	{
+		return CVarLegacyBounds.GetValueOnGameThread() != 0;
+	}
+}
+
+FWaterTankHole::FWaterTankHole()
+{
+	this->LocalPosition = FVector::ZeroVector;
+	this->LocalNormal = FVector::ForwardVector;
+	this->Radius = 0.0f;
+	this->Head = 0.0f;
+	this->bIsFlowing = false;
+	this->bWantsProxy = false;
+	this->PendingOutflowVolume = 0.0f;
+}
+
+FWaterTankGeometry::FWaterTankGeometry()
+{
+	this->GlassMesh = nullptr;
+	this->SurfaceMesh = nullptr;
+	this->GlassScale = FVector::ZeroVector;
+	this->SurfaceScale = FVector::ZeroVector;
+	this->GlassExtent = FVector::ZeroVector;
+	this->SurfaceExtent = FVector::ZeroVector;
+	this->ZBoundScale = 1.0f;
+}
+
+bool FWaterTankGeometry::IsValidFor(const UStaticMeshComponent* Glass, const UStaticMeshComponent* SurfacePlane) const
+{
+	return (this->GlassMesh == Glass->GetStaticMesh())
+		&& (this->SurfaceMesh == SurfacePlane->GetStaticMesh())
+		&& this->GlassScale.Equals(Glass->GetComponentScale())
+		&& this->SurfaceScale.Equals(SurfacePlane->GetComponentScale());
+}
+
+void FWaterTankGeometry::Build(const UStaticMeshComponent* Glass, const UStaticMeshComponent* SurfacePlane)
+{
+	this->GlassMesh = Glass->GetStaticMesh();
+	this->SurfaceMesh = SurfacePlane->GetStaticMesh();
+	this->GlassScale = Glass->GetComponentScale();
+	this->SurfaceScale = SurfacePlane->GetComponentScale();
+
+	// Scale can be negative, extents can not
+	this->GlassExtent = (this->GlassMesh != nullptr) ? this->GlassMesh->GetBounds().BoxExtent * this->GlassScale.GetAbs() : FVector::ZeroVector;
+	this->SurfaceExtent = (this->SurfaceMesh != nullptr) ? this->SurfaceMesh->GetBounds().BoxExtent * this->SurfaceScale.GetAbs() : FVector::ZeroVector;
+
+	this->ZBoundScale = (this->GlassScale.Z / 2.0f) * 50.0f;
+}
+
+float FWaterTankGeometry::GetRotatedExtentZ(const FQuat& Rotation, const FVector& Extent)
+{
+	// Z row of rotation matrix, same as transforming bounds box
+	FVector AxisX = Rotation.GetAxisX();
+	FVector AxisY = Rotation.GetAxisY();
+	FVector AxisZ = Rotation.GetAxisZ();
+
+	return FMath::Abs(AxisX.Z) * Extent.X + FMath::Abs(AxisY.Z) * Extent.Y + FMath::Abs(AxisZ.Z) * Extent.Z;
+}
+
+FLiquidStateInputs::FLiquidStateInputs()
+{
+	this->GlassLocation = FVector::ZeroVector;
+	this->GlassRotation = FRotator::ZeroRotator;
+	this->GlassScale = FVector::ZeroVector;
+	this->FillHeight = 0.0f;
+	this->LiquidSpeed = 0.0f;
+	this->SloshAngle = FVector2D::ZeroVector;
+	this->Viscosity = 0.0f;
+	this->GlassThickness = 0.0f;
+}
+
+bool FLiquidStateInputs::HasChanged(const FLiquidStateInputs& Other, float Tolerance) const
+{
+	auto Differs = [Tolerance](float New, float Old)
+	{
+		return FMath::Abs(New - Old) > Tolerance;
+	};
+
+	// Rotation axes wrap at 180, so their difference is normalized first
+	auto DiffersAngle = [Tolerance](float New, float Old)
+	{
+		return FMath::Abs(FRotator::NormalizeAxis(New - Old)) > Tolerance;
+	};
+
+	return Differs(this->GlassLocation.X, Other.GlassLocation.X)
+		|| Differs(this->GlassLocation.Y, Other.GlassLocation.Y)
+		|| Differs(this->GlassLocation.Z, Other.GlassLocation.Z)
+		|| DiffersAngle(this->GlassRotation.Pitch, Other.GlassRotation.Pitch)
+		|| DiffersAngle(this->GlassRotation.Yaw, Other.GlassRotation.Yaw)
+		|| DiffersAngle(this->GlassRotation.Roll, Other.GlassRotation.Roll)
+		|| Differs(this->GlassScale.X, Other.GlassScale.X)
+		|| Differs(this->GlassScale.Y, Other.GlassScale.Y)
+		|| Differs(this->GlassScale.Z, Other.GlassScale.Z)
+		|| Differs(this->FillHeight, Other.FillHeight)
+		|| Differs(this->LiquidSpeed, Other.LiquidSpeed)
+		|| Differs(this->SloshAngle.X, Other.SloshAngle.X)
+		|| Differs(this->SloshAngle.Y, Other.SloshAngle.Y)
+		|| Differs(this->Viscosity, Other.Viscosity)
+		|| Differs(this->GlassThickness, Other.GlassThickness);
+}
+
+const FName AWaterTank::GlassComponentTag(TEXT("WaterTankGlass"));
 
 // Sets default values
 AWaterTank::AWaterTank()
@@ -34,6 +156,8 @@ AWaterTank::AWaterTank()
 	this->GlassComponent->SetWorldScale3D(FVector(1.5f, 1.5f, 1.5f));
 	this->GlassComponent->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Block);
 	this->GlassComponent->SetSimulatePhysics(false);
+	this->GlassComponent->ComponentTags.Add(GlassComponentTag);
+	this->GlassComponent->OnComponentHit.AddDynamic(this, &AWaterTank::OnGlassHit);
 
 	// Creating liquid static mesh component
 	this->LiquidStaticMeshComponent = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("LiquidStaticMesh"));
@@ -61,61 +185,236 @@ AWaterTank::AWaterTank()
 	this->FillHeight = 50.0f;
 	this->Viscosity = 90.0f;
 	this->GlassThickness = 1.5f;
+	this->SloshFrequency = 1.5f;
+	this->TankShape = ELiquidTankShape::Mesh;
+	this->ShapeResolution = 32;
+	this->SloshAngle = FVector2D::ZeroVector;
+	this->SloshRate = FVector2D::ZeroVector;
+	this->LiquidVelocity = FVector::ZeroVector;
+	this->LiquidAcceleration = FVector::ZeroVector;
+	this->SloshTimeAccumulator = 0.0f;
+	this->bUseSurfaceHeightfield = false;
+	this->SurfaceSubdivision = 3;
+	this->SurfaceWaveHeight = 2.0f;
+	this->SurfaceDamping = 0.02f;
+	this->SurfaceBudgetMicroseconds = 50.0f;
+	this->SurfaceImpactStrength = 1.0f;
+	this->SurfaceDrainStrength = 0.5f;
+	this->LODReducedDistance = 1500.0f;
+	this->LODFrozenDistance = 6000.0f;
+	this->LODReducedInterval = 0.1f;
+	this->bUseReducedLiquidSlicer = false;
+	this->LiquidSliceMicroseconds = 0.0f;
+	this->LiquidUpdateLOD = ELiquidUpdateLOD::Full;
+	this->LiquidSliceAtlas = nullptr;
+	this->PendingVolumeFraction = 0.0f;
+	this->bHasLiquidSliceAtlas = false;
+	this->bUseChangeDetection = true;
+	this->ChangeDetectionTolerance = 0.01f;
+	this->RestTickInterval = 0.5f;
+	this->bHasLiquidState = false;
+	this->bIsLiquidAtRest = false;
+	this->SimulationIndex = INDEX_NONE;
 	this->LargeWaterPuddleScale = FVector(4.0f, 4.0f, 4.0f);
 	this->MediumWaterPuddleScale = FVector(2.0f, 2.0f, 2.0f);
 	this->SmallWaterPuddleScale = FVector(1.0f, 1.0f, 1.0f);
+	this->BreakPuddleScaleCurve = nullptr;
 	this->WorldNormalZ = FVector(0.0f, 0.0f, 1.0f);
+	this->PlaneNormal = FVector(0.0f, 0.0f, -1.0f);
+	this->OutflowTimeAccumulator = 0.0f;
+	this->DrainedVolume = 0.0f;
+	this->WaterfallProxyClass = nullptr;
+	this->BreakHoleCount = 5;
+	this->HoleMaxAngle = 60.0f;
+	this->FlowingHoleCount = 0;
 }
 
 // Called when the game starts or when spawned
 void AWaterTank::BeginPlay()
 {
 	Super::BeginPlay();
+
+	// Splitting cap so that surface waves have vertices to move
+	if (this->bUseSurfaceHeightfield)
+	{
+		this->LiquidSlicer.SetCapSubdivision(this->SurfaceSubdivision);
+		this->ReducedLiquidSlicer.SetCapSubdivision(this->SurfaceSubdivision);
+		this->LiquidSurface.Initialize();
+	}
+
+	// Building analytic shape from liquid mesh bounds, waves need cap vertices of mesh slicer
+	if ((this->TankShape != ELiquidTankShape::Mesh) && !(this->bUseSurfaceHeightfield) && (this->LiquidStaticMeshComponent->GetStaticMesh() != nullptr))
+	{
+		this->ShapeSlicer = FLiquidShapeSlicer::Create(this->TankShape, this->ShapeResolution);
+		this->ShapeSlicer->Initialize(this->LiquidStaticMeshComponent->GetStaticMesh()->GetBoundingBox());
+		this->ShapeSlicer->InitBuffers(this->LiquidSliceBuffers);
+		this->ShapeSlicer->InitBuffers(this->LiquidSliceBackBuffers);
+
+		// Creating liquid sections with initial surface
+		SetPlanePositionAndRotation(ComputePlaneRotation(this->SloshAngle));
+		PrepareLiquidSlice();
+		SliceLiquid();
+		Swap(this->LiquidSliceBuffers, this->LiquidSliceBackBuffers);
+		this->ShapeSlicer->CreateSections(this->LiquidProceduralMeshComponent, this->LiquidSliceBuffers, this->LiquidStaticMeshComponent->GetMaterial(0));
+	}
+	// Caching liquid mesh once, it is re-clipped every frame instead of being copied
+	else if (this->LiquidSlicer.Initialize(this->LiquidStaticMeshComponent->GetStaticMesh(), 0))
+	{
+		this->LiquidSlicer.InitBuffers(this->LiquidSliceBuffers);
+		this->LiquidSlicer.InitBuffers(this->LiquidSliceBackBuffers);
+
+		// Getting volume table of liquid mesh (baked once per mesh asset)
+		this->LiquidVolumeTable = FLiquidVolumeTable::FindOrBake(this->LiquidStaticMeshComponent->GetStaticMesh(), this->LiquidSlicer);
+
+		// Using baked slices when atlas was made from this mesh (waves need runtime cap)
+		this->bHasLiquidSliceAtlas = (this->LiquidSliceAtlas != nullptr)
+								  && (this->LiquidSliceAtlas->SourceMesh == this->LiquidStaticMeshComponent->GetStaticMesh())
+								  && this->LiquidSliceAtlas->IsCompatible(this->LiquidSlicer)
+								  && this->LiquidVolumeTable.IsValid()
+								  && !(this->bUseSurfaceHeightfield);
+
+		// Caching coarser mesh LOD for reduced update rate
+		UStaticMesh* LiquidMesh = this->LiquidStaticMeshComponent->GetStaticMesh();
+		if (LiquidMesh->GetNumLODs() > 1)
+		{
+			this->ReducedLiquidSlicer.Initialize(LiquidMesh, 1);
+		}
+
+		// Creating liquid sections with initial surface
+		SetPlanePositionAndRotation(ComputePlaneRotation(this->SloshAngle));
+		PrepareLiquidSlice();
+		SliceLiquid();
+		Swap(this->LiquidSliceBuffers, this->LiquidSliceBackBuffers);
+		this->LiquidSlicer.CreateSections(this->LiquidProceduralMeshComponent, this->LiquidSliceBuffers, this->LiquidStaticMeshComponent->GetMaterial(0));
+	}
+
+	// Setting start position for velocity
+	this->LastPosition = this->GlassComponent->GetComponentLocation();
+
+	// Waking up liquid when tank is moved
+	this->GlassComponent->TransformUpdated.AddUObject(this, &AWaterTank::OnGlassTransformUpdated);
+
+	// Handing per frame update over to water simulation
+	UWorld* const World = GetWorld();
+	if (World != nullptr)
+	{
+		UWaterSimulationSubsystem* WaterSimulation = World->GetSubsystem<UWaterSimulationSubsystem>();
+		if (WaterSimulation != nullptr)
+		{
+			WaterSimulation->RegisterWaterTank(this);
+			SetActorTickEnabled(false);
+		}
+	}
 }
 
-// Called every frame
+void AWaterTank::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// Worker must be done with our buffers before they go away
+	if (this->LiquidSliceTask.IsValid())
+	{
+		FTaskGraphInterface::Get().WaitUntilTaskCompletes(this->LiquidSliceTask);
+		this->LiquidSliceTask = nullptr;
+	}
+
+	// Handing waterfalls of holes back to pool
+	if (EndPlayReason == EEndPlayReason::Destroyed)
+	{
+		for (int32 i = 0; i < this->Holes.Num(); ++i)
+		{
+			ReleaseHoleProxy(i);
+		}
+	}
+
+	// Leaving water simulation
+	UWorld* const World = GetWorld();
+	if (World != nullptr)
+	{
+		UWaterSimulationSubsystem* WaterSimulation = World->GetSubsystem<UWaterSimulationSubsystem>();
+		if (WaterSimulation != nullptr)
+		{
+			WaterSimulation->UnregisterWaterTank(this);
+		}
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+// Called every frame, only when tank is not driven by water simulation
 void AWaterTank::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
-	// Setting plane pos and rot
-	SetPlanePositionAndRotation();
+	// Checking if we should destroy water tank before touching its liquid
+	DestroyWaterTank();
+	if (IsPendingKillPending())
+	{
+		return;
+	}
+
+	// Getting liquid velocity from container movement
+	UpdateLiquidVelocity(DeltaTime);
 
-	// Updating liquid
-	UpdateLiquid();
+	// Advancing surface slosh
+	UpdateSlosh(DeltaTime);
 
-	// Checking if we should destroy water tank every frame
-	DestroyWaterTank();
+	// Advancing surface waves
+	UpdateLiquidSurface(DeltaTime);
+
+	// Rebuilding liquid only when something affecting its shape has changed
+	if (RefreshLiquidState())
+	{
+		// Setting plane pos and rot
+		SetPlanePositionAndRotation(ComputePlaneRotation(this->SloshAngle));
 
-	// Depleting water tank if there are any visible waterfalls
-	DepleteWaterTank();
+		// Clipping liquid mesh
+		PrepareLiquidSlice();
+		SliceLiquid();
+
+		// Updating liquid
+		UpdateLiquid();
+	}
+
+	// Depleting water tank if there are any flowing holes
+	UpdateHoles();
+	DepleteWaterTank(DeltaTime);
 }
 
 FVector AWaterTank::GetPlaneNormal()
 {
-	FRotator SPCRot = this->SurfacePlaneComponent->GetComponentRotation();
+	if (WaterTankHelpers::UseLegacyBounds())
+	{
+		FRotator SPCRot = this->SurfacePlaneComponent->GetComponentRotation();
 
-	float X = UKismetMathLibrary::DegTan(SPCRot.Roll);
-	float Y = UKismetMathLibrary::DegTan(SPCRot.Pitch);
-	float Z = UKismetMathLibrary::DegCos(SPCRot.Yaw);
+		float X = UKismetMathLibrary::DegTan(SPCRot.Roll);
+		float Y = UKismetMathLibrary::DegTan(SPCRot.Pitch);
+		float Z = UKismetMathLibrary::DegCos(SPCRot.Yaw);
 
-	FVector PlaneNormal(Y, -X, -Z);
+		return FVector(Y, -X, -Z);
+	}
 
-	return PlaneNormal;
+	return this->PlaneNormal;
 }
 
 float AWaterTank::GetContainerZBound()
 {
-	FVector Origin;
-	FVector BoxExtent;
-	float SphereRadius;
-	UKismetSystemLibrary::GetComponentBounds(this->GlassComponent, Origin, BoxExtent, SphereRadius);
+	if (WaterTankHelpers::UseLegacyBounds())
+	{
+		FVector Origin;
+		FVector BoxExtent;
+		float SphereRadius;
+		UKismetSystemLibrary::GetComponentBounds(this->GlassComponent, Origin, BoxExtent, SphereRadius);
 
-	float A = BoxExtent.Z / 1.0f;
+		float A = this->ShapeSlicer.IsValid() ? this->ShapeSlicer->GetHalfHeight() * this->LiquidProceduralMeshComponent->GetComponentScale().Z : BoxExtent.Z;
+		float B = (this->GlassComponent->GetComponentScale().Z / 2.0f) * 50.0f;
 
-	float B = (this->GlassComponent->GetComponentScale().Z / 2.0f) * 50.0f;
+		return A / B;
+	}
+
+	// Analytic shape knows its height
+	float A = this->ShapeSlicer.IsValid() ? this->ShapeSlicer->GetHalfHeight() * this->LiquidProceduralMeshComponent->GetComponentScale().Z
+										  : FWaterTankGeometry::GetRotatedExtentZ(this->GlassComponent->GetComponentQuat(), this->Geometry.GlassExtent);
 
-	float ContainerZBound = A / B;
+	float ContainerZBound = A / this->Geometry.ZBoundScale;
 
 	return ContainerZBound;
 }
@@ -138,90 +437,519 @@ float AWaterTank::GetAngleBetweenVectorsD(FVector A, FVector B)
 	return AngleD;
 }
 
-void AWaterTank::SetPlanePositionAndRotation()
+FRotator AWaterTank::ComputePlaneRotation(const FVector2D& Angle)
 {
-	float A = (this->FillHeight - 50.0f) * GetContainerZBound();
+	// X tilt goes to roll and Y tilt to pitch, as GetPlaneNormal expects
+	return UKismetMathLibrary::MakeRotator(Angle.X, Angle.Y, 0.0f);
+}
 
-	FVector Origin;
-	FVector BoxExtent;
-	float SphereRadius;
-	UKismetSystemLibrary::GetComponentBounds(this->SurfacePlaneComponent, Origin, BoxExtent, SphereRadius);
+ELiquidUpdateLOD AWaterTank::ComputeUpdateLOD(float ViewDistance, bool bWasRecentlyRendered, float ReducedDistance, float FrozenDistance)
+{
+	if (!bWasRecentlyRendered || (ViewDistance >= FrozenDistance))
+	{
+		return ELiquidUpdateLOD::Frozen;
+	}
 
-	float B = BoxExtent.Z * ((1.0f - (this->FillHeight / 10.0f)) / (this->FillHeight + 1.0f));
+	return (ViewDistance >= ReducedDistance) ? ELiquidUpdateLOD::Reduced : ELiquidUpdateLOD::Full;
+}
 
-	float C = A - B;
+const FLiquidSlicer& AWaterTank::GetActiveLiquidSlicer() const
+{
+	return this->bUseReducedLiquidSlicer ? this->ReducedLiquidSlicer : this->LiquidSlicer;
+}
 
-	FVector NewPlanePos = this->SurfacePlaneComponent->GetComponentLocation() + FVector(0.0f, 0.0f, C);
+void AWaterTank::SetLiquidUpdateLOD(ELiquidUpdateLOD NewLOD)
+{
+	if (this->LiquidUpdateLOD == NewLOD)
+	{
+		return;
+	}
 
-	// Setting plane position
-	this->PlanePosition = NewPlanePos;
-	
-	FVector A1 = this->LiquidVelocity / 100.0f;
-	float B1 = 20.0f - (0.2f * this->Viscosity);
-	FVector C1 = A1 * B1;
+	ELiquidUpdateLOD OldLOD = this->LiquidUpdateLOD;
+	this->LiquidUpdateLOD = NewLOD;
+
+	// Frozen tanks keep whatever mesh they show
+	if (NewLOD == ELiquidUpdateLOD::Frozen)
+	{
+		return;
+	}
+
+	// Frozen mesh may be stale, so it is rebuilt on next update
+	if (OldLOD == ELiquidUpdateLOD::Frozen)
+	{
+		this->bHasLiquidState = false;
+	}
+
+	bool bUseReduced = (NewLOD == ELiquidUpdateLOD::Reduced) && this->ReducedLiquidSlicer.IsInitialized();
+	if ((bUseReduced == this->bUseReducedLiquidSlicer) || !(this->LiquidSlicer.IsInitialized()))
+	{
+		return;
+	}
+
+	// Slicers have different topology, so sections are recreated right away
+	FinishLiquidSlice();
+	this->bUseReducedLiquidSlicer = bUseReduced;
+
+	const FLiquidSlicer& Slicer = GetActiveLiquidSlicer();
+	Slicer.InitBuffers(this->LiquidSliceBuffers);
+	Slicer.InitBuffers(this->LiquidSliceBackBuffers);
+
+	PrepareLiquidSlice();
+	SliceLiquid();
+	Swap(this->LiquidSliceBuffers, this->LiquidSliceBackBuffers);
+	Slicer.CreateSections(this->LiquidProceduralMeshComponent, this->LiquidSliceBuffers, this->LiquidStaticMeshComponent->GetMaterial(0));
+}
+
+void AWaterTank::UpdateLiquidVelocity(float DeltaTime)
+{
+	FVector CurrentPosition = this->GlassComponent->GetComponentLocation();
+
+	if (DeltaTime > KINDA_SMALL_NUMBER)
+	{
+		FVector NewLiquidVelocity = (CurrentPosition - this->LastPosition) / DeltaTime;
+		FVector MeasuredAcceleration = (NewLiquidVelocity - this->LiquidVelocity) / DeltaTime;
+		this->LiquidAcceleration = FLiquidSlosh::FilterAcceleration(MeasuredAcceleration, this->LiquidAcceleration, DeltaTime);
+		this->LiquidVelocity = NewLiquidVelocity;
+	}
 
-	FRotator NewPlaneRot = UKismetMathLibrary::MakeRotator(C1.X, C1.Y, C1.Z);
+	this->LastPosition = CurrentPosition;
+}
+
+void AWaterTank::UpdateSlosh(float DeltaTime)
+{
+	int32 NumSubsteps = FLiquidSlosh::ConsumeSubsteps(DeltaTime, this->SloshTimeAccumulator);
+
+	float Stiffness;
+	float Damping;
+	FLiquidSlosh::GetSpringParams(this->SloshFrequency, this->Viscosity, Stiffness, Damping);
+
+	// Surface is pulled towards tilt matching container acceleration
+	float TargetX = FLiquidSlosh::GetTargetAngle(this->LiquidAcceleration.X);
+	float TargetY = FLiquidSlosh::GetTargetAngle(this->LiquidAcceleration.Y);
+
+	FLiquidSlosh::Integrate(1, &this->SloshAngle.X, &this->SloshRate.X, &TargetX, &Stiffness, &Damping, NumSubsteps);
+	FLiquidSlosh::Integrate(1, &this->SloshAngle.Y, &this->SloshRate.Y, &TargetY, &Stiffness, &Damping, NumSubsteps);
+}
+
+void AWaterTank::UpdateLiquidSurface(float DeltaTime)
+{
+	if (!(this->bUseSurfaceHeightfield) || !(this->LiquidSurface.IsInitialized()))
+	{
+		return;
+	}
+
+	// Pulling surface down above holes that are draining
+	if (this->FlowingHoleCount > 0)
+	{
+		for (int32 i = 0; i < this->Holes.Num(); ++i)
+		{
+			if (this->Holes[i].bIsFlowing)
+			{
+				AddSurfaceImpulse(GetHoleLocation(i), -this->SurfaceDrainStrength * DeltaTime);
+			}
+		}
+	}
+
+	this->LiquidSurface.Step(DeltaTime, this->SurfaceDamping, this->SurfaceBudgetMicroseconds);
+}
+
+void AWaterTank::AddSurfaceImpulse(FVector WorldLocation, float Strength)
+{
+	if (!(this->bUseSurfaceHeightfield) || !(this->LiquidSlicer.IsInitialized()))
+	{
+		return;
+	}
+
+	FVector LocalLocation = this->LiquidProceduralMeshComponent->GetComponentTransform().InverseTransformPosition(WorldLocation);
+	this->LiquidSurface.AddImpulse(this->LiquidSlicer.GetCapUV(LocalLocation), 0.15f, Strength);
+}
+
+void AWaterTank::SetPlanePositionAndRotation(FRotator NewPlaneRot)
+{
+	SCOPE_CYCLE_COUNTER(STAT_WaterTank_PlanePlacement);
+
+	RefreshGeometry();
+
+	if (!(this->LiquidVolumeTable.IsValid()) && !(this->ShapeSlicer.IsValid()))
+	{
+		float A = (this->FillHeight - 50.0f) * GetContainerZBound();
+
+		float SurfaceExtentZ;
+		if (WaterTankHelpers::UseLegacyBounds())
+		{
+			FVector Origin;
+			FVector BoxExtent;
+			float SphereRadius;
+			UKismetSystemLibrary::GetComponentBounds(this->SurfacePlaneComponent, Origin, BoxExtent, SphereRadius);
+			SurfaceExtentZ = BoxExtent.Z;
+		}
+		else
+		{
+			SurfaceExtentZ = FWaterTankGeometry::GetRotatedExtentZ(this->SurfacePlaneComponent->GetComponentQuat(), this->Geometry.SurfaceExtent);
+		}
+
+		float B = SurfaceExtentZ * ((1.0f - (this->FillHeight / 10.0f)) / (this->FillHeight + 1.0f));
+
+		float C = A - B;
+
+		FVector NewPlanePos = this->SurfacePlaneComponent->GetComponentLocation() + FVector(0.0f, 0.0f, C);
+
+		// Setting plane position
+		this->PlanePosition = NewPlanePos;
+	}
 
 	// Setting plane rotation
 	this->SurfacePlaneComponent->SetWorldRotation(NewPlaneRot);
+
+	// Getting plane normal from new rotation once instead of on every use
+	float Roll = FMath::DegreesToRadians(NewPlaneRot.Roll);
+	float Pitch = FMath::DegreesToRadians(NewPlaneRot.Pitch);
+	float Yaw = FMath::DegreesToRadians(NewPlaneRot.Yaw);
+	this->PlaneNormal = FVector(FMath::Tan(Pitch), -FMath::Tan(Roll), -FMath::Cos(Yaw));
+
+	if (this->LiquidVolumeTable.IsValid() || this->ShapeSlicer.IsValid())
+	{
+		// Getting surface up vector in liquid mesh space
+		FTransform ProcMeshTransform = this->LiquidProceduralMeshComponent->GetComponentTransform();
+		FVector LocalUp = -ProcMeshTransform.InverseTransformVectorNoScale(GetPlaneNormal()).GetSafeNormal();
+
+		// Placing plane so that enclosed volume matches fill percentage whatever the tilt is
+		this->FillHeight = FMath::Clamp(this->FillHeight, 0.0f, 100.0f);
+		float PlaneDistance = this->ShapeSlicer.IsValid() ? this->ShapeSlicer->GetPlaneDistance(LocalUp, this->FillHeight / 100.0f)
+														  : this->LiquidVolumeTable->GetPlaneDistance(LocalUp, this->FillHeight / 100.0f);
+
+		// Setting plane position
+		this->PlanePosition = ProcMeshTransform.TransformPosition(LocalUp * PlaneDistance);
+	}
+}
+
+float AWaterTank::GetLiquidVolume()
+{
+	return GetLiquidCapacity() * FMath::Clamp(this->FillHeight, 0.0f, 100.0f) / 100.0f;
+}
+
+float AWaterTank::GetLiquidCapacity()
+{
+	// Local volume scaled by liquid mesh scale
+	FVector Scale = this->LiquidProceduralMeshComponent->GetComponentScale();
+	float ScaleVolume = FMath::Abs(Scale.X * Scale.Y * Scale.Z);
+
+	if (this->ShapeSlicer.IsValid())
+	{
+		return this->ShapeSlicer->GetTotalVolume() * ScaleVolume;
+	}
+
+	if (this->LiquidVolumeTable.IsValid())
+	{
+		return this->LiquidVolumeTable->GetTotalVolume() * ScaleVolume;
+	}
+
+	// Without liquid mesh data glass box is the best guess
+	RefreshGeometry();
+	return 8.0f * this->Geometry.GlassExtent.X * this->Geometry.GlassExtent.Y * this->Geometry.GlassExtent.Z;
+}
+
+float AWaterTank::GetLiquidSurfaceArea()
+{
+	float ScaleZ = FMath::Abs(this->LiquidProceduralMeshComponent->GetComponentScale().Z);
+
+	float LiquidHeight;
+	if (this->ShapeSlicer.IsValid())
+	{
+		LiquidHeight = 2.0f * this->ShapeSlicer->GetHalfHeight() * ScaleZ;
+	}
+	else if (this->LiquidSlicer.IsInitialized())
+	{
+		LiquidHeight = this->LiquidSlicer.GetSourceBounds().GetSize().Z * ScaleZ;
+	}
+	else
+	{
+		RefreshGeometry();
+		LiquidHeight = 2.0f * this->Geometry.GlassExtent.Z;
+	}
+
+	return GetLiquidCapacity() / FMath::Max(LiquidHeight, KINDA_SMALL_NUMBER);
+}
+
+float AWaterTank::GetLiquidHead(FVector WorldLocation)
+{
+	FVector SurfaceUp = -GetPlaneNormal().GetSafeNormal();
+
+	return FLiquidOutflow::GetHead(WorldLocation, this->PlanePosition, SurfaceUp);
+}
+
+void AWaterTank::RefreshGeometry()
+{
+	// Rebuilding geometry profile only when mesh or scale changed
+	if (!(this->Geometry.IsValidFor(this->GlassComponent, this->SurfacePlaneComponent)))
+	{
+		this->Geometry.Build(this->GlassComponent, this->SurfacePlaneComponent);
+		INC_DWORD_STAT(STAT_WaterTank_GeometryRebuilds);
+	}
+}
+
+FPlane AWaterTank::GetLocalSlicePlane()
+{
+	// Moving surface plane into liquid mesh space (same conversion SliceProceduralMesh does)
+	FTransform ProcMeshTransform = this->LiquidProceduralMeshComponent->GetComponentTransform();
+	FVector LocalPlanePos = ProcMeshTransform.InverseTransformPosition(this->PlanePosition);
+	FVector LocalPlaneNormal = ProcMeshTransform.InverseTransformVectorNoScale(GetPlaneNormal()).GetSafeNormal();
+
+	return FPlane(LocalPlanePos, LocalPlaneNormal);
+}
+
+void AWaterTank::PrepareLiquidSlice()
+{
+	this->PendingSlicePlane = GetLocalSlicePlane();
+	this->PendingVolumeFraction = FMath::Clamp(this->FillHeight / 100.0f, 0.0f, 1.0f);
+
+	// Copying wave heights, solver keeps stepping while slice runs
+	if (this->bUseSurfaceHeightfield)
+	{
+		this->PendingLiquidSurface = this->LiquidSurface;
+	}
+}
+
+void AWaterTank::SliceLiquid()
+{
+	// Touches only cached mesh, pending snapshot and back buffers, so it can run on worker threads
+	const FLiquidSlicer& Slicer = GetActiveLiquidSlicer();
+	if (this->ShapeSlicer.IsValid())
+	{
+		uint32 StartCycles = FPlatformTime::Cycles();
+
+		this->ShapeSlicer->Slice(this->PendingSlicePlane, this->LiquidSliceBackBuffers);
+
+		float Microseconds = FPlatformTime::ToMilliseconds(FPlatformTime::Cycles() - StartCycles) * 1000.0f;
+		this->LiquidSliceMicroseconds = (this->LiquidSliceMicroseconds > 0.0f) ? FMath::Lerp(this->LiquidSliceMicroseconds, Microseconds, 0.2f) : Microseconds;
+	}
+	else if (Slicer.IsInitialized())
+	{
+		uint32 StartCycles = FPlatformTime::Cycles();
+
+		// Atlas is baked from full mesh LOD only
+		if (this->bHasLiquidSliceAtlas && !(this->bUseReducedLiquidSlicer))
+		{
+			FVector LocalUp = -FVector(this->PendingSlicePlane.X, this->PendingSlicePlane.Y, this->PendingSlicePlane.Z);
+			this->LiquidSliceAtlas->Sample(LocalUp, this->PendingVolumeFraction, this->LiquidSliceBackBuffers);
+		}
+		else
+		{
+			Slicer.Slice(this->PendingSlicePlane, this->LiquidSliceBackBuffers);
+		}
+
+		if (this->bUseSurfaceHeightfield)
+		{
+			Slicer.DisplaceCap(this->LiquidSliceBackBuffers, this->PendingLiquidSurface, this->SurfaceWaveHeight);
+		}
+
+		// Smoothing cost, single slices are noisy
+		float Microseconds = FPlatformTime::ToMilliseconds(FPlatformTime::Cycles() - StartCycles) * 1000.0f;
+		this->LiquidSliceMicroseconds = (this->LiquidSliceMicroseconds > 0.0f) ? FMath::Lerp(this->LiquidSliceMicroseconds, Microseconds, 0.2f) : Microseconds;
+	}
 }
 
 void AWaterTank::UpdateLiquid()
 {
-	UKismetProceduralMeshLibrary::CopyProceduralMeshFromStaticMeshComponent(this->LiquidStaticMeshComponent, 0, this->LiquidProceduralMeshComponent, false);
+	if (this->ShapeSlicer.IsValid())
+	{
+		Swap(this->LiquidSliceBuffers, this->LiquidSliceBackBuffers);
+		this->ShapeSlicer->UpdateSections(this->LiquidProceduralMeshComponent, this->LiquidSliceBuffers);
+	}
+	else if (this->LiquidSlicer.IsInitialized())
+	{
+		// Pushing re-clipped cached liquid mesh straight into existing sections
+		Swap(this->LiquidSliceBuffers, this->LiquidSliceBackBuffers);
+		GetActiveLiquidSlicer().UpdateSections(this->LiquidProceduralMeshComponent, this->LiquidSliceBuffers);
+	}
+	else
+	{
+		// Fallback if liquid mesh has no CPU accessible data
+		UKismetProceduralMeshLibrary::CopyProceduralMeshFromStaticMeshComponent(this->LiquidStaticMeshComponent, 0, this->LiquidProceduralMeshComponent, false);
 
-	UProceduralMeshComponent* OutOtherHalfProcMesh;
-	UKismetProceduralMeshLibrary::SliceProceduralMesh(this->LiquidProceduralMeshComponent,
-													  this->PlanePosition,
-													  GetPlaneNormal(),
-													  false,
-													  OutOtherHalfProcMesh,
-													  EProcMeshSliceCapOption::UseLastSectionForCap,
-													  this->LiquidStaticMeshComponent->GetMaterial(0));
+		UProceduralMeshComponent* OutOtherHalfProcMesh;
+		UKismetProceduralMeshLibrary::SliceProceduralMesh(this->LiquidProceduralMeshComponent,
+														  this->PlanePosition,
+														  GetPlaneNormal(),
+														  false,
+														  OutOtherHalfProcMesh,
+														  EProcMeshSliceCapOption::UseLastSectionForCap,
+														  this->LiquidStaticMeshComponent->GetMaterial(0));
+	}
 
-	this->LastPosition = this->LiquidProceduralMeshComponent->GetComponentLocation();
 	this->LiquidProceduralMeshComponent->SetWorldTransform(this->GlassComponent->GetComponentTransform());
 	FVector NewPMScale = this->GlassComponent->GetComponentScale() / ((this->GlassThickness * 0.1f) + 1.0f);
 	this->LiquidProceduralMeshComponent->SetRelativeScale3D(NewPMScale);
+}
 
-	UWorld* const World = GetWorld();
-	if (World != nullptr)
+void AWaterTank::LaunchLiquidSlice()
+{
+	// Fallback path uses components, it has to stay on game thread
+	if (!(this->LiquidSlicer.IsInitialized()) && !(this->ShapeSlicer.IsValid()))
+	{
+		UpdateLiquid();
+		return;
+	}
+
+	// Back buffers can only have one writer
+	FinishLiquidSlice();
+
+	this->LiquidSliceTask = FFunctionGraphTask::CreateAndDispatchWhenReady([this]()
 	{
-		FVector A = this->LiquidProceduralMeshComponent->GetComponentLocation() - this->LastPosition;
-		FVector NewLV = A / World->GetDeltaSeconds();
-		this->LiquidVelocity = NewLV;
+		SliceLiquid();
+	}, TStatId(), nullptr, ENamedThreads::AnyBackgroundThreadNormalTask);
+}
+
+bool AWaterTank::FinishLiquidSlice()
+{
+	if (!(this->LiquidSliceTask.IsValid()))
+	{
+		return false;
 	}
+
+	// Slice was launched last frame, it is normally done by now
+	if (!(this->LiquidSliceTask->IsComplete()))
+	{
+		FTaskGraphInterface::Get().WaitUntilTaskCompletes(this->LiquidSliceTask);
+	}
+	this->LiquidSliceTask = nullptr;
+
+	UpdateLiquid();
+
+	return true;
 }
 
-void AWaterTank::DestroyWaterTank()
+bool AWaterTank::RefreshLiquidState()
 {
-	// Resetting glass feather counter
-	this->WaterfallCount = 0;
+	FLiquidStateInputs NewLiquidState = GetLiquidStateInputs();
+	float Tolerance = FMath::Max(this->ChangeDetectionTolerance, 0.0001f);
+	bool bHasChanged = !(this->bUseChangeDetection) || !(this->bHasLiquidState) || NewLiquidState.HasChanged(this->LiquidState, Tolerance);
 
-	// Getting array with attached actors
-	TArray<AActor*> AttachedActorsArray;
-	GetAttachedActors(AttachedActorsArray);
-	int64 LenAAA = AttachedActorsArray.Num();
+	// Moving waves need a rebuild every frame until surface goes to sleep
+	bHasChanged |= this->bUseSurfaceHeightfield && this->LiquidSurface.IsAwake();
 
-	// Counting amount of glass feathers
-	for (int64 i = 0; i < LenAAA; ++i)
+	// Keeping inputs of last rebuild only, small steps below tolerance must not move the reference
+	if (bHasChanged)
 	{
-		AWaterfall* WaterfallActor = Cast<AWaterfall>(AttachedActorsArray[i]);
-		if (WaterfallActor != nullptr)
+		this->LiquidState = NewLiquidState;
+		this->bHasLiquidState = true;
+	}
+	SetLiquidAtRest(!bHasChanged);
+
+	return bHasChanged;
+}
+
+FLiquidStateInputs AWaterTank::GetLiquidStateInputs() const
+{
+	FLiquidStateInputs Inputs;
+	Inputs.GlassLocation = this->GlassComponent->GetComponentLocation();
+	Inputs.GlassRotation = this->GlassComponent->GetComponentRotation();
+	Inputs.GlassScale = this->GlassComponent->GetComponentScale();
+	Inputs.FillHeight = this->FillHeight;
+	Inputs.LiquidSpeed = this->LiquidVelocity.Size();
+	Inputs.SloshAngle = this->SloshAngle;
+	Inputs.Viscosity = this->Viscosity;
+	Inputs.GlassThickness = this->GlassThickness;
+
+	return Inputs;
+}
+
+void AWaterTank::SetLiquidAtRest(bool bAtRest)
+{
+	if (this->bIsLiquidAtRest == bAtRest)
+	{
+		return;
+	}
+
+	this->bIsLiquidAtRest = bAtRest;
+
+	// Rescheduling tick right away so waking up does not wait for the slow interval
+	// (water simulation subsystem does its own scheduling for tanks it drives)
+	if (IsActorTickEnabled())
+	{
+		this->PrimaryActorTick.UpdateTickIntervalAndCoolDown(bAtRest ? this->RestTickInterval : 0.0f);
+	}
+}
+
+void AWaterTank::WakeLiquid()
+{
+	// Forcing rebuild on next tick
+	this->bHasLiquidState = false;
+	SetLiquidAtRest(false);
+}
+
+void AWaterTank::OnGlassHit(UPrimitiveComponent* HitComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit)
+{
+	// Sending ripple from impact point
+	AddSurfaceImpulse(Hit.ImpactPoint, this->SurfaceImpactStrength);
+
+	WakeLiquid();
+}
+
+void AWaterTank::OnGlassTransformUpdated(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	if (this->bIsLiquidAtRest)
+	{
+		WakeLiquid();
+	}
+}
+
+void AWaterTank::RegisterWaterfall(AWaterfall* Waterfall)
+{
+	if ((Waterfall == nullptr) || this->Waterfalls.Contains(Waterfall))
+	{
+		return;
+	}
+
+	// Waterfall attached from outside is a new hole, it is kept as the hole proxy until proxies are reassigned
+	if (!(Waterfall->bIsHoleProxy))
+	{
+		int32 HoleIndex = AddHole(Waterfall->GetActorLocation(), Waterfall->GetActorForwardVector(), Waterfall->HoleRadius);
+		this->Holes[HoleIndex].Proxy = Waterfall;
+		Waterfall->bIsHoleProxy = true;
+		Waterfall->HoleIndex = HoleIndex;
+
+		if (this->WaterfallProxyClass == nullptr)
 		{
-			++this->WaterfallCount;
+			this->WaterfallProxyClass = Waterfall->GetClass();
 		}
 	}
 
-	// Destroying water tank if there are more than 5 glass feathers
-	if (this->WaterfallCount >= 5)
+	this->Waterfalls.Add(Waterfall);
+
+	WakeLiquid();
+}
+
+void AWaterTank::UnregisterWaterfall(AWaterfall* Waterfall)
+{
+	if ((Waterfall == nullptr) || (this->Waterfalls.Remove(Waterfall) == 0))
 	{
-		for (int64 i = LenAAA - 1; i >= 0; --i)
+		return;
+	}
+
+	WakeLiquid();
+}
+
+void AWaterTank::DestroyWaterTank()
+{
+	// Destroying water tank once it has too many holes
+	if (this->Holes.Num() >= this->BreakHoleCount)
+	{
+		// Waterfalls go back to pool instead of being destroyed with tank
+		for (int32 i = 0; i < this->Holes.Num(); ++i)
 		{
-			AttachedActorsArray[i]->Destroy();
+			ReleaseHoleProxy(i);
 		}
 
-		this->Destroy();
+		// Getting array with attached actors (glass feathers and waterfalls)
+		TArray<AActor*> AttachedActorsArray;
+		GetAttachedActors(AttachedActorsArray);
+		int64 LenAAA = AttachedActorsArray.Num();
+
+		for (int64 i = LenAAA - 1; i >= 0; --i)
+		{
+			UWaterActorPoolSubsystem::ReleaseOrDestroy(AttachedActorsArray[i]);
+		}
 
 		// FX
 		UWorld* const World = GetWorld();
@@ -233,82 +961,198 @@ void AWaterTank::DestroyWaterTank()
 			// Explosion
 			UGameplayStatics::SpawnEmitterAtLocation(World, this->ExplosionPS, GetActorLocation(), FRotator::ZeroRotator, FVector(1.0f, 1.0f, 1.0f));
 
-			// Large water puddle (water volume > 70%)
-			if (this->FillHeight >= 70.0f)
-			{
-				// FVector WaterPuddleSpawnLocation = GetActorLocation() - FVector(0.0f, 0.0f, GetActorLocation().Z);
-				FHitResult OutHit;
-				World->LineTraceSingleByChannel(OutHit,
-										 		GetActorLocation(),
-										 		GetActorLocation() - FVector(0.0f, 0.0f, 200.0f),
-										 		ECollisionChannel::ECC_WorldStatic);
-				FVector WaterPuddleSpawnLocation = OutHit.Location;
-				FActorSpawnParameters SpawnParams;
-				AWaterPuddle* SpawnedWaterPuddle = World->SpawnActor<AWaterPuddle>(this->WaterPuddleToSpawn, WaterPuddleSpawnLocation, FRotator::ZeroRotator, SpawnParams);
-				SpawnedWaterPuddle->SetActorScale3D(this->LargeWaterPuddleScale);
-			}
-			
-			// Medium water puddle (40% <= water volume < 70%)
-			if ((this->FillHeight >= 40.0f) && (this->FillHeight < 70.0f))
-			{
-				// FVector WaterPuddleSpawnLocation = GetActorLocation() - FVector(0.0f, 0.0f, GetActorLocation().Z);
-				FHitResult OutHit;
-				World->LineTraceSingleByChannel(OutHit,
-										 		GetActorLocation(),
-										 		GetActorLocation() - FVector(0.0f, 0.0f, 200.0f),
-										 		ECollisionChannel::ECC_WorldStatic);
-				FVector WaterPuddleSpawnLocation = OutHit.Location;
-				FActorSpawnParameters SpawnParams;
-				AWaterPuddle* SpawnedWaterPuddle = World->SpawnActor<AWaterPuddle>(this->WaterPuddleToSpawn, WaterPuddleSpawnLocation, FRotator::ZeroRotator, SpawnParams);
-				SpawnedWaterPuddle->SetActorScale3D(FVector(this->MediumWaterPuddleScale));
-			}
-
-			// Small water puddle (10% <= water volume < 40%)
-			if ((this->FillHeight >= 10.0f) && (this->FillHeight < 40.0f))
+			// Water puddle is spawned (or remaining liquid wets floor) once ground trace is done
+			UWaterSimulationSubsystem* WaterSimulation = World->GetSubsystem<UWaterSimulationSubsystem>();
+			if (WaterSimulation != nullptr)
 			{
-				// FVector WaterPuddleSpawnLocation = GetActorLocation() - FVector(0.0f, 0.0f, GetActorLocation().Z);
-				FHitResult OutHit;
-				World->LineTraceSingleByChannel(OutHit,
-										 		GetActorLocation(),
-										 		GetActorLocation() - FVector(0.0f, 0.0f, 200.0f),
-										 		ECollisionChannel::ECC_WorldStatic);
-				FVector WaterPuddleSpawnLocation = OutHit.Location;
-				FActorSpawnParameters SpawnParams;
-				AWaterPuddle* SpawnedWaterPuddle = World->SpawnActor<AWaterPuddle>(this->WaterPuddleToSpawn, WaterPuddleSpawnLocation, FRotator::ZeroRotator, SpawnParams);
-				SpawnedWaterPuddle->SetActorScale3D(FVector(this->SmallWaterPuddleScale));
+				WaterSimulation->QueueWaterTankBreak(GetActorLocation(), this->WaterPuddleToSpawn, GetBreakPuddleScale(), GetLiquidVolume());
 			}
-
-			// No water puddle (water volume = 0%)
 		}
+
+		this->Destroy();
 	}
 }
 
-void AWaterTank::DepleteWaterTank()
+FVector AWaterTank::GetBreakPuddleScale() const
 {
-	// Resetting visible waterfall counter every frame
-	this->VisibleWaterfallCount = 0;
+	if (this->BreakPuddleScaleCurve != nullptr)
+	{
+		return FVector(FMath::Max(this->BreakPuddleScaleCurve->GetFloatValue(this->FillHeight), 0.0f));
+	}
+
+	// Large water puddle (water volume > 70%)
+	if (this->FillHeight >= 70.0f)
+	{
+		return this->LargeWaterPuddleScale;
+	}
+
+	// Medium water puddle (40% <= water volume < 70%)
+	if (this->FillHeight >= 40.0f)
+	{
+		return this->MediumWaterPuddleScale;
+	}
+
+	// Small water puddle (10% <= water volume < 40%)
+	if (this->FillHeight >= 10.0f)
+	{
+		return this->SmallWaterPuddleScale;
+	}
+
+	// No water puddle (water volume < 10%)
+	return FVector::ZeroVector;
+}
 
-	// Getting array with attached actors
-	TArray<AActor*> AttachedActorsArray;
-	GetAttachedActors(AttachedActorsArray);
-	int64 LenAAA = AttachedActorsArray.Num();
+void AWaterTank::DepleteWaterTank(float DeltaTime)
+{
+	// Draining through flowing holes
+	if (this->FlowingHoleCount <= 0)
+	{
+		this->OutflowTimeAccumulator = 0.0f;
+		return;
+	}
 
-	// Counting visible waterfalls
-	for (int64 i = 0; i < LenAAA; ++i)
+	TArray<int32, TInlineAllocator<16>> HoleIndices;
+	TArray<float, TInlineAllocator<16>> Area;
+	TArray<float, TInlineAllocator<16>> Head;
+	TArray<float, TInlineAllocator<16>> Outflow;
+	for (int32 i = 0; i < this->Holes.Num(); ++i)
 	{
-		AWaterfall* WaterfallActor = Cast<AWaterfall>(AttachedActorsArray[i]);
-		if (WaterfallActor != nullptr)
+		if (this->Holes[i].bIsFlowing)
 		{
-			if (WaterfallActor->WaterfallParticleSystemComponent->IsVisible())
-			{
-				++this->VisibleWaterfallCount;
-			}
+			HoleIndices.Add(i);
+			Area.Add(FLiquidOutflow::GetHoleArea(this->Holes[i].Radius));
+			Head.Add(this->Holes[i].Head);
+			Outflow.Add(0.0f);
 		}
 	}
 
-	// Depleting water tank depending on amount of visible waterfalls
-	if (this->VisibleWaterfallCount > 0)
+	float Capacity = GetLiquidCapacity();
+	float Volume = Capacity * FMath::Clamp(this->FillHeight, 0.0f, 100.0f) / 100.0f;
+	int32 NumSubsteps = FLiquidOutflow::ConsumeSubsteps(DeltaTime, this->OutflowTimeAccumulator);
+	float Drained = FLiquidOutflow::Drain(HoleIndices.Num(), Area.GetData(), Head.GetData(), Outflow.GetData(), Volume, GetLiquidSurfaceArea(), NumSubsteps);
+
+	// Keeping volume ledger, waterfalls pass drained volume on to puddles
+	this->DrainedVolume += Drained;
+	for (int32 i = 0; i < HoleIndices.Num(); ++i)
 	{
-		this->FillHeight -= this->VisibleWaterfallCount * 0.1f;
+		AddHoleOutflow(HoleIndices[i], Outflow[i]);
 	}
+
+	this->FillHeight = (Capacity > 0.0f) ? (Volume - Drained) / Capacity * 100.0f : 0.0f;
+}
+
+int32 AWaterTank::AddHole(FVector WorldLocation, FVector WorldNormal, float Radius)
+{
+	const FTransform& GlassTransform = this->GlassComponent->GetComponentTransform();
+
+	FWaterTankHole Hole;
+	Hole.LocalPosition = GlassTransform.InverseTransformPosition(WorldLocation);
+	Hole.LocalNormal = GlassTransform.InverseTransformVectorNoScale(WorldNormal).GetSafeNormal();
+	Hole.Radius = FMath::Max(Radius, 0.0f);
+
+	WakeLiquid();
+
+	return this->Holes.Add(Hole);
+}
+
+bool AWaterTank::IsGlassComponent(const UPrimitiveComponent* Component) const
+{
+	return (Component != nullptr) && (Component->GetOwner() == this) && ((Component == this->GlassComponent) || Component->ComponentHasTag(GlassComponentTag));
+}
+
+FVector AWaterTank::GetHoleLocation(int32 HoleIndex) const
+{
+	return this->GlassComponent->GetComponentTransform().TransformPosition(this->Holes[HoleIndex].LocalPosition);
+}
+
+FVector AWaterTank::GetHoleNormal(int32 HoleIndex) const
+{
+	return this->GlassComponent->GetComponentTransform().TransformVectorNoScale(this->Holes[HoleIndex].LocalNormal);
+}
+
+void AWaterTank::UpdateHoles()
+{
+	this->FlowingHoleCount = 0;
+	if (this->Holes.Num() == 0)
+	{
+		return;
+	}
+
+	const FTransform& GlassTransform = this->GlassComponent->GetComponentTransform();
+	FVector SurfaceUp = -GetPlaneNormal().GetSafeNormal();
+
+	for (FWaterTankHole& Hole : this->Holes)
+	{
+		FVector Location = GlassTransform.TransformPosition(Hole.LocalPosition);
+		FVector Normal = GlassTransform.TransformVectorNoScale(Hole.LocalNormal);
+
+		// Hole leaks while it is under the surface, tank is not empty and it does not face up
+		Hole.Head = FLiquidOutflow::GetHead(Location, this->PlanePosition, SurfaceUp);
+		float HoleAngle = GetAngleBetweenVectorsD(Normal, this->WorldNormalZ);
+		Hole.bIsFlowing = (Hole.Head > 0.0f) && (this->FillHeight > 0.0f) && (HoleAngle > this->HoleMaxAngle);
+
+		this->FlowingHoleCount += Hole.bIsFlowing ? 1 : 0;
+	}
+}
+
+void AWaterTank::AddHoleOutflow(int32 HoleIndex, float Volume)
+{
+	FWaterTankHole& Hole = this->Holes[HoleIndex];
+	Hole.PendingOutflowVolume += Volume;
+
+	// Holes without proxy keep their volume until one is attached
+	if (Hole.Proxy.IsValid())
+	{
+		Hole.Proxy->PendingOutflowVolume += Hole.PendingOutflowVolume;
+		Hole.PendingOutflowVolume = 0.0f;
+	}
+}
+
+void AWaterTank::AcquireHoleProxy(int32 HoleIndex)
+{
+	FWaterTankHole& Hole = this->Holes[HoleIndex];
+	UWorld* const World = GetWorld();
+	if (Hole.Proxy.IsValid() || (this->WaterfallProxyClass == nullptr) || (World == nullptr))
+	{
+		return;
+	}
+
+	UWaterActorPoolSubsystem* ActorPool = World->GetSubsystem<UWaterActorPoolSubsystem>();
+	if (ActorPool == nullptr)
+	{
+		return;
+	}
+
+	FTransform ProxyTransform(GetHoleNormal(HoleIndex).Rotation(), GetHoleLocation(HoleIndex));
+	AWaterfall* Proxy = ActorPool->Acquire<AWaterfall>(this->WaterfallProxyClass, ProxyTransform);
+	if (Proxy == nullptr)
+	{
+		return;
+	}
+
+	Proxy->bIsHoleProxy = true;
+	Proxy->HoleIndex = HoleIndex;
+	Proxy->HoleRadius = Hole.Radius;
+	Proxy->AttachToComponent(this->GlassComponent, FAttachmentTransformRules::KeepWorldTransform);
+	Hole.Proxy = Proxy;
+
+	// Passing volume drained while hole had no proxy
+	AddHoleOutflow(HoleIndex, 0.0f);
+}
+
+void AWaterTank::ReleaseHoleProxy(int32 HoleIndex)
+{
+	FWaterTankHole& Hole = this->Holes[HoleIndex];
+	AWaterfall* Proxy = Hole.Proxy.Get();
+	Hole.Proxy = nullptr;
+	if (Proxy == nullptr)
+	{
+		return;
+	}
+
+	// Volume proxy did not hand to a puddle stays with hole
+	Hole.PendingOutflowVolume += Proxy->PendingOutflowVolume;
+	Proxy->PendingOutflowVolume = 0.0f;
+
+	UWaterActorPoolSubsystem::ReleaseOrDestroy(Proxy);
 }
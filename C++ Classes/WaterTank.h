@@ -5,9 +5,103 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 #include "ProceduralMeshComponent.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "LiquidSlicer.h"
+#include "LiquidVolumeTable.h"
+#include "LiquidSlosh.h"
+#include "LiquidSurface.h"
+#include "LiquidShapeSlicer.h"
 #include "WaterTank.generated.h"
 
 class AWaterPuddle;
+class AWaterfall;
+class ULiquidSliceAtlas;
+class UCurveFloat;
+
+// How much work water simulation spends on a tank
+UENUM(BlueprintType)
+enum class ELiquidUpdateLOD : uint8
+{
+	// Slosh and slice every frame
+	Full,
+	// Slice every LODReducedInterval from coarser liquid mesh LOD
+	Reduced,
+	// Liquid geometry is kept as is, only fill height is updated
+	Frozen
+};
+
+// Hole in tank glass, kept as plain data. A pooled waterfall is attached as its render and
+// audio proxy only while the hole is flowing and close to a viewer.
+struct FWaterTankHole
+{
+	FWaterTankHole();
+
+	// Location and outward direction in glass space
+	FVector LocalPosition;
+	FVector LocalNormal;
+
+	// Radius in cm
+	float Radius;
+
+	// Flow state, updated with tank
+	float Head;
+	bool bIsFlowing;
+
+	// Set by proxy assignment when hole should be shown
+	bool bWantsProxy;
+
+	// Drained volume not yet passed on to a proxy
+	float PendingOutflowVolume;
+
+	TWeakObjectPtr<AWaterfall> Proxy;
+};
+
+// Tank geometry that only changes with component mesh or scale.
+// Bounds queries are replaced by rotating cached local extents, which gives the same Z extent
+// as component bounds without walking the component.
+struct FWaterTankGeometry
+{
+	FWaterTankGeometry();
+
+	// Checking if profile was built from components as they are now
+	bool IsValidFor(const UStaticMeshComponent* Glass, const UStaticMeshComponent* SurfacePlane) const;
+
+	void Build(const UStaticMeshComponent* Glass, const UStaticMeshComponent* SurfacePlane);
+
+	// Getting world Z extent of scaled local extent under rotation
+	static float GetRotatedExtentZ(const FQuat& Rotation, const FVector& Extent);
+
+	const UStaticMesh* GlassMesh;
+	const UStaticMesh* SurfaceMesh;
+	FVector GlassScale;
+	FVector SurfaceScale;
+
+	// Mesh bounds extents times component scale
+	FVector GlassExtent;
+	FVector SurfaceExtent;
+
+	// Divisor of container Z bound (glass scale Z in fill height units)
+	float ZBoundScale;
+};
+
+// Inputs that affect liquid shape. Values of last rebuild are kept, so slow drift still adds up
+// to a rebuild once it passes the tolerance.
+struct FLiquidStateInputs
+{
+	FLiquidStateInputs();
+
+	// Checking if any input is more than tolerance away from other state
+	bool HasChanged(const FLiquidStateInputs& Other, float Tolerance) const;
+
+	FVector GlassLocation;
+	FRotator GlassRotation;
+	FVector GlassScale;
+	float FillHeight;
+	float LiquidSpeed;
+	FVector2D SloshAngle;
+	float Viscosity;
+	float GlassThickness;
+};
 
 UCLASS()
 class FACILITY_API AWaterTank : public AActor
@@ -23,9 +117,12 @@ protected:
 	virtual void BeginPlay() override;
 
 public:	
-	// Called every frame
+	// Called every frame (only while tank is not driven by water simulation subsystem)
 	virtual void Tick(float DeltaTime) override;
 
+	// Called when tank is removed from level
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Water Container Components")
 	UStaticMeshComponent* GlassComponent;
@@ -39,7 +136,8 @@ public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Water Container Components")
 	UStaticMeshComponent* SurfacePlaneComponent;
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Water Container Options")
+	// Liquid volume in percent of tank volume (plain height percentage if mesh has no volume table)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Water Container Options", meta = (ClampMin = "0.0", ClampMax = "100.0"))
 	float FillHeight;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Water Container Options")
@@ -48,6 +146,70 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Water Container Options")
 	float GlassThickness;
 
+	// Natural slosh frequency of liquid surface in Hz (damping comes from Viscosity)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Water Container Options", meta = (ClampMin = "0.01"))
+	float SloshFrequency;
+
+	// Analytic liquid shape fitted to liquid mesh bounds (Mesh clips liquid mesh itself, surface waves need Mesh)
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Water Container Options")
+	ELiquidTankShape TankShape;
+
+	// Segments around shape perimeter
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Water Container Options", meta = (ClampMin = "4", ClampMax = "128"))
+	int32 ShapeResolution;
+
+	// Simulating waves on liquid surface (impacts, draining) instead of keeping it flat
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Water Container Options")
+	bool bUseSurfaceHeightfield;
+
+	// Cap triangle splits per edge, more gives smoother waves but bigger cap section
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Water Container Options", meta = (EditCondition = "bUseSurfaceHeightfield", ClampMin = "1", ClampMax = "8"))
+	int32 SurfaceSubdivision;
+
+	// Wave height in cm for unit surface displacement
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Water Container Options", meta = (EditCondition = "bUseSurfaceHeightfield", ClampMin = "0.0"))
+	float SurfaceWaveHeight;
+
+	// Fraction of wave motion lost per solver step
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Water Container Options", meta = (EditCondition = "bUseSurfaceHeightfield", ClampMin = "0.0", ClampMax = "1.0"))
+	float SurfaceDamping;
+
+	// Surface solver time allowed per tank and frame, in microseconds
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Water Container Options", meta = (EditCondition = "bUseSurfaceHeightfield", ClampMin = "1.0"))
+	float SurfaceBudgetMicroseconds;
+
+	// Surface push of a glass hit
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Water Container Options", meta = (EditCondition = "bUseSurfaceHeightfield"))
+	float SurfaceImpactStrength;
+
+	// Surface pull per second above every visible waterfall
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Water Container Options", meta = (EditCondition = "bUseSurfaceHeightfield"))
+	float SurfaceDrainStrength;
+
+	// View distance where liquid updates drop to reduced rate
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Water Container Options", meta = (ClampMin = "0.0"))
+	float LODReducedDistance;
+
+	// View distance where liquid geometry gets frozen (off-screen tanks are always frozen)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Water Container Options", meta = (ClampMin = "0.0"))
+	float LODFrozenDistance;
+
+	// Time between liquid updates at reduced rate
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Water Container Options", meta = (ClampMin = "0.0"))
+	float LODReducedInterval;
+
+	// Skipping liquid rebuild while its inputs stay the same
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Water Container Options")
+	bool bUseChangeDetection;
+
+	// Smallest change of liquid inputs that triggers a rebuild
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Water Container Options", meta = (EditCondition = "bUseChangeDetection", ClampMin = "0.0001"))
+	float ChangeDetectionTolerance;
+
+	// Tick interval used while liquid is at rest
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Water Container Options", meta = (EditCondition = "bUseChangeDetection", ClampMin = "0.0"))
+	float RestTickInterval;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Water Container Options")
 	FVector LargeWaterPuddleScale;
 
@@ -57,6 +219,11 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Water Container Options")
 	FVector SmallWaterPuddleScale;
 
+	// Puddle scale left by broken tank over fill height (0..100), 0 or less leaves none.
+	// Large, medium and small puddle scales are used if not set
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Water Container Options")
+	UCurveFloat* BreakPuddleScaleCurve;
+
 	UPROPERTY(EditDefaultsOnly, Category = "Water Container Assets")
 	USoundBase* ExplosionSound;
 
@@ -66,14 +233,218 @@ public:
 	UPROPERTY(EditDefaultsOnly, Category = "Water Container Assets")
 	TSubclassOf<AWaterPuddle> WaterPuddleToSpawn;
 
-	int VisibleWaterfallCount;
-	int WaterfallCount;
+	// Pre-sliced liquid mesh, used instead of runtime slicing when baked from liquid mesh
+	UPROPERTY(EditDefaultsOnly, Category = "Water Container Assets")
+	ULiquidSliceAtlas* LiquidSliceAtlas;
+
+	// Waterfall shown at flowing holes near viewers, needed for holes made by projectiles (class of first attached waterfall if not set)
+	UPROPERTY(EditDefaultsOnly, Category = "Water Container Assets")
+	TSubclassOf<AWaterfall> WaterfallProxyClass;
+
+	// Number of holes that breaks the tank
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Water Container Options", meta = (ClampMin = "1"))
+	int32 BreakHoleCount;
+
+	// Steepest angle between hole direction and up at which hole still leaks (same test as waterfalls)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Water Container Options", meta = (ClampMin = "0.0", ClampMax = "180.0"))
+	float HoleMaxAngle;
+
+	// Waterfalls attached to this tank
+	TArray<TWeakObjectPtr<AWaterfall>> Waterfalls;
+
+	// Tag of glass components, projectiles make holes in components with it
+	static const FName GlassComponentTag;
+
+	// Holes in glass, never removed while tank lives
+	TArray<FWaterTankHole> Holes;
+	int32 FlowingHoleCount;
 
 	FVector PlanePosition;
+
+	// Surface plane normal, updated with plane rotation
+	FVector PlaneNormal;
+
+	// Cached extents of glass and surface plane
+	FWaterTankGeometry Geometry;
 	FVector LastPosition;
 	FVector LiquidVelocity;
+	FVector LiquidAcceleration;
+
+	// Slosh state: surface tilt (degrees) and its rate around X and Y
+	FVector2D SloshAngle;
+	FVector2D SloshRate;
+	float SloshTimeAccumulator;
+
+	// Time not yet consumed by fixed outflow substeps (actor tick only)
+	float OutflowTimeAccumulator;
+
+	// Liquid volume that left through holes since spawn, handed to waterfalls of those holes
+	float DrainedVolume;
 	FVector WorldNormalZ;
 
+	// Cached liquid mesh and preallocated slice output (front is shown, back is written by slicing)
+	FLiquidSlicer LiquidSlicer;
+	FLiquidSliceBuffers LiquidSliceBuffers;
+	FLiquidSliceBuffers LiquidSliceBackBuffers;
+
+	// Slicer of liquid mesh LOD 1, used at reduced update LOD
+	FLiquidSlicer ReducedLiquidSlicer;
+	bool bUseReducedLiquidSlicer;
+
+	// Slicer of analytic tank shape, replaces liquid mesh slicers when set
+	TUniquePtr<FLiquidShapeSlicer> ShapeSlicer;
+
+	// Slice running on task graph, owns back buffers until it is finished
+	FGraphEventRef LiquidSliceTask;
+
+	// Smoothed cost of one slice, used by water simulation budget
+	float LiquidSliceMicroseconds;
+
+	// Current update LOD (set by water simulation subsystem)
+	ELiquidUpdateLOD LiquidUpdateLOD;
+
+	// Wave displacement of liquid surface
+	FLiquidSurfaceHeightfield LiquidSurface;
+
+	// Plane height and tilt to volume mapping shared by tanks with same liquid mesh
+	TSharedPtr<const FLiquidVolumeTable> LiquidVolumeTable;
+
+	// Inputs used for last liquid rebuild, invalid until first rebuild or after wake up
+	FLiquidStateInputs LiquidState;
+	bool bHasLiquidState;
+	bool bIsLiquidAtRest;
+
+	// Snapshot used by next slice: surface plane in liquid mesh space and wave heights
+	FPlane PendingSlicePlane;
+	float PendingVolumeFraction;
+	FLiquidSurfaceHeightfield PendingLiquidSurface;
+
+	// Set on BeginPlay if slice atlas matches liquid mesh
+	bool bHasLiquidSliceAtlas;
+
+	// Slot in water simulation subsystem
+	int32 SimulationIndex;
+
+	// Getting current liquid volume in world units
+	UFUNCTION(BlueprintCallable, Category = "Water Container")
+	float GetLiquidVolume();
+
+	// Getting liquid volume of full tank in world units
+	UFUNCTION(BlueprintCallable, Category = "Water Container")
+	float GetLiquidCapacity();
+
+	// Getting horizontal cross section of liquid (capacity over liquid height)
+	UFUNCTION()
+	float GetLiquidSurfaceArea();
+
+	// Getting liquid head above world location, measured straight up to surface plane
+	UFUNCTION()
+	float GetLiquidHead(FVector WorldLocation);
+
+	// Adding waterfall to registry when it gets attached
+	UFUNCTION()
+	void RegisterWaterfall(AWaterfall* Waterfall);
+
+	// Removing waterfall from registry when it gets detached or destroyed
+	UFUNCTION()
+	void UnregisterWaterfall(AWaterfall* Waterfall);
+
+	// Making tank tick at full rate again
+	UFUNCTION()
+	void WakeLiquid();
+
+	// Adding hole to glass, returns its index
+	UFUNCTION(BlueprintCallable, Category = "Water Container")
+	int32 AddHole(FVector WorldLocation, FVector WorldNormal, float Radius);
+
+	UFUNCTION(BlueprintCallable, Category = "Water Container")
+	int32 GetNumHoles() const { return this->Holes.Num(); }
+
+	// Checking if component is glass of this tank (glass component or tagged as glass)
+	UFUNCTION(BlueprintCallable, Category = "Water Container")
+	bool IsGlassComponent(const UPrimitiveComponent* Component) const;
+
+	FVector GetHoleLocation(int32 HoleIndex) const;
+	FVector GetHoleNormal(int32 HoleIndex) const;
+
+	// Updating head and flow state of all holes
+	void UpdateHoles();
+
+	// Adding drained volume to hole, passed on to its proxy if it has one
+	void AddHoleOutflow(int32 HoleIndex, float Volume);
+
+	// Attaching pooled waterfall to hole
+	void AcquireHoleProxy(int32 HoleIndex);
+
+	// Handing waterfall of hole back to pool
+	void ReleaseHoleProxy(int32 HoleIndex);
+
+	// Getting surface plane rotation from slosh tilt
+	static FRotator ComputePlaneRotation(const FVector2D& Angle);
+
+
+	// Getting update LOD from distance to closest viewer and visibility
+	static ELiquidUpdateLOD ComputeUpdateLOD(float ViewDistance, bool bWasRecentlyRendered, float ReducedDistance, float FrozenDistance);
+
+	// Switching update LOD, rebuilds liquid sections if slicer changes
+	void SetLiquidUpdateLOD(ELiquidUpdateLOD NewLOD);
+
+	// Getting slicer used for current update LOD
+	const FLiquidSlicer& GetActiveLiquidSlicer() const;
+
+	// Liquid update steps, used by Tick and by water simulation subsystem
+
+	UFUNCTION()
+	void UpdateLiquidVelocity(float DeltaTime);
+
+	UFUNCTION()
+	void UpdateSlosh(float DeltaTime);
+
+	UFUNCTION()
+	void UpdateLiquidSurface(float DeltaTime);
+
+	// Disturbing surface waves at world location
+	UFUNCTION(BlueprintCallable, Category = "Water Container")
+	void AddSurfaceImpulse(FVector WorldLocation, float Strength);
+
+	// Checking change detection, returns true if liquid has to be rebuilt
+	UFUNCTION()
+	bool RefreshLiquidState();
+
+	UFUNCTION()
+	void SetPlanePositionAndRotation(FRotator NewPlaneRot);
+
+	UFUNCTION()
+	void PrepareLiquidSlice();
+
+	// Clipping liquid into back buffers, safe to call from worker threads
+	void SliceLiquid();
+
+	// Swapping in sliced buffers and pushing them into liquid mesh
+	UFUNCTION()
+	void UpdateLiquid();
+
+	// Running SliceLiquid on task graph, result is shown by FinishLiquidSlice
+	void LaunchLiquidSlice();
+
+	// Waiting for launched slice and showing it, returns false if none was running
+	bool FinishLiquidSlice();
+
+	bool HasPendingLiquidSlice() const { return this->LiquidSliceTask.IsValid(); }
+
+	// Getting current inputs that affect liquid shape
+	FLiquidStateInputs GetLiquidStateInputs() const;
+
+	UFUNCTION()
+	void DestroyWaterTank();
+
+	// Getting scale of puddle left by breaking tank at current fill height, zero if none
+	UFUNCTION()
+	FVector GetBreakPuddleScale() const;
+
+	UFUNCTION()
+	void DepleteWaterTank(float DeltaTime);
+
 protected:
 	UFUNCTION()
 	FVector GetPlaneNormal();
@@ -85,14 +456,16 @@ protected:
 	float GetAngleBetweenVectorsD(FVector A, FVector B);
 
 	UFUNCTION()
-	void SetPlanePositionAndRotation();
+	FPlane GetLocalSlicePlane();
 
-	UFUNCTION()
-	void UpdateLiquid();
+	// Rebuilding cached geometry profile if mesh or scale changed
+	void RefreshGeometry();
 
 	UFUNCTION()
-	void DestroyWaterTank();
+	void SetLiquidAtRest(bool bAtRest);
 
 	UFUNCTION()
-	void DepleteWaterTank();
+	void OnGlassHit(UPrimitiveComponent* HitComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit);
+
+	void OnGlassTransformUpdated(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport);
 };
@@ -0,0 +1,166 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "WaterWetnessDecals.h"
+#include "Components/DecalComponent.h"
+#include "Engine/Texture2D.h"
+#include "Engine/World.h"
+#include "Materials/MaterialInstanceDynamic.h"
+#include "Math/UnrealMathUtility.h"
+
+// Assets
+#include "WaterWetnessField.h"
+#include "WaterSimulationSubsystem.h"
+
+// Sets default values
+AWaterWetnessDecals::AWaterWetnessDecals()
+{
+	// Decals are updated by water simulation subsystem
+	PrimaryActorTick.bCanEverTick = false;
+
+	// Creating scene root component
+	this->SceneRootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("SceneRoot"));
+	RootComponent = this->SceneRootComponent;
+
+	// Setting default params
+	this->WetnessMaterial = nullptr;
+	this->WetnessTextureParameter = TEXT("WetnessTexture");
+	this->DecalThickness = 50.0f;
+}
+
+// Called when the game starts or when spawned
+void AWaterWetnessDecals::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// Joining water simulation
+	UWorld* const World = GetWorld();
+	if (World != nullptr)
+	{
+		UWaterSimulationSubsystem* WaterSimulation = World->GetSubsystem<UWaterSimulationSubsystem>();
+		if (WaterSimulation != nullptr)
+		{
+			WaterSimulation->RegisterWetnessDecals(this);
+		}
+	}
+}
+
+void AWaterWetnessDecals::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// Leaving water simulation
+	UWorld* const World = GetWorld();
+	if (World != nullptr)
+	{
+		UWaterSimulationSubsystem* WaterSimulation = World->GetSubsystem<UWaterSimulationSubsystem>();
+		if (WaterSimulation != nullptr)
+		{
+			WaterSimulation->UnregisterWetnessDecals(this);
+		}
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AWaterWetnessDecals::UpdateWetnessDecals(FWaterWetnessField& Field)
+{
+	using namespace WaterWetnessConstants;
+
+	// Hiding decals of dried tiles
+	TArray<FIntVector> RemovedKeys;
+	Field.ConsumeRemovedTiles(RemovedKeys);
+	for (const FIntVector& Key : RemovedKeys)
+	{
+		int32 Slot = INDEX_NONE;
+		if (this->TileSlots.RemoveAndCopyValue(Key, Slot))
+		{
+			this->Decals[Slot]->SetVisibility(false);
+			this->FreeSlots.Add(Slot);
+		}
+	}
+
+	if (this->WetnessMaterial == nullptr)
+	{
+		Field.ClearDirtyFlags();
+		return;
+	}
+
+	// Uploading tiles changed since last frame
+	for (int32 i = 0; i < Field.GetNumTiles(); ++i)
+	{
+		const FWaterWetnessTile& Tile = Field.GetTile(i);
+		if (!(Tile.bIsDirty))
+		{
+			continue;
+		}
+
+		int32* FoundSlot = this->TileSlots.Find(Tile.Key);
+		int32 Slot = (FoundSlot != nullptr) ? *FoundSlot : AcquireSlot(Tile.Key);
+		if (FoundSlot == nullptr)
+		{
+			// Decal projects down along its X axis, Y and Z span tile
+			FVector Centre = FWaterWetnessField::GetTileOrigin(Tile) + FVector(TileSize * 0.5f, TileSize * 0.5f, 0.0f);
+			this->Decals[Slot]->SetWorldLocationAndRotation(Centre, FRotator(-90.0f, 0.0f, 0.0f));
+			this->Decals[Slot]->SetVisibility(true);
+		}
+
+		UploadTile(Slot, Tile.Depth);
+	}
+
+	Field.ClearDirtyFlags();
+}
+
+int32 AWaterWetnessDecals::AcquireSlot(const FIntVector& Key)
+{
+	using namespace WaterWetnessConstants;
+
+	int32 Slot = INDEX_NONE;
+	if (this->FreeSlots.Num() > 0)
+	{
+		Slot = this->FreeSlots.Pop(false);
+	}
+	else
+	{
+		// Creating decal with its own texture and material instance
+		UTexture2D* Texture = UTexture2D::CreateTransient(TileResolution, TileResolution, PF_G8);
+		Texture->SRGB = false;
+		Texture->Filter = TF_Bilinear;
+		Texture->AddressX = TA_Clamp;
+		Texture->AddressY = TA_Clamp;
+		Texture->UpdateResource();
+
+		UMaterialInstanceDynamic* Material = UMaterialInstanceDynamic::Create(this->WetnessMaterial, this);
+		Material->SetTextureParameterValue(this->WetnessTextureParameter, Texture);
+
+		UDecalComponent* Decal = NewObject<UDecalComponent>(this);
+		Decal->SetupAttachment(this->SceneRootComponent);
+		Decal->DecalSize = FVector(this->DecalThickness, TileSize * 0.5f, TileSize * 0.5f);
+		Decal->SetDecalMaterial(Material);
+		Decal->RegisterComponent();
+
+		Slot = this->Decals.Add(Decal);
+		this->Textures.Add(Texture);
+		this->Materials.Add(Material);
+	}
+
+	this->TileSlots.Add(Key, Slot);
+
+	return Slot;
+}
+
+void AWaterWetnessDecals::UploadTile(int32 Slot, const TArray<float>& Depth)
+{
+	using namespace WaterWetnessConstants;
+
+	// Buffers are freed by render thread once copied
+	uint8* Pixels = new uint8[TileResolution * TileResolution];
+	for (int32 i = 0; i < TileResolution * TileResolution; ++i)
+	{
+		Pixels[i] = FWaterWetnessField::QuantizeDepth(Depth[i]);
+	}
+
+	FUpdateTextureRegion2D* Region = new FUpdateTextureRegion2D(0, 0, 0, 0, TileResolution, TileResolution);
+	this->Textures[Slot]->UpdateTextureRegions(0, 1, Region, TileResolution, 1, Pixels, [](uint8* SrcData, const FUpdateTextureRegion2D* Regions)
+	{
+		delete[] SrcData;
+		delete Regions;
+	});
+}
@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "WaterWetnessDecals.generated.h"
+
+class UDecalComponent;
+class UMaterialInterface;
+class UMaterialInstanceDynamic;
+class UTexture2D;
+class FWaterWetnessField;
+
+// Shows wetness field of water simulation subsystem, one large decal per wet tile.
+// Placed once in a level. Every tile decal gets a dynamic instance of wetness material with a
+// small transient texture (one texel per field cell, 0 dry to 255 fully wet) that is uploaded
+// only when its tile changed. Decals of dried tiles are hidden and reused for new tiles.
+UCLASS()
+class FACILITY_API AWaterWetnessDecals : public AActor
+{
+	GENERATED_BODY()
+	
+public:	
+	// Sets default values for this actor's properties
+	AWaterWetnessDecals();
+
+protected:
+	// Called when the game starts or when spawned
+	virtual void BeginPlay() override;
+
+public:
+	// Called when actor is removed from level
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+public:
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Wetness Components")
+	USceneComponent* SceneRootComponent;
+
+	// Decal material sampling wetness texture, mapped over whole tile
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Wetness Options")
+	UMaterialInterface* WetnessMaterial;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Wetness Options")
+	FName WetnessTextureParameter;
+
+	// Depth decals project above and below floor, in cm
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Wetness Options", meta = (ClampMin = "1.0"))
+	float DecalThickness;
+
+	// Uploading changed tiles and hiding dried ones, called by water simulation subsystem
+	void UpdateWetnessDecals(FWaterWetnessField& Field);
+
+	int32 GetNumVisibleDecals() const { return this->TileSlots.Num(); }
+
+protected:
+	// Getting decal slot for tile, reusing hidden decals first
+	int32 AcquireSlot(const FIntVector& Key);
+
+	void UploadTile(int32 Slot, const TArray<float>& Depth);
+
+	UPROPERTY(Transient)
+	TArray<UDecalComponent*> Decals;
+
+	UPROPERTY(Transient)
+	TArray<UTexture2D*> Textures;
+
+	UPROPERTY(Transient)
+	TArray<UMaterialInstanceDynamic*> Materials;
+
+	TMap<FIntVector, int32> TileSlots;
+	TArray<int32> FreeSlots;
+};
@@ -0,0 +1,595 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "WaterWetnessField.h"
+#include "Async/ParallelFor.h"
+#include "Math/UnrealMathUtility.h"
+
+FWaterWetnessField::FWaterWetnessField()
+{
+	this->GroundUseCounter = 0;
+	this->TimeAccumulator = 0.0f;
+}
+
+void FWaterWetnessField::SetGroundRequest(FWaterWetnessGroundRequest InGroundRequest)
+{
+	this->GroundRequest = MoveTemp(InGroundRequest);
+}
+
+void FWaterWetnessField::SetGround(const FIntVector& Key, const TArray<float>& Heights)
+{
+	using namespace WaterWetnessConstants;
+
+	// Heights of tiles dropped meanwhile are not needed anymore
+	FWaterWetnessGround* Ground = this->GroundCache.Find(Key);
+	if ((Ground == nullptr) || (Heights.Num() != TileResolution * TileResolution))
+	{
+		return;
+	}
+
+	Ground->Heights = Heights;
+	Ground->bIsReady = true;
+
+	// Water of existing tile starts flowing over real floor
+	int32* Index = this->TileIndices.Find(Key);
+	if (Index != nullptr)
+	{
+		FWaterWetnessTile& Tile = this->Tiles[*Index];
+		Tile.Ground = Heights;
+		Tile.bIsAwake = true;
+		Tile.SettledSteps = 0;
+	}
+}
+
+FIntVector FWaterWetnessField::GetTileKey(int32 CellX, int32 CellY, float Z) const
+{
+	using namespace WaterWetnessConstants;
+
+	return FIntVector(FMath::FloorToInt(float(CellX) / TileResolution),
+					  FMath::FloorToInt(float(CellY) / TileResolution),
+					  FMath::FloorToInt(Z / LayerHeight));
+}
+
+const TArray<float>& FWaterWetnessField::GetGround(const FIntVector& Key, float FloorZ)
+{
+	using namespace WaterWetnessConstants;
+
+	FWaterWetnessGround* CachedGround = this->GroundCache.Find(Key);
+	if (CachedGround != nullptr)
+	{
+		CachedGround->LastUse = ++this->GroundUseCounter;
+		return CachedGround->Heights;
+	}
+
+	if (this->GroundCache.Num() >= MaxGroundCacheTiles)
+	{
+		EvictGround();
+	}
+
+	// Flat floor until traced heights arrive, or for good without request
+	FWaterWetnessGround& Ground = this->GroundCache.Add(Key);
+	Ground.Heights.Init(FloorZ, TileResolution * TileResolution);
+	Ground.bIsReady = !(this->GroundRequest);
+	Ground.LastUse = ++this->GroundUseCounter;
+
+	if (this->GroundRequest)
+	{
+		this->GroundRequest(Key, FloorZ);
+	}
+
+	return Ground.Heights;
+}
+
+void FWaterWetnessField::EvictGround()
+{
+	// Tiles with water copied their heights, but keeping them saves tracing again when they spill
+	const FIntVector* OldestKey = nullptr;
+	uint64 OldestUse = MAX_uint64;
+	for (const TPair<FIntVector, FWaterWetnessGround>& Entry : this->GroundCache)
+	{
+		if ((Entry.Value.LastUse < OldestUse) && !(this->TileIndices.Contains(Entry.Key)))
+		{
+			OldestKey = &Entry.Key;
+			OldestUse = Entry.Value.LastUse;
+		}
+	}
+
+	if (OldestKey != nullptr)
+	{
+		FIntVector Key = *OldestKey;
+		this->GroundCache.Remove(Key);
+	}
+}
+
+int32 FWaterWetnessField::FindOrAddTile(const FIntVector& Key, float FloorZ)
+{
+	using namespace WaterWetnessConstants;
+
+	int32* Index = this->TileIndices.Find(Key);
+	if (Index != nullptr)
+	{
+		return *Index;
+	}
+
+	FWaterWetnessTile Tile;
+	Tile.Key = Key;
+	Tile.FloorZ = FloorZ;
+	Tile.MaxDepth = 0.0f;
+	Tile.bIsDirty = true;
+	Tile.bIsAwake = false;
+	Tile.SettledSteps = 0;
+	Tile.bIsUpdated = false;
+	Tile.Depth.SetNumZeroed(TileResolution * TileResolution);
+	Tile.Ground = GetGround(Key, FloorZ);
+
+	for (int32 Direction = 0; Direction < NumDirections; ++Direction)
+	{
+		Tile.Neighbours[Direction] = INDEX_NONE;
+		Tile.Outflow[Direction].SetNumZeroed(TileResolution * TileResolution);
+	}
+
+	int32 NewIndex = this->Tiles.Add(MoveTemp(Tile));
+	this->TileIndices.Add(Key, NewIndex);
+
+	return NewIndex;
+}
+
+void FWaterWetnessField::RemoveTile(int32 Index)
+{
+	this->RemovedTiles.Add(this->Tiles[Index].Key);
+	this->TileIndices.Remove(this->Tiles[Index].Key);
+
+	this->Tiles.RemoveAtSwap(Index, 1, false);
+	if (this->Tiles.IsValidIndex(Index))
+	{
+		this->TileIndices[this->Tiles[Index].Key] = Index;
+	}
+}
+
+void FWaterWetnessField::AddWater(const FVector& Location, float Radius, float Volume)
+{
+	using namespace WaterWetnessConstants;
+
+	if (Volume <= 0.0f)
+	{
+		return;
+	}
+
+	Radius = FMath::Max(Radius, CellSize);
+
+	int32 MinX = FMath::FloorToInt((Location.X - Radius) / CellSize);
+	int32 MaxX = FMath::FloorToInt((Location.X + Radius) / CellSize);
+	int32 MinY = FMath::FloorToInt((Location.Y - Radius) / CellSize);
+	int32 MaxY = FMath::FloorToInt((Location.Y + Radius) / CellSize);
+
+	// Smooth bump, weights are normalized so whole volume lands in field
+	auto GetWeight = [&Location, Radius](int32 x, int32 y)
+	{
+		float CentreX = (x + 0.5f) * CellSize;
+		float CentreY = (y + 0.5f) * CellSize;
+		float Distance = FMath::Sqrt(FMath::Square(CentreX - Location.X) + FMath::Square(CentreY - Location.Y)) / Radius;
+
+		return (Distance < 1.0f) ? (0.5f + 0.5f * FMath::Cos(Distance * PI)) : 0.0f;
+	};
+
+	float WeightSum = 0.0f;
+	for (int32 y = MinY; y <= MaxY; ++y)
+	{
+		for (int32 x = MinX; x <= MaxX; ++x)
+		{
+			WeightSum += GetWeight(x, y);
+		}
+	}
+
+	if (WeightSum <= 0.0f)
+	{
+		return;
+	}
+
+	float DepthScale = Volume / (WeightSum * CellSize * CellSize);
+
+	for (int32 y = MinY; y <= MaxY; ++y)
+	{
+		for (int32 x = MinX; x <= MaxX; ++x)
+		{
+			float Weight = GetWeight(x, y);
+			if (Weight <= 0.0f)
+			{
+				continue;
+			}
+
+			FWaterWetnessTile& Tile = this->Tiles[FindOrAddTile(GetTileKey(x, y, Location.Z), Location.Z)];
+			int32 LocalX = x - Tile.Key.X * TileResolution;
+			int32 LocalY = y - Tile.Key.Y * TileResolution;
+
+			float& Depth = Tile.Depth[LocalY * TileResolution + LocalX];
+			Depth += Weight * DepthScale;
+
+			Tile.MaxDepth = FMath::Max(Tile.MaxDepth, Depth);
+			Tile.bIsDirty = true;
+			Tile.bIsAwake = true;
+			Tile.SettledSteps = 0;
+		}
+	}
+}
+
+void FWaterWetnessField::Step(float DeltaTime, bool bForceSingleThread)
+{
+	using namespace WaterWetnessConstants;
+
+	this->TimeAccumulator += FMath::Max(DeltaTime, 0.0f);
+
+	int32 NumSubsteps = FMath::Min(FMath::FloorToInt(this->TimeAccumulator / FlowStep), MaxFlowSubsteps);
+	this->TimeAccumulator = FMath::Min(this->TimeAccumulator - NumSubsteps * FlowStep, FlowStep);
+
+	for (int32 Substep = 0; Substep < NumSubsteps; ++Substep)
+	{
+		SpreadIntoNeighbours();
+		GatherFlowTiles();
+
+		if (this->ActiveTiles.Num() == 0)
+		{
+			break;
+		}
+
+		// Tiles only write to themselves and read neighbours, so both stages run tile parallel
+		ParallelFor(this->ActiveTiles.Num(), [this](int32 i)
+		{
+			StepOutflow(this->Tiles[this->ActiveTiles[i]]);
+		}, bForceSingleThread);
+
+		ParallelFor(this->UpdatedTiles.Num(), [this](int32 i)
+		{
+			StepDepth(this->Tiles[this->UpdatedTiles[i]]);
+		}, bForceSingleThread);
+
+		// Sending settled tiles to sleep, their flow stops
+		for (int32 Index : this->ActiveTiles)
+		{
+			FWaterWetnessTile& Tile = this->Tiles[Index];
+			if (Tile.SettledSteps >= SleepSteps)
+			{
+				Tile.bIsAwake = false;
+				for (int32 Direction = 0; Direction < NumDirections; ++Direction)
+				{
+					FMemory::Memzero(Tile.Outflow[Direction].GetData(), Tile.Outflow[Direction].Num() * sizeof(float));
+				}
+			}
+		}
+	}
+}
+
+void FWaterWetnessField::SpreadIntoNeighbours()
+{
+	using namespace WaterWetnessConstants;
+
+	// New tiles go to end of array, they have no water yet
+	int32 NumTiles = this->Tiles.Num();
+	for (int32 t = 0; t < NumTiles; ++t)
+	{
+		if (!(this->Tiles[t].bIsAwake))
+		{
+			continue;
+		}
+
+		for (int32 Direction = 0; Direction < NumDirections; ++Direction)
+		{
+			FIntVector NeighbourKey = this->Tiles[t].Key + FIntVector(DirectionX[Direction], DirectionY[Direction], 0);
+			if (this->TileIndices.Contains(NeighbourKey))
+			{
+				continue;
+			}
+
+			// Checking edge cells against floor across edge
+			const FWaterWetnessTile& Tile = this->Tiles[t];
+			const TArray<float>& NeighbourGround = GetGround(NeighbourKey, Tile.FloorZ);
+
+			bool bIsSpilling = false;
+			for (int32 k = 0; (k < TileResolution) && !bIsSpilling; ++k)
+			{
+				int32 x = (DirectionX[Direction] < 0) ? 0 : ((DirectionX[Direction] > 0) ? (TileResolution - 1) : k);
+				int32 y = (DirectionY[Direction] < 0) ? 0 : ((DirectionY[Direction] > 0) ? (TileResolution - 1) : k);
+				int32 NeighbourX = x - DirectionX[Direction] * (TileResolution - 1);
+				int32 NeighbourY = y - DirectionY[Direction] * (TileResolution - 1);
+
+				int32 i = y * TileResolution + x;
+				bIsSpilling = (Tile.Depth[i] > MinFlowDepth) && (Tile.Ground[i] + Tile.Depth[i] > NeighbourGround[NeighbourY * TileResolution + NeighbourX]);
+			}
+
+			if (bIsSpilling)
+			{
+				FindOrAddTile(NeighbourKey, Tile.FloorZ);
+			}
+		}
+	}
+}
+
+void FWaterWetnessField::GatherFlowTiles()
+{
+	using namespace WaterWetnessConstants;
+
+	this->ActiveTiles.Reset();
+	this->UpdatedTiles.Reset();
+
+	for (int32 t = 0; t < this->Tiles.Num(); ++t)
+	{
+		FWaterWetnessTile& Tile = this->Tiles[t];
+		Tile.bIsUpdated = Tile.bIsAwake;
+		if (Tile.bIsAwake)
+		{
+			this->ActiveTiles.Add(t);
+			this->UpdatedTiles.Add(t);
+		}
+	}
+
+	// Sleeping neighbours take inflow of awake tiles
+	for (int32 t : this->ActiveTiles)
+	{
+		for (int32 Direction = 0; Direction < NumDirections; ++Direction)
+		{
+			int32* Neighbour = this->TileIndices.Find(this->Tiles[t].Key + FIntVector(DirectionX[Direction], DirectionY[Direction], 0));
+			if ((Neighbour != nullptr) && !(this->Tiles[*Neighbour].bIsUpdated))
+			{
+				this->Tiles[*Neighbour].bIsUpdated = true;
+				this->UpdatedTiles.Add(*Neighbour);
+			}
+		}
+	}
+
+	for (int32 t : this->UpdatedTiles)
+	{
+		FWaterWetnessTile& Tile = this->Tiles[t];
+		for (int32 Direction = 0; Direction < NumDirections; ++Direction)
+		{
+			int32* Neighbour = this->TileIndices.Find(Tile.Key + FIntVector(DirectionX[Direction], DirectionY[Direction], 0));
+			Tile.Neighbours[Direction] = (Neighbour != nullptr) ? *Neighbour : INDEX_NONE;
+		}
+	}
+}
+
+bool FWaterWetnessField::GetNeighbourSurface(const FWaterWetnessTile& Tile, int32 x, int32 y, int32 Direction, float& OutSurface) const
+{
+	using namespace WaterWetnessConstants;
+
+	int32 NeighbourX = x + DirectionX[Direction];
+	int32 NeighbourY = y + DirectionY[Direction];
+	const FWaterWetnessTile* Other = &Tile;
+
+	if ((NeighbourX < 0) || (NeighbourX >= TileResolution) || (NeighbourY < 0) || (NeighbourY >= TileResolution))
+	{
+		if (Tile.Neighbours[Direction] == INDEX_NONE)
+		{
+			return false;
+		}
+
+		Other = &this->Tiles[Tile.Neighbours[Direction]];
+		NeighbourX = (NeighbourX + TileResolution) % TileResolution;
+		NeighbourY = (NeighbourY + TileResolution) % TileResolution;
+	}
+
+	int32 i = NeighbourY * TileResolution + NeighbourX;
+	OutSurface = Other->Ground[i] + Other->Depth[i];
+
+	return true;
+}
+
+float FWaterWetnessField::GetNeighbourInflow(const FWaterWetnessTile& Tile, int32 x, int32 y, int32 Direction) const
+{
+	using namespace WaterWetnessConstants;
+
+	int32 NeighbourX = x + DirectionX[Direction];
+	int32 NeighbourY = y + DirectionY[Direction];
+	const FWaterWetnessTile* Other = &Tile;
+
+	if ((NeighbourX < 0) || (NeighbourX >= TileResolution) || (NeighbourY < 0) || (NeighbourY >= TileResolution))
+	{
+		if (Tile.Neighbours[Direction] == INDEX_NONE)
+		{
+			return 0.0f;
+		}
+
+		Other = &this->Tiles[Tile.Neighbours[Direction]];
+		NeighbourX = (NeighbourX + TileResolution) % TileResolution;
+		NeighbourY = (NeighbourY + TileResolution) % TileResolution;
+	}
+
+	return Other->Outflow[Direction ^ 1][NeighbourY * TileResolution + NeighbourX];
+}
+
+void FWaterWetnessField::StepOutflow(FWaterWetnessTile& Tile) const
+{
+	using namespace WaterWetnessConstants;
+
+	// Pipe of cell cross-section and cell length between cell centres
+	const float CellArea = CellSize * CellSize;
+	const float PipeCoefficient = Gravity * CellArea / CellSize;
+
+	for (int32 y = 0; y < TileResolution; ++y)
+	{
+		for (int32 x = 0; x < TileResolution; ++x)
+		{
+			int32 i = y * TileResolution + x;
+
+			// Film under min flow depth stays in place
+			float Available = (Tile.Depth[i] - MinFlowDepth) * CellArea;
+			if (Available <= 0.0f)
+			{
+				for (int32 Direction = 0; Direction < NumDirections; ++Direction)
+				{
+					Tile.Outflow[Direction][i] = 0.0f;
+				}
+				continue;
+			}
+
+			// Accelerating flow by surface height difference, cells without tile act as walls
+			float Surface = Tile.Ground[i] + Tile.Depth[i];
+			float TotalOutflow = 0.0f;
+			for (int32 Direction = 0; Direction < NumDirections; ++Direction)
+			{
+				float NeighbourSurface = 0.0f;
+				float Flow = 0.0f;
+				if (GetNeighbourSurface(Tile, x, y, Direction, NeighbourSurface))
+				{
+					Flow = FMath::Max(Tile.Outflow[Direction][i] * FlowDamping + FlowStep * PipeCoefficient * (Surface - NeighbourSurface), 0.0f);
+				}
+
+				Tile.Outflow[Direction][i] = Flow;
+				TotalOutflow += Flow;
+			}
+
+			// Never draining more than cell holds
+			if (TotalOutflow * FlowStep > Available)
+			{
+				float Scale = Available / (TotalOutflow * FlowStep);
+				for (int32 Direction = 0; Direction < NumDirections; ++Direction)
+				{
+					Tile.Outflow[Direction][i] *= Scale;
+				}
+			}
+		}
+	}
+}
+
+void FWaterWetnessField::StepDepth(FWaterWetnessTile& Tile) const
+{
+	using namespace WaterWetnessConstants;
+
+	const float CellArea = CellSize * CellSize;
+
+	float MaxChange = 0.0f;
+	float MaxDepth = 0.0f;
+	for (int32 y = 0; y < TileResolution; ++y)
+	{
+		for (int32 x = 0; x < TileResolution; ++x)
+		{
+			int32 i = y * TileResolution + x;
+
+			float Flow = 0.0f;
+			for (int32 Direction = 0; Direction < NumDirections; ++Direction)
+			{
+				Flow += GetNeighbourInflow(Tile, x, y, Direction) - Tile.Outflow[Direction][i];
+			}
+
+			float Change = FlowStep * Flow / CellArea;
+			Tile.Depth[i] = FMath::Max(Tile.Depth[i] + Change, 0.0f);
+
+			MaxChange = FMath::Max(MaxChange, FMath::Abs(Change));
+			MaxDepth = FMath::Max(MaxDepth, Tile.Depth[i]);
+		}
+	}
+
+	Tile.MaxDepth = MaxDepth;
+	Tile.bIsDirty |= (MaxChange > 0.0f);
+
+	// Waking on inflow, going to sleep once water has settled for a while
+	if (MaxChange >= SleepThreshold)
+	{
+		Tile.bIsAwake = true;
+		Tile.SettledSteps = 0;
+	}
+	else
+	{
+		++Tile.SettledSteps;
+	}
+}
+
+void FWaterWetnessField::Evaporate(float DeltaTime, float Rate)
+{
+	float Amount = FMath::Max(DeltaTime * Rate, 0.0f);
+	if (Amount <= 0.0f)
+	{
+		return;
+	}
+
+	for (int32 i = this->Tiles.Num() - 1; i >= 0; --i)
+	{
+		FWaterWetnessTile& Tile = this->Tiles[i];
+
+		// Texture only needs upload once a cell shows different wetness
+		float MaxDepth = 0.0f;
+		bool bHasChanged = false;
+		for (float& Depth : Tile.Depth)
+		{
+			uint8 OldValue = QuantizeDepth(Depth);
+			Depth = FMath::Max(Depth - Amount, 0.0f);
+			MaxDepth = FMath::Max(MaxDepth, Depth);
+			bHasChanged |= (QuantizeDepth(Depth) != OldValue);
+		}
+
+		Tile.MaxDepth = MaxDepth;
+		Tile.bIsDirty |= bHasChanged;
+
+		if (MaxDepth <= 0.0f)
+		{
+			RemoveTile(i);
+		}
+	}
+}
+
+float FWaterWetnessField::GetDepth(const FVector& Location) const
+{
+	using namespace WaterWetnessConstants;
+
+	int32 CellX = FMath::FloorToInt(Location.X / CellSize);
+	int32 CellY = FMath::FloorToInt(Location.Y / CellSize);
+	FIntVector Key = GetTileKey(CellX, CellY, Location.Z);
+
+	const int32* Index = this->TileIndices.Find(Key);
+	if (Index == nullptr)
+	{
+		return 0.0f;
+	}
+
+	int32 LocalX = CellX - Key.X * TileResolution;
+	int32 LocalY = CellY - Key.Y * TileResolution;
+
+	return this->Tiles[*Index].Depth[LocalY * TileResolution + LocalX];
+}
+
+float FWaterWetnessField::GetVolume() const
+{
+	using namespace WaterWetnessConstants;
+
+	float Volume = 0.0f;
+	for (const FWaterWetnessTile& Tile : this->Tiles)
+	{
+		for (float Depth : Tile.Depth)
+		{
+			Volume += Depth;
+		}
+	}
+
+	return Volume * CellSize * CellSize;
+}
+
+FVector FWaterWetnessField::GetTileOrigin(const FWaterWetnessTile& Tile)
+{
+	using namespace WaterWetnessConstants;
+
+	return FVector(Tile.Key.X * TileSize, Tile.Key.Y * TileSize, Tile.FloorZ);
+}
+
+void FWaterWetnessField::ConsumeRemovedTiles(TArray<FIntVector>& OutKeys)
+{
+	OutKeys = MoveTemp(this->RemovedTiles);
+	this->RemovedTiles.Reset();
+}
+
+void FWaterWetnessField::ClearDirtyFlags()
+{
+	for (FWaterWetnessTile& Tile : this->Tiles)
+	{
+		Tile.bIsDirty = false;
+	}
+}
+
+void FWaterWetnessField::Reset()
+{
+	this->Tiles.Reset();
+	this->TileIndices.Reset();
+	this->RemovedTiles.Reset();
+	this->GroundCache.Reset();
+	this->GroundUseCounter = 0;
+	this->ActiveTiles.Reset();
+	this->UpdatedTiles.Reset();
+	this->TimeAccumulator = 0.0f;
+}
@@ -0,0 +1,190 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+namespace WaterWetnessConstants
+{
+	// Cells per tile edge
+	const int32 TileResolution = 32;
+
+	// Cell edge in world units
+	const float CellSize = 10.0f;
+
+	const float TileSize = TileResolution * CellSize;
+
+	// Floors closer than this in height share tiles
+	const float LayerHeight = 200.0f;
+
+	// Tiles whose floor heights are kept, least recently used ones without water are dropped
+	const int32 MaxGroundCacheTiles = 1024;
+
+	// Water depth (cm) shown as fully wet
+	const float FullDepth = 0.5f;
+
+	// Radius (cm) spilled volume lands on before it flows
+	const float SpillRadius = 30.0f;
+
+	// Fixed flow step, frames run at most MaxFlowSubsteps of them
+	const float FlowStep = 1.0f / 60.0f;
+	const int32 MaxFlowSubsteps = 4;
+
+	const float Gravity = 980.0f;
+
+	// Share of pipe flow kept per step, lower values settle water faster
+	const float FlowDamping = 0.98f;
+
+	// Water thinner than this (cm) sticks to floor and does not flow
+	const float MinFlowDepth = 0.2f;
+
+	// Tiles whose depth changed less than this (cm) for SleepSteps steps stop flowing
+	const float SleepThreshold = 0.001f;
+	const int32 SleepSteps = 30;
+
+	// Neighbour directions of tiles and cells, opposite direction is (Direction ^ 1)
+	const int32 NumDirections = 4;
+	const int32 DirectionX[NumDirections] = { -1, 1, 0, 0 };
+	const int32 DirectionY[NumDirections] = { 0, 0, -1, 1 };
+}
+
+// One tile of wetness field, values per cell stored row by row along world Y
+struct FWaterWetnessTile
+{
+	FIntVector Key;
+	float FloorZ;
+	float MaxDepth;
+	bool bIsDirty;
+
+	// Flowing tiles are stepped, settled ones only take inflow from flowing neighbours
+	bool bIsAwake;
+	int32 SettledSteps;
+
+	// Set while tile is part of current flow step
+	bool bIsUpdated;
+
+	// Tiles in each direction, refreshed every flow step
+	int32 Neighbours[WaterWetnessConstants::NumDirections];
+
+	// Water depth in cm
+	TArray<float> Depth;
+
+	// Floor height copied from ground cache (flat at floor Z until traced)
+	TArray<float> Ground;
+
+	// Flow out of cell in each direction, in cm^3/s
+	TArray<float> Outflow[WaterWetnessConstants::NumDirections];
+};
+
+// Floor heights of one tile in ground cache
+struct FWaterWetnessGround
+{
+	TArray<float> Heights;
+
+	// Heights stay flat at floor Z until traced ones arrive
+	bool bIsReady;
+
+	// Value of use counter when tile was last needed
+	uint64 LastUse;
+};
+
+// Asks for floor height of every cell of tile (TileResolution^2 values) around floor Z, answered later through SetGround
+typedef TFunction<void(const FIntVector& Key, float FloorZ)> FWaterWetnessGroundRequest;
+
+// Sparse field of water depth over floors, used instead of puddle actors in wetness mode.
+// Space is split into square tiles per floor layer, and only tiles that got water exist. Water
+// is added as volume and flows downhill over floor heights traced once per tile and cached,
+// using virtual pipes between neighbouring cells. Traces are asynchronous, so a tile is flat until
+// its heights arrive, and least recently used heights are dropped once the cache is full. Tiles go to sleep once their water settles,
+// and evaporation removes tiles once they are dry, so cost follows flowing and wet area.
+class FACILITY_API FWaterWetnessField
+{
+public:
+	FWaterWetnessField();
+
+	// Setting floor height request, tiles without one keep flat floor at their floor Z
+	void SetGroundRequest(FWaterWetnessGroundRequest InGroundRequest);
+
+	// Storing traced floor heights of tile, tile flows over them from next step
+	void SetGround(const FIntVector& Key, const TArray<float>& Heights);
+
+	// Spreading volume (cm^3) over disc of radius around location, deepest at centre
+	void AddWater(const FVector& Location, float Radius, float Volume);
+
+	// Flowing water of awake tiles in fixed steps, tiles are added where water runs over edges
+	void Step(float DeltaTime, bool bForceSingleThread = false);
+
+	// Lowering depth of all cells by rate (cm/s), dropping tiles that dried
+	void Evaporate(float DeltaTime, float Rate);
+
+	// Getting water depth at location, 0 if dry
+	float GetDepth(const FVector& Location) const;
+
+	// Getting total water volume in cm^3
+	float GetVolume() const;
+
+	int32 GetNumTiles() const { return this->Tiles.Num(); }
+
+	int32 GetNumAwakeTiles() const { return this->ActiveTiles.Num(); }
+
+	const FWaterWetnessTile& GetTile(int32 Index) const { return this->Tiles[Index]; }
+
+	// Getting world location of tile corner with smallest X and Y, on its floor
+	static FVector GetTileOrigin(const FWaterWetnessTile& Tile);
+
+	// Getting wetness shown for depth, 0 dry to 255 fully wet
+	static uint8 QuantizeDepth(float Depth) { return uint8(FMath::Clamp(Depth / WaterWetnessConstants::FullDepth, 0.0f, 1.0f) * 255.0f); }
+
+	// Keys of tiles dropped since last call
+	void ConsumeRemovedTiles(TArray<FIntVector>& OutKeys);
+
+	void ClearDirtyFlags();
+
+	void Reset();
+
+protected:
+	FIntVector GetTileKey(int32 CellX, int32 CellY, float Z) const;
+
+	// Getting cached floor heights of tile, requesting them on first use
+	const TArray<float>& GetGround(const FIntVector& Key, float FloorZ);
+
+	// Dropping least recently used floor heights of tiles without water
+	void EvictGround();
+
+	// Returns index of tile, tile array may grow
+	int32 FindOrAddTile(const FIntVector& Key, float FloorZ);
+
+	void RemoveTile(int32 Index);
+
+	// Adding tiles water of awake tiles is about to run into
+	void SpreadIntoNeighbours();
+
+	// Collecting awake tiles and their neighbours for one flow step
+	void GatherFlowTiles();
+
+	// Getting surface height of neighbour cell, false if there is no tile
+	bool GetNeighbourSurface(const FWaterWetnessTile& Tile, int32 x, int32 y, int32 Direction, float& OutSurface) const;
+
+	// Getting flow from neighbour cell back into cell
+	float GetNeighbourInflow(const FWaterWetnessTile& Tile, int32 x, int32 y, int32 Direction) const;
+
+	// Flow stages, each writes only to its own tile
+	void StepOutflow(FWaterWetnessTile& Tile) const;
+	void StepDepth(FWaterWetnessTile& Tile) const;
+
+	TArray<FWaterWetnessTile> Tiles;
+	TMap<FIntVector, int32> TileIndices;
+	TArray<FIntVector> RemovedTiles;
+
+	// Floor heights of tiles water reached lately
+	TMap<FIntVector, FWaterWetnessGround> GroundCache;
+	FWaterWetnessGroundRequest GroundRequest;
+	uint64 GroundUseCounter;
+
+	// Tiles of current flow step (reused every step)
+	TArray<int32> ActiveTiles;
+	TArray<int32> UpdatedTiles;
+
+	// Time not yet consumed by fixed flow steps
+	float TimeAccumulator;
+};
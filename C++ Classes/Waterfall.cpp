@@ -17,6 +17,10 @@
 // Assets
 #include "WaterTank.h"
 #include "WaterPuddle.h"
+#include "WaterActorPoolSubsystem.h"
+#include "WaterSimulationSubsystem.h"
+
+const FName AWaterfall::CollisionBoxTag(TEXT("WaterfallCollisionBox"));
 
 // Sets default values
 AWaterfall::AWaterfall()
@@ -30,6 +34,16 @@ AWaterfall::AWaterfall()
 	// Setting collision flag
 	this->bHasBeenCollision = false;
 
+	// Setting reported visibility flag
+	this->bIsWaterfallVisibleReported = true;
+
+	// Setting simulation slot
+	this->SimulationIndex = INDEX_NONE;
+
+	// Setting hole proxy state
+	this->bIsHoleProxy = false;
+	this->HoleIndex = INDEX_NONE;
+
 	// Creating waterfall PS component
 	this->WaterfallParticleSystemComponent = CreateDefaultSubobject<UParticleSystemComponent>(TEXT("WaterfallParticleSystem"));
 	RootComponent = this->WaterfallParticleSystemComponent;
@@ -39,11 +53,18 @@ AWaterfall::AWaterfall()
 	this->WaterfallCollisionBoxComponent = CreateDefaultSubobject<UBoxComponent>(TEXT("WaterfallCollisionBox"));
 	this->WaterfallCollisionBoxComponent->AttachToComponent(this->WaterfallParticleSystemComponent, FAttachmentTransformRules::KeepRelativeTransform);
 	this->WaterfallCollisionBoxComponent->SetRelativeScale3D(FVector(1.0f, 1.0f, 0.25f));
+	this->WaterfallCollisionBoxComponent->ComponentTags.Add(CollisionBoxTag);
+	this->WaterfallCollisionBoxComponent->OnComponentBeginOverlap.AddDynamic(this, &AWaterfall::OnWaterPuddleBeginOverlap);
+	this->WaterfallCollisionBoxComponent->OnComponentEndOverlap.AddDynamic(this, &AWaterfall::OnWaterPuddleEndOverlap);
 
 	// Setting default params
 	this->WaterPuddleInitialScale = FVector(0.2f, 0.2f, 0.2f);
+	this->WaterPuddleMergeRadius = 100.0f;
+	this->WetnessRadius = 40.0f;
 	this->WaterfallMaxAngle = 60.0f;
 	this->PSAccel = FVector(0.0f, 0.0f, -30000.0f);
+	this->HoleRadius = 0.5f;
+	this->PendingOutflowVolume = 0.0f;
 	this->WorldNormalZ = FVector(0.0f, 0.0f, 1.0f);
 }
 
@@ -57,6 +78,56 @@ void AWaterfall::BeginPlay()
 
 	// Spawning waterfall sound
 	this->WaterfallSoundComponent = UGameplayStatics::SpawnSoundAttached(this->WaterfallSound, this->WaterfallParticleSystemComponent);
+
+	// Setting initial visibility, puddles may have started listening before BeginPlay
+	bool bIsVisible = this->WaterfallParticleSystemComponent->IsVisible();
+	if (this->bIsWaterfallVisibleReported != bIsVisible)
+	{
+		this->bIsWaterfallVisibleReported = bIsVisible;
+		this->OnWaterfallVisibilityChanged.Broadcast(this, bIsVisible);
+	}
+
+	// Pooled waterfalls do nothing until handed out
+	if (UWaterActorPoolSubsystem::IsActorPooled(this))
+	{
+		SetActorTickEnabled(false);
+		return;
+	}
+
+	// Handing per frame update over to water simulation
+	UWorld* const World = GetWorld();
+	if (World != nullptr)
+	{
+		UWaterSimulationSubsystem* WaterSimulation = World->GetSubsystem<UWaterSimulationSubsystem>();
+		if (WaterSimulation != nullptr)
+		{
+			WaterSimulation->RegisterWaterfall(this);
+			SetActorTickEnabled(false);
+		}
+	}
+}
+
+void AWaterfall::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// Leaving water tank registry
+	if (this->RegisteredWaterTank.IsValid())
+	{
+		this->RegisteredWaterTank->UnregisterWaterfall(this);
+	}
+	this->RegisteredWaterTank = nullptr;
+
+	// Leaving water simulation
+	UWorld* const World = GetWorld();
+	if (World != nullptr)
+	{
+		UWaterSimulationSubsystem* WaterSimulation = World->GetSubsystem<UWaterSimulationSubsystem>();
+		if (WaterSimulation != nullptr)
+		{
+			WaterSimulation->UnregisterWaterfall(this);
+		}
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 // Called every frame
@@ -64,29 +135,58 @@ void AWaterfall::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
+	// Updating components and puddle detection
+	UpdateWaterfallComponents(DeltaTime);
+
+	// Managing waterfall depending on angle, plane position and fill height
+	UpdateWaterfallVisibility();
+
+	// After setting flag we should adjust waterfall acceleration and visibility
+	SetPSAccelAtRuntime();
+}
+
+void AWaterfall::UpdateWaterfallComponents(float DeltaTime)
+{
+	// Registering in water tank we are attached to
+	UpdateWaterTankRegistration();
+
 	// Calling sound managing function
 	SoundManaging();
 
 	// Setting location of puddle detector
 	this->WaterfallCollisionBoxComponent->SetWorldLocation(this->CollideLocation);
 
-	// Spawning water puddle
-	SpawnWaterPuddle();
+	// Spawning water puddle, or wetting floor when puddle actors are replaced by wetness field
+	if (UWaterSimulationSubsystem::IsWetnessModeEnabled())
+	{
+		WetFloor();
+	}
+	else
+	{
+		SpawnWaterPuddle(DeltaTime);
+	}
 
 	// Setting water puddle flag
 	SetWaterPuddleFlag();
 
-	// Managing waterfall depenging on angle between actor and Z normal
-	ManageWaterfallDependingOnAngle();
-
-	// Managing waterfall depending on plane position in water tank
-	ManageWaterfallDependingOnPlanePosition();
-
-	// Managing waterfall depending on fill height in water tank
-	ManageWaterfallDependingOnFillHeight();
+	// Handing drained volume to puddle under waterfall
+	if ((this->PendingOutflowVolume > 0.0f) && this->DetectedWaterPuddle.IsValid())
+	{
+		this->DetectedWaterPuddle->AddLiquidVolume(this->PendingOutflowVolume);
+		this->PendingOutflowVolume = 0.0f;
+	}
+}
 
-	// After setting flag we should adjust waterfall acceleration and visibility
-	SetPSAccelAtRuntime();
+void AWaterfall::UpdateWaterfallVisibility()
+{
+	AWaterTank* AttachParentActor = this->RegisteredWaterTank.Get();
+
+	this->bIsWaterfallVisible = ComputeWaterfallVisibility(GetActorForwardVector(),
+														   this->WaterfallMaxAngle,
+														   GetActorLocation().Z,
+														   AttachParentActor != nullptr,
+														   (AttachParentActor != nullptr) ? AttachParentActor->PlanePosition.Z : 0.0f,
+														   (AttachParentActor != nullptr) ? AttachParentActor->FillHeight : 0.0f);
 }
 
 void AWaterfall::OnPSCollide(FName EventName, float EmitterTime, int32 ParticleTime, FVector Location, FVector Velocity, FVector Direction, FVector Normal, FName BoneName, UPhysicalMaterial* PhysMat)
@@ -101,6 +201,41 @@ void AWaterfall::OnPSCollide(FName EventName, float EmitterTime, int32 ParticleT
 	this->CollideNormal = Normal;
 }
 
+void AWaterfall::UpdateWaterTankRegistration()
+{
+	// Attachment is done after spawn, so parent is checked here (pointer compare only)
+	AActor* AttachParentActor = GetAttachParentActor();
+	if (AttachParentActor == this->RegisteredWaterTank.Get())
+	{
+		return;
+	}
+
+	if (this->RegisteredWaterTank.IsValid())
+	{
+		this->RegisteredWaterTank->UnregisterWaterfall(this);
+	}
+
+	AWaterTank* NewWaterTank = Cast<AWaterTank>(AttachParentActor);
+	this->RegisteredWaterTank = NewWaterTank;
+
+	if (NewWaterTank != nullptr)
+	{
+		NewWaterTank->RegisterWaterfall(this);
+	}
+}
+
+void AWaterfall::SetWaterfallVisibility(bool bNewVisibility)
+{
+	this->WaterfallParticleSystemComponent->SetVisibility(bNewVisibility);
+
+	// Notifying listeners only on change
+	if (this->bIsWaterfallVisibleReported != bNewVisibility)
+	{
+		this->bIsWaterfallVisibleReported = bNewVisibility;
+		this->OnWaterfallVisibilityChanged.Broadcast(this, bNewVisibility);
+	}
+}
+
 void AWaterfall::SoundManaging()
 {
 	// Turning sound on or off depending on PS visibility
@@ -120,7 +255,7 @@ void AWaterfall::SoundManaging()
 	}
 }
 
-void AWaterfall::SpawnWaterPuddle()
+void AWaterfall::SpawnWaterPuddle(float DeltaTime)
 {
 	if (!(this->bIsWaterPuddleDetected))
 	{
@@ -129,18 +264,48 @@ void AWaterfall::SpawnWaterPuddle()
 			if (this->bHasBeenCollision)
 			{
 				UWorld* const World = GetWorld();
-				if (World != nullptr)
+
+				// Growing puddle lying next to impact (its overlap may not be reported yet, or its box may
+				// never reach detector) by this frame of inflow, same closed form growth as under waterfall
+				UWaterSimulationSubsystem* WaterSimulation = (World != nullptr) ? World->GetSubsystem<UWaterSimulationSubsystem>() : nullptr;
+				AWaterPuddle* NearbyWaterPuddle = (WaterSimulation != nullptr) ? WaterSimulation->GetPuddleSpatialHash().FindClosest(this->CollideLocation, this->WaterPuddleMergeRadius) : nullptr;
+				if (NearbyWaterPuddle != nullptr)
+				{
+					NearbyWaterPuddle->GrowWaterPuddle(DeltaTime);
+					return;
+				}
+
+				UWaterActorPoolSubsystem* ActorPool = (World != nullptr) ? World->GetSubsystem<UWaterActorPoolSubsystem>() : nullptr;
+				if (ActorPool != nullptr)
 				{
-					// Spawning water puddle if none were detected
-					FActorSpawnParameters SpawnParams;
-					AWaterPuddle* SpawnedWaterPuddle = World->SpawnActor<AWaterPuddle>(this->WaterPuddleToSpawn, this->CollideLocation, FRotator::ZeroRotator, SpawnParams);
-					SpawnedWaterPuddle->SetActorScale3D(this->WaterPuddleInitialScale);
+					// Getting water puddle from pool if none were detected
+					AWaterPuddle* SpawnedWaterPuddle = ActorPool->Acquire<AWaterPuddle>(this->WaterPuddleToSpawn, FTransform(this->CollideLocation));
+					if (SpawnedWaterPuddle != nullptr)
+					{
+						SpawnedWaterPuddle->SetActorScale3D(this->WaterPuddleInitialScale);
+					}
 				}
 			}
 		}
 	}
 }
 
+void AWaterfall::WetFloor()
+{
+	if (!(this->WaterfallParticleSystemComponent->IsVisible()) || !(this->bHasBeenCollision) || (this->PendingOutflowVolume <= 0.0f))
+	{
+		return;
+	}
+
+	UWorld* const World = GetWorld();
+	UWaterSimulationSubsystem* WaterSimulation = (World != nullptr) ? World->GetSubsystem<UWaterSimulationSubsystem>() : nullptr;
+	if (WaterSimulation != nullptr)
+	{
+		WaterSimulation->GetWetnessField().AddWater(this->CollideLocation, this->WetnessRadius, this->PendingOutflowVolume);
+		this->PendingOutflowVolume = 0.0f;
+	}
+}
+
 float AWaterfall::GetAngleBetweenVectorsD(FVector A, FVector B)
 {
 	// Normalizing vectors
@@ -161,100 +326,124 @@ float AWaterfall::GetAngleBetweenVectorsD(FVector A, FVector B)
 
 void AWaterfall::SetWaterPuddleFlag()
 {
-	// Setting counters
-	this->WaterPuddleActorCount = 0;
-	this->WaterPuddleCompCount = 0;
-
-	// Setting array with overlapping actors
-	TArray<AActor*> OverlappingActorsArray;
-	GetOverlappingActors(OverlappingActorsArray);
-	int64 LenOAA = OverlappingActorsArray.Num();
-
-	// Detecting water puddle actors
-	for (int64 i = 0; i < LenOAA; ++i)
+	// Overlap events keep puddle set up to date, picking another receiver of drained volume
+	// only once current one stops overlapping
+	if (!(this->DetectedWaterPuddle.IsValid()) || !(this->OverlappingWaterPuddles.Contains(this->DetectedWaterPuddle)))
 	{
-		// Getting water puddle actor
-		AWaterPuddle* WaterPuddleActor = Cast<AWaterPuddle>(OverlappingActorsArray[i]);
-		if (WaterPuddleActor != nullptr)
+		this->DetectedWaterPuddle = nullptr;
+		for (TMap<TWeakObjectPtr<AWaterPuddle>, int32>::TIterator It = this->OverlappingWaterPuddles.CreateIterator(); It; ++It)
 		{
-			++this->WaterPuddleActorCount;
+			if (!(It.Key().IsValid()))
+			{
+				It.RemoveCurrent();
+				continue;
+			}
+
+			this->DetectedWaterPuddle = It.Key();
+			break;
 		}
 	}
 
-	// Setting water puddle flag
-	if (this->WaterPuddleActorCount > 0)
-	{
-		// Setting array with overlapping components
-		TArray<UPrimitiveComponent*> OverlappingComponentsArray;
-		GetOverlappingComponents(OverlappingComponentsArray);
-		int64 LenOCA = OverlappingComponentsArray.Num();
+	this->bIsWaterPuddleDetected = this->DetectedWaterPuddle.IsValid();
+}
 
-		// Detecting water puddle components
-		for (int64 i = 0; i < LenOCA; ++i)
-		{
-			// Getting water puddle component
-			UBoxComponent* WaterPuddleCollisionComponent = Cast<UBoxComponent>(OverlappingComponentsArray[i]);
-			if ((WaterPuddleCollisionComponent != nullptr) && (WaterPuddleCollisionComponent->GetName() == "WaterPuddleCollisionBox"))
-			{
-				++this->WaterPuddleCompCount;
-			}
-		}
+void AWaterfall::OnWaterPuddleBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+{
+	AWaterPuddle* WaterPuddleActor = Cast<AWaterPuddle>(OtherActor);
+	if ((WaterPuddleActor != nullptr) && (OtherComp != nullptr) && OtherComp->ComponentHasTag(AWaterPuddle::CollisionBoxTag))
+	{
+		++this->OverlappingWaterPuddles.FindOrAdd(WaterPuddleActor);
+	}
+}
 
-		if (this->WaterPuddleCompCount > 0)
-		{
-			this->bIsWaterPuddleDetected = true;
-		}
-		else
+void AWaterfall::OnWaterPuddleEndOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
+{
+	AWaterPuddle* WaterPuddleActor = Cast<AWaterPuddle>(OtherActor);
+	if ((WaterPuddleActor != nullptr) && (OtherComp != nullptr) && OtherComp->ComponentHasTag(AWaterPuddle::CollisionBoxTag))
+	{
+		int32* Count = this->OverlappingWaterPuddles.Find(WaterPuddleActor);
+		if ((Count != nullptr) && (--(*Count) <= 0))
 		{
-			this->bIsWaterPuddleDetected = false;
+			this->OverlappingWaterPuddles.Remove(WaterPuddleActor);
 		}
 	}
-	else
-	{
-		this->bIsWaterPuddleDetected = false;
-	}
 }
 
-void AWaterfall::ManageWaterfallDependingOnAngle()
+void AWaterfall::OnReleasedToPool()
 {
-	FVector WaterfallForwardVector = GetActorForwardVector();
-	float WaterfallAngle = GetAngleBetweenVectorsD(WaterfallForwardVector, this->WorldNormalZ);
+	// Pooled waterfalls do nothing until handed out
+	SetActorTickEnabled(false);
 
-	if ((WaterfallAngle >= -this->WaterfallMaxAngle) && (WaterfallAngle <= this->WaterfallMaxAngle))
+	// Leaving water tank registry
+	if (this->RegisteredWaterTank.IsValid())
 	{
-		this->bIsWaterfallVisible = false;
+		this->RegisteredWaterTank->UnregisterWaterfall(this);
 	}
-	else
+	this->RegisteredWaterTank = nullptr;
+	this->HoleIndex = INDEX_NONE;
+	this->PendingOutflowVolume = 0.0f;
+
+	// Hiding at once, pooled waterfall should not ramp down
+	this->bIsWaterfallVisible = false;
+	this->PSAccel = FVector(0.0f, 0.0f, -30000.0f);
+	this->WaterfallParticleSystemComponent->SetVectorParameter(TEXT("WAccel"), this->PSAccel);
+	SetWaterfallVisibility(false);
+	SoundManaging();
+
+	this->bHasBeenCollision = false;
+	this->bIsWaterPuddleDetected = false;
+	this->DetectedWaterPuddle = nullptr;
+	this->OverlappingWaterPuddles.Reset();
+
+	// Leaving water simulation
+	UWorld* const World = GetWorld();
+	if (World != nullptr)
 	{
-		this->bIsWaterfallVisible = true;
+		UWaterSimulationSubsystem* WaterSimulation = World->GetSubsystem<UWaterSimulationSubsystem>();
+		if (WaterSimulation != nullptr)
+		{
+			WaterSimulation->UnregisterWaterfall(this);
+		}
 	}
 }
 
-void AWaterfall::ManageWaterfallDependingOnPlanePosition()
+void AWaterfall::OnAcquiredFromPool()
 {
-	AWaterTank* AttachParentActor = Cast<AWaterTank>(GetAttachParentActor());
-	if (AttachParentActor != nullptr)
+	// Rejoining water simulation, ticking on its own only without it
+	UWorld* const World = GetWorld();
+	UWaterSimulationSubsystem* WaterSimulation = (World != nullptr) ? World->GetSubsystem<UWaterSimulationSubsystem>() : nullptr;
+	if (WaterSimulation != nullptr)
 	{
-		FVector WTPlanePos = AttachParentActor->PlanePosition;
-		FVector WaterfallPos = GetActorLocation();
-
-		if (WTPlanePos.Z <= WaterfallPos.Z)
-		{
-			this->bIsWaterfallVisible = false;
-		}
+		WaterSimulation->RegisterWaterfall(this);
 	}
+	SetActorTickEnabled(WaterSimulation == nullptr);
 }
 
-void AWaterfall::ManageWaterfallDependingOnFillHeight()
+bool AWaterfall::ComputeWaterfallVisibility(const FVector& ForwardVector, float MaxAngle, float WaterfallZ, bool bHasWaterTank, float PlaneZ, float TankFillHeight)
 {
-	AWaterTank* AttachParentActor = Cast<AWaterTank>(GetAttachParentActor());
-	if (AttachParentActor != nullptr)
+	// Managing waterfall depenging on angle between actor and Z normal
+	float WaterfallAngle = GetAngleBetweenVectorsD(ForwardVector, FVector(0.0f, 0.0f, 1.0f));
+	if ((WaterfallAngle >= -MaxAngle) && (WaterfallAngle <= MaxAngle))
 	{
-		if (AttachParentActor->FillHeight <= 0.0f)
+		return false;
+	}
+
+	if (bHasWaterTank)
+	{
+		// Managing waterfall depending on plane position in water tank
+		if (PlaneZ <= WaterfallZ)
 		{
-			this->bIsWaterfallVisible = false;
+			return false;
+		}
+
+		// Managing waterfall depending on fill height in water tank
+		if (TankFillHeight <= 0.0f)
+		{
+			return false;
 		}
 	}
+
+	return true;
 }
 
 void AWaterfall::SetPSAccelAtRuntime()
@@ -268,12 +457,12 @@ void AWaterfall::SetPSAccelAtRuntime()
 		}
 		else
 		{
-			this->WaterfallParticleSystemComponent->SetVisibility(false);
+			SetWaterfallVisibility(false);
 		}
 	}
 	else
 	{
-		this->WaterfallParticleSystemComponent->SetVisibility(true);
+		SetWaterfallVisibility(true);
 
 		if (this->PSAccel != FVector(0.0f, 0.0f, -5000.0f))
 		{
@@ -4,12 +4,17 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "WaterPoolable.h"
 #include "Waterfall.generated.h"
 
 class AWaterPuddle;
+class AWaterTank;
+
+// Broadcast when waterfall particle system is shown or hidden
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnWaterfallVisibilityChanged, AWaterfall*, bool);
 
 UCLASS()
-class FACILITY_API AWaterfall : public AActor
+class FACILITY_API AWaterfall : public AActor, public IWaterPoolable
 {
 	GENERATED_BODY()
 	
@@ -25,6 +30,9 @@ public:
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
+	// Called when waterfall is removed from level
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Waterfall Components")
 	class UParticleSystemComponent* WaterfallParticleSystemComponent;
@@ -35,12 +43,24 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Waterfall Options")
 	FVector WaterPuddleInitialScale;
 
+	// Puddle closer than this to impact is grown instead of spawning a new one
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Waterfall Options", meta = (ClampMin = "0.0"))
+	float WaterPuddleMergeRadius;
+
+	// Radius of floor area wetted around impact in wetness mode
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Waterfall Options", meta = (ClampMin = "0.0"))
+	float WetnessRadius;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Waterfall Options")
 	float WaterfallMaxAngle;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Waterfall Options")
 	FVector PSAccel;
 
+	// Radius of tank hole this waterfall runs out of, in cm
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Waterfall Options", meta = (ClampMin = "0.0"))
+	float HoleRadius;
+
 	UPROPERTY(EditDefaultsOnly, Category = "Waterfall Assets")
 	TSubclassOf<AWaterPuddle> WaterPuddleToSpawn;
 
@@ -54,8 +74,52 @@ public:
 	bool bHasBeenCollision;
 	bool bIsWaterPuddleDetected;
 
-	int64 WaterPuddleActorCount;
-	int64 WaterPuddleCompCount;
+	// Last visibility sent to listeners
+	bool bIsWaterfallVisibleReported;
+
+	FOnWaterfallVisibilityChanged OnWaterfallVisibilityChanged;
+
+	// Volume drained by water tank through this hole, not yet received by a puddle
+	float PendingOutflowVolume;
+
+	// Puddle receiving drained volume, one of overlapping puddles
+	TWeakObjectPtr<AWaterPuddle> DetectedWaterPuddle;
+
+	// Puddles whose collision boxes overlap puddle detector, with number of overlapping boxes
+	TMap<TWeakObjectPtr<AWaterPuddle>, int32> OverlappingWaterPuddles;
+
+	// Tag of puddle detector box, puddles look for it in overlap events
+	static const FName CollisionBoxTag;
+
+	// Set once waterfall stands for a tank hole, pooled waterfalls keep it
+	bool bIsHoleProxy;
+
+	// Hole of registered water tank this waterfall shows
+	int32 HoleIndex;
+
+	// Water tank this waterfall is registered in
+	TWeakObjectPtr<AWaterTank> RegisteredWaterTank;
+
+	// Slot in water simulation subsystem
+	int32 SimulationIndex;
+
+	// IWaterPoolable
+	virtual void OnAcquiredFromPool() override;
+	virtual void OnReleasedToPool() override;
+
+	// Getting waterfall visibility from its orientation and water tank state
+	static bool ComputeWaterfallVisibility(const FVector& ForwardVector, float MaxAngle, float WaterfallZ, bool bHasWaterTank, float PlaneZ, float TankFillHeight);
+
+	// Waterfall update steps, used by Tick and by water simulation subsystem
+
+	UFUNCTION()
+	void UpdateWaterfallComponents(float DeltaTime);
+
+	UFUNCTION()
+	void UpdateWaterfallVisibility();
+
+	UFUNCTION()
+	void SetPSAccelAtRuntime();
 
 	FVector CollideLocation;
 	FVector CollideNormal;
@@ -66,28 +130,32 @@ protected:
 	void OnPSCollide(FName EventName, float EmitterTime, int32 ParticleTime, FVector Location, FVector Velocity, FVector Direction, FVector Normal, FName BoneName, UPhysicalMaterial* PhysMat);
 
 	UFUNCTION()
-	void SoundManaging();
+	void UpdateWaterTankRegistration();
 
 	UFUNCTION()
-	void SpawnWaterPuddle();
+	void SetWaterfallVisibility(bool bNewVisibility);
 
 	UFUNCTION()
-	float GetAngleBetweenVectorsD(FVector A, FVector B);
+	void SoundManaging();
 
 	UFUNCTION()
-	void SetWaterPuddleFlag();
+	void SpawnWaterPuddle(float DeltaTime);
 
+	// Pouring drained volume into wetness field at impact
 	UFUNCTION()
-	void ManageWaterfallDependingOnAngle();
+	void WetFloor();
 
 	UFUNCTION()
-	void ManageWaterfallDependingOnPlanePosition();
+	static float GetAngleBetweenVectorsD(FVector A, FVector B);
 
 	UFUNCTION()
-	void ManageWaterfallDependingOnFillHeight();
+	void SetWaterPuddleFlag();
 
 	UFUNCTION()
-	void SetPSAccelAtRuntime();
+	void OnWaterPuddleBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
+
+	UFUNCTION()
+	void OnWaterPuddleEndOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex);
 
 	UFUNCTION()
 	void Destroyed() override;